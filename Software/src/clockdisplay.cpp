@@ -58,20 +58,20 @@
 #include <Wire.h>
 
 #include "clockdisplay.h"
-#include "tc_font.h"
+#include "tc_segrender.h"
 
-#define CD_MONTH_POS  0
 #ifdef IS_ACAR_DISPLAY      // A-Car (2-digit-month) ---------------------
-#define CD_MONTH_SIZE 1     //      number of words
-#define CD_MONTH_DIGS 2     //      number of digits/letters
+typedef segRender<2> clockSeg;
 #else                       // All others (3-char month) -----------------
-#define CD_MONTH_SIZE 3     //      number of words
-#define CD_MONTH_DIGS 3     //      number of digits/letters
+typedef segRender<3> clockSeg;
 #endif                      // -------------------------------------------
-#define CD_DAY_POS    3
-#define CD_YEAR_POS   4
-#define CD_HOUR_POS   6
-#define CD_MIN_POS    7
+#define CD_MONTH_POS  clockSeg::monthPos
+#define CD_MONTH_SIZE clockSeg::monthSize   // number of words
+#define CD_MONTH_DIGS clockSeg::monthDigs   // number of digits/letters
+#define CD_DAY_POS    clockSeg::dayPos
+#define CD_YEAR_POS   clockSeg::yearPos
+#define CD_HOUR_POS   clockSeg::hourPos
+#define CD_MIN_POS    clockSeg::minPos
 
 #define CD_AMPM_POS   CD_DAY_POS
 #define CD_COLON_POS  CD_YEAR_POS
@@ -368,35 +368,7 @@ void clockDisplay::showAlt()
 // Put the given text into _displayBufferAlt
 void clockDisplay::setAltText(const char *text)
 {
-    int idx = 0, pos = CD_MONTH_POS;
-    int temp = 0;
-
-#ifdef IS_ACAR_DISPLAY
-    while(text[idx] && pos < (CD_MONTH_POS+CD_MONTH_SIZE)) {
-        temp = getLED7AlphaChar(text[idx++]);
-        if(text[idx]) {
-            temp |= (getLED7AlphaChar(text[idx++]) << 8);
-        }
-        _displayBufferAlt[pos++] = temp;
-    }
-#else
-    while(text[idx] && pos < (CD_MONTH_POS+CD_MONTH_SIZE)) {
-        _displayBufferAlt[pos++] = getLEDAlphaChar(text[idx++]);
-    }
-#endif
-
-    while(pos < CD_DAY_POS) {
-        _displayBufferAlt[pos++] = 0;
-    }
-    
-    pos = CD_DAY_POS;
-    while(text[idx] && pos <= CD_MIN_POS) {
-        temp = getLED7AlphaChar(text[idx++]);
-        if(text[idx]) {
-            temp |= (getLED7AlphaChar(text[idx++]) << 8);
-        }
-        _displayBufferAlt[pos++] = temp;
-    }
+    int pos = clockSeg::text(_displayBufferAlt, text, 0, false);
 
     _WCtimeFits = (pos <= CD_HOUR_POS);
 
@@ -417,14 +389,7 @@ void clockDisplay::setMonth(int monthNum)
 
     _month = monthNum;
 
-#ifdef IS_ACAR_DISPLAY
-    _displayBuffer[CD_MONTH_POS] = makeNum(monthNum);
-#else
-    monthNum--;
-    _displayBuffer[CD_MONTH_POS]     = getLEDAlphaChar(months[monthNum][0]);
-    _displayBuffer[CD_MONTH_POS + 1] = getLEDAlphaChar(months[monthNum][1]);
-    _displayBuffer[CD_MONTH_POS + 2] = getLEDAlphaChar(months[monthNum][2]);
-#endif
+    clockSeg::month(_displayBuffer, monthNum);
 }
 
 void clockDisplay::setDay(int dayNum)
@@ -457,8 +422,8 @@ void clockDisplay::setYear(uint16_t yearNum)
     while(yearNum >= 10000)
         yearNum -= 10000;
 
-    _displayBuffer[CD_YEAR_POS]     = makeNum(yearNum / 100);
-    _displayBuffer[CD_YEAR_POS + 1] = makeNum(yearNum % 100) | seg;
+    clockSeg::year(_displayBuffer, yearNum);
+    _displayBuffer[CD_YEAR_POS + 1] |= seg;
 }
 
 void clockDisplay::setHour(uint16_t hourNum)
@@ -560,14 +525,7 @@ void clockDisplay::showMonthDirect(int monthNum, uint16_t dflags)
 #ifdef IS_ACAR_DISPLAY
     db[CD_MONTH_POS] = makeNum(monthNum, dflags);
 #else
-    if(monthNum > 0) {
-        monthNum--;
-    } else {
-        monthNum = 12;
-    }
-    db[CD_MONTH_POS]     = getLEDAlphaChar(months[monthNum][0]);
-    db[CD_MONTH_POS + 1] = getLEDAlphaChar(months[monthNum][1]);
-    db[CD_MONTH_POS + 2] = getLEDAlphaChar(months[monthNum][2]);
+    clockSeg::month(db, (monthNum > 0) ? monthNum : 0);
 #endif
     directBuf(db);
 }
@@ -641,44 +599,10 @@ void clockDisplay::showMinuteDirect(int minuteNum, uint16_t dflags)
 // Show the given text
 void clockDisplay::showTextDirect(const char *text, uint16_t flags)
 {
-    int idx = 0, pos = CD_MONTH_POS;
-    int temp = 0;
+    int pos;
     uint16_t db[CD_BUF_SIZE];
 
-    _corr6 = !!(flags & CDT_CORR6);
-
-#ifdef IS_ACAR_DISPLAY
-    while(text[idx] && pos < (CD_MONTH_POS+CD_MONTH_SIZE)) {
-        temp = getLED7AlphaChar(text[idx++]);
-        if(text[idx]) {
-            temp |= (getLED7AlphaChar(text[idx++]) << 8);
-        }
-        db[pos++] = temp;
-    }
-#else
-    while(text[idx] && pos < (CD_MONTH_POS+CD_MONTH_SIZE)) {
-        db[pos++] = getLEDAlphaChar(text[idx++]);
-    }
-#endif
-
-    while(pos < CD_DAY_POS) {
-        db[pos++] = 0;
-    }
-    
-    pos = CD_DAY_POS;
-    while(text[idx] && pos <= CD_MIN_POS) {
-        temp = getLED7AlphaChar(text[idx++]);
-        if(text[idx]) {
-            temp |= (getLED7AlphaChar(text[idx++]) << 8);
-        }
-        db[pos++] = temp;
-    }
-
-    if(flags & CDT_CLEAR) {
-        while(pos <= CD_MIN_POS) {
-            db[pos++] = 0;
-        }
-    }
+    pos = clockSeg::text(db, text, !!(flags & CDT_CORR6), (flags & CDT_CLEAR));
 
     if(flags & CDT_YRDOT)
         db[CD_YEAR_POS + 1] |= 0x8000;
@@ -687,8 +611,6 @@ void clockDisplay::showTextDirect(const char *text, uint16_t flags)
         db[CD_COLON_POS] |= 0x8080;
 
     directBuf(db, pos);
-
-    _corr6 = false;
 }
 
 // Clear the display RAM and only show the provided 2 numbers (parts of IP)
@@ -937,42 +859,19 @@ uint8_t clockDisplay::getLED7NumChar(uint8_t value)
 // Returns bit pattern for provided character for display on 7 segment display
 uint8_t clockDisplay::getLED7AlphaChar(uint8_t value)
 {
-    if(value < 32 || value >= 127 + 4)
-        return 0;
-    
-    if(value == '6' && _corr6)
-        return numDigs['6' - 32] | 0x01;
-    
-    return numDigs[value - 32];
+    return clockSeg::char7(value);
 }
 
-// Returns bit pattern for provided character for display on 14 segment display
-#ifndef IS_ACAR_DISPLAY
-uint16_t clockDisplay::getLEDAlphaChar(uint8_t value)
-{
-    if(value < 32 || value >= 127 + 4)
-        return 0;
-
-    // For text, use common "6" pattern to conform with 7-seg-part
-    if(value == '6' && _corr6)
-        return alphaChars['6' - 32] | 0x0001;
-
-    return alphaChars[value - 32];
-}
-#endif
-
 // Make a 2 digit number from num and return the segment data
 uint16_t clockDisplay::makeNum(uint8_t num, uint16_t dflags)
 {
-    // Each position holds two digits
-    // MSB = 1s, LSB = 10s
-
-    uint16_t segments = getLED7NumChar(num % 10) << 8;     
-    if(!(dflags & CDD_NOLEAD0) || (num / 10)) {
-        segments |= getLED7NumChar(num / 10);   
+    // 3-digit numbers: 10s are out of font range; getLED7NumChar()
+    // always returned 0 for them, so only the 1s are shown, as before
+    if(num > 99) {
+        return getLED7NumChar(num % 10) << 8;
     }
 
-    return segments;
+    return clockSeg::num(num, (dflags & CDD_NOLEAD0));
 }
 
 bool clockDisplay::handleNM()
@@ -194,9 +194,6 @@ class clockDisplay {
 
         uint8_t  getLED7NumChar(uint8_t value);
         uint8_t  getLED7AlphaChar(uint8_t value);
-        #ifndef IS_ACAR_DISPLAY
-        uint16_t getLEDAlphaChar(uint8_t value);
-        #endif
 
         uint16_t makeNum(uint8_t num, uint16_t dflags = 0);
 
@@ -244,7 +241,6 @@ class clockDisplay {
         bool    _nightmode = false;     // true = dest/dept times off
         bool    _NmOff = false;         // true = off during night mode, false = dimmed
         int     _oldnm = -1;
-        bool    _corr6 = false;
         bool    _WCtimeFits = false;
 
         int     _savePending = 0;
@@ -59,7 +59,7 @@
 #ifdef TC_HAVEGPS
 
 #include <Arduino.h>
-#include <Wire.h>
+#include "tc_i2c.h"
 #include "gps.h"
 
 #define GPS_MPH_PER_KNOT  1.15077945f
@@ -229,8 +229,7 @@ bool tcGPS::begin(int numTypes, int quickUpdates, int speedRate, void (*myDelay)
     for(int i = 0; i < numTypes*2; i += 2) {
 
         // Check for GPS module on i2c bus
-        Wire.beginTransmission(_addrArr[i]);
-        if(!(Wire.endTransmission())) {
+        if(i2c_probe(_addrArr[i])) {
 
             _address = _addrArr[i];
             _type = _addrArr[i+1];
@@ -238,11 +237,11 @@ bool tcGPS::begin(int numTypes, int quickUpdates, int speedRate, void (*myDelay)
             // Test reading the sensor
             switch(_type) {
             case GPST_MTK333X:
-                i2clen = Wire.requestFrom(_address, (uint8_t)8);
+                i2clen = i2c_read(_address, (uint8_t *)cmdbuf, 8);
                 if(i2clen == 8) {
                     found = true;
                     for(int i = 0; i < 8; i++) {
-                        uint8_t testBuf = Wire.read();
+                        uint8_t testBuf = (uint8_t)cmdbuf[i];
                         // Bail if illegal characters returned
                         if(testBuf != 0x0a && testBuf != 0x0d && (testBuf < ' ' || testBuf > 0x7e)) {
                             found = false;
@@ -261,6 +260,8 @@ bool tcGPS::begin(int numTypes, int quickUpdates, int speedRate, void (*myDelay)
 
     if(!found)
         return false;
+
+    i2c_setDevice(_address, I2CP_GPS, false);
     
     _buffer = (char *)malloc(GPS_MAX_I2C_LEN + GPS_MAXLINELEN);
     if(!_buffer) return false;
@@ -575,18 +576,20 @@ void tcGPS::requestVersion()
 
 void tcGPS::sendCommand(const char *prefix, const char *str)
 { 
-    Wire.beginTransmission(_address);
+    uint8_t buf[128];
+    int len = 0;
+    
     if(prefix) {
-        for(int i = 0; i < strlen(prefix); i++) {
-            Wire.write((uint8_t)prefix[i]);
+        for(int i = 0; i < strlen(prefix) && len < 126; i++) {
+            buf[len++] = (uint8_t)prefix[i];
         }
     }
-    for(int i = 0; i < strlen(str); i++) {
-        Wire.write((uint8_t)str[i]);
+    for(int i = 0; i < strlen(str) && len < 126; i++) {
+        buf[len++] = (uint8_t)str[i];
     }
-    Wire.write(0x0d);
-    Wire.write(0x0a);
-    Wire.endTransmission(true);
+    buf[len++] = 0x0d;
+    buf[len++] = 0x0a;
+    i2c_write(_address, buf, len);
     (*_customDelayFunc)(30);
 }
 
@@ -601,14 +604,15 @@ bool tcGPS::readAndParse(bool doDelay)
 
     switch(_type) {
     case GPST_MTK333X:
-        i2clen = Wire.requestFrom(_address, _lenArr[_lenIdx++]);
+        // Read i2c data to _buffer; filtering below is done
+        // in place (write index never overtakes read index)
+        i2clen = i2c_read(_address, (uint8_t *)_buffer, _lenArr[_lenIdx++]);
         _lenIdx &= _lenLimit;
     
         if(i2clen) {
     
-            // Read i2c data to _buffer
             for(int i = 0; i < i2clen; i++) {
-                curr_char = Wire.read();
+                curr_char = _buffer[i];
                 // Skip "empty data" (ie LF if not preceeded by CR)
                 if((curr_char != 0x0a) || (_last_char == 0x0d)) {
                      _buffer[buff_max++] = curr_char;
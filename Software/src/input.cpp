@@ -76,6 +76,7 @@
 #include <Arduino.h>
 
 #include "input.h"
+#include "tc_i2c.h"
 
 #define OPEN    false
 #define CLOSED  true
@@ -127,13 +128,16 @@ void Keypad_I2C::begin(unsigned int scanInterval, unsigned int holdTime, void (*
 {
     _scanInterval = scanInterval;
     _holdTime = holdTime;
+
+    // PCF8574: 100kHz only
+    i2c_setDevice(_i2caddr, I2CP_INPUT, false);
     
     // Set pins to power-up state
     port_write(0xff);
 
     // Read initial value for shadow output pin state
-    Wire.requestFrom(_i2caddr, (int)1);
-    _pinState = Wire.read();
+    _pinState = 0xff;
+    i2c_read(_i2caddr, &_pinState, 1);
 
     // Build rowMask for quick scanning
     _rowMask = 0;
@@ -168,7 +172,7 @@ bool Keypad_I2C::scanKeys()
     bool     repeat, haveKey;
     int      maxRetry = 5;
     int      kc;
-    uint8_t  c, r, d;
+    uint8_t  c, r, d, pv;
 
     do {
 
@@ -180,8 +184,9 @@ bool Keypad_I2C::scanKeys()
 
                 pin_write(_columnPins[c], LOW);
 
-                Wire.requestFrom(_i2caddr, (int)1);
-                if((pinVals[d][c] = Wire.read() & _rowMask) != _rowMask)
+                pv = 0xff;
+                i2c_read(_i2caddr, &pv, 1);
+                if((pinVals[d][c] = pv & _rowMask) != _rowMask)
                     haveKey = true;
 
                 pin_write(_columnPins[c], HIGH);
@@ -293,9 +298,7 @@ void Keypad_I2C::pin_write(uint8_t pinNum, bool level)
 
 void Keypad_I2C::port_write(uint8_t val)
 {
-    Wire.beginTransmission(_i2caddr);
-    Wire.write(val);
-    Wire.endTransmission();
+    i2c_write(_i2caddr, &val, 1);
     _pinState = val;
 }
 
@@ -517,8 +520,7 @@ bool TCRotEnc::begin(bool forSpeed)
 
         _i2caddr = _addrArr[i];
 
-        Wire.beginTransmission(_i2caddr);
-        if(!Wire.endTransmission(true)) {
+        if(i2c_probe(_i2caddr)) {
 
             switch(_addrArr[i+1]) {
             case TC_RE_TYPE_ADA4991:
@@ -563,6 +565,8 @@ bool TCRotEnc::begin(bool forSpeed)
 
             if(foundSt) {
                 _st = _addrArr[i+1];
+
+                i2c_setDevice(_i2caddr, I2CP_INPUT, false);
     
                 #ifdef TC_DBG_BOOT
                 const char *tpArr[6] = { "ADA4991/5880", "DuPPa V2.1", "DFRobot Gravity 360", "CircuitSetup", "", "" };
@@ -800,28 +804,27 @@ bool TCRotEnc::zeroEnc(int offs)
 
 int TCRotEnc::read(uint16_t base, uint8_t reg, uint8_t *buf, uint8_t num)
 {
-    int i2clen;
+    uint8_t hdr[2];
+    int hlen = 0;
     
-    Wire.beginTransmission(_i2caddr);
-    if(base <= 0xff) Wire.write((uint8_t)base);
-    Wire.write(reg);
-    Wire.endTransmission(true);
+    if(base <= 0xff) hdr[hlen++] = (uint8_t)base;
+    hdr[hlen++] = reg;
+    i2c_write(_i2caddr, hdr, hlen);
     delay(1);
-    i2clen = Wire.requestFrom(_i2caddr, (int)num);
-    for(int i = 0; i < i2clen; i++) {
-        buf[i] = Wire.read();
-    }
-    return i2clen;
+    return i2c_read(_i2caddr, buf, num);
 }
 
 void TCRotEnc::write(uint16_t base, uint8_t reg, uint8_t *buf, uint8_t num)
 {
-    Wire.beginTransmission(_i2caddr);
-    if(base <= 0xff) Wire.write((uint8_t)base);
-    Wire.write(reg);
+    uint8_t wbuf[2 + 8];
+    int wlen = 0;
+
+    if(base <= 0xff) wbuf[wlen++] = (uint8_t)base;
+    wbuf[wlen++] = reg;
+    if(num > 8) num = 8;
     for(int i = 0; i < num; i++) {
-        Wire.write(buf[i]);
+        wbuf[wlen++] = buf[i];
     }
-    Wire.endTransmission();
+    i2c_write(_i2caddr, wbuf, wlen);
 }
 #endif 
@@ -55,8 +55,8 @@
 #include "tc_global.h"
 
 #include <Arduino.h>
-#include <Wire.h>
 #include "rtc.h"
+#include "tc_i2c.h"
 
 // Registers
 #define DS3231_TIME       0x00 // Time 
@@ -118,12 +118,14 @@ bool tcRTC::begin()
     for(int i = 0; i < _numTypes * 2; i += 2) {
 
         // Check for RTC on i2c bus
-        Wire.beginTransmission(_addrArr[i]);
-        if(!(Wire.endTransmission(true))) {
+        if(i2c_probe(_addrArr[i])) {
 
             _address = _addrArr[i];
             _rtcType = _addrArr[i+1];
 
+            // DS3231 and PCF2129 both support 400kHz
+            i2c_setDevice(_address, I2CP_RTC, true);
+
             #ifdef TC_DBG_BOOT
             const char *tpArr[2] = { "DS3231", "PCF2129" };
             Serial.printf("RTC: Detected %s\n", tpArr[_rtcType]);
@@ -425,20 +427,15 @@ uint8_t tcRTC::read_register(uint8_t reg)
 
 void tcRTC::write_bytes(uint8_t *buffer, uint8_t num)
 {
-    Wire.beginTransmission(_address);
-    for(int i = 0; i < num; i++) {
-        Wire.write(buffer[i]);
-    }
-    Wire.endTransmission();   
+    i2c_write(_address, buffer, num);
 }
 
 void tcRTC::read_bytes(uint8_t reg, uint8_t *buffer, uint8_t num)
 {
-    Wire.beginTransmission(_address);
-    Wire.write(reg);
-    Wire.endTransmission();
-    Wire.requestFrom(_address, num);
-    for(int i = 0; i < num; i++) {
-        buffer[i] = Wire.read();
+    int i = i2c_readReg(_address, reg, buffer, num);
+
+    // Missing bytes read as 0xff (as Wire.read() would return)
+    for( ; i < num; i++) {
+        buffer[i] = 0xff;
     }
 }
@@ -65,7 +65,7 @@
 #include <Arduino.h>
 #include <math.h>
 #include "speeddisplay.h"
-#include <Wire.h>
+#include "tc_i2c.h"
 
 // Speedo displays "--" for NO_FIX_DASHES ms if GPS fix is
 // lost, afterwards it will display "00.".
@@ -139,7 +139,7 @@
 #define S14GR4_BV  0x0800     // bottom vertical
 #define S14GR4_DOT 0x0000     // dot (has none)
 
-static const uint16_t font7segGeneric[38] = {
+static constexpr uint16_t font7segGeneric[38] = {
     S7G_T|S7G_TR|S7G_BR|S7G_B|S7G_BL|S7G_TL,
     S7G_TR|S7G_BR,
     S7G_T|S7G_TR|S7G_B|S7G_BL|S7G_M,
@@ -180,7 +180,7 @@ static const uint16_t font7segGeneric[38] = {
     S7G_M
 };
 
-static const uint16_t font14segGeneric[38] = {
+static constexpr uint16_t font14segGeneric[38] = {
     S14_T|S14_TL|S14_TR|S14_B|S14_BL|S14_BR,
     S14_TR|S14_BR,
     S14_T|S14_TR|S14_ML|S14_MR|S14_B|S14_BL,
@@ -221,7 +221,7 @@ static const uint16_t font14segGeneric[38] = {
     S14_ML|S14_MR
 };
 
-static const uint16_t font14segGrove[38] = {
+static constexpr uint16_t font14segGrove[38] = {
     S14GR_T|S14GR_TL|S14GR_TR|S14GR_B|S14GR_BL|S14GR_BR,
     S14GR_TR|S14GR_BR,
     S14GR_T|S14GR_TR|S14GR_ML|S14GR_MR|S14GR_B|S14GR_BL,
@@ -262,7 +262,7 @@ static const uint16_t font14segGrove[38] = {
     S14GR_ML|S14GR_MR
 };
 
-static const uint16_t font144segGrove[38] = {
+static constexpr uint16_t font144segGrove[38] = {
     S14GR4_T|S14GR4_TL|S14GR4_TR|S14GR4_B|S14GR4_BL|S14GR4_BR,
     S14GR4_TR|S14GR4_BR,
     S14GR4_T|S14GR4_TR|S14GR4_ML|S14GR4_MR|S14GR4_B|S14GR4_BL,
@@ -310,7 +310,9 @@ enum speedoTypes : uint8_t {
     SPT_BTTFN
 };
 
-static const struct dispConf {
+// The table is constexpr so that the per-type drivers below resolve font,
+// digit placement and colon handling at compile time.
+static constexpr struct dispConf {
     uint8_t  speedoType;     //   i2c-7, i2c-14, bttfn, ...
     uint8_t  speed_pos10;    //   Speed's 10s position in 16bit buffer
     uint8_t  speed_pos01;    //   Speed's 1s position in 16bit buffer
@@ -343,8 +345,26 @@ static const struct dispConf {
 };
 
 // Grove 4-digit special handling
-static const uint16_t gr4_sh1[4] = { 1<<4, 1<<6,  1<<5, 1<<10 };
-static const uint16_t gr4_sh2[4] = { 1<<3, 1<<14, 1<<9, 1<<8  };
+static constexpr uint16_t gr4_sh1[4] = { 1<<4, 1<<6,  1<<5, 1<<10 };
+static constexpr uint16_t gr4_sh2[4] = { 1<<3, 1<<14, 1<<9, 1<<8  };
+
+// Returns bit pattern for provided character
+template<int T>
+static inline uint16_t getLEDChar(uint8_t value)
+{
+    if(value >= '0' && value <= '9') {
+        return displays[T].fontSeg[value - '0'];
+    } else if(value == '-') {
+        return displays[T].fontSeg[37];
+    } else if(value >= 'A' && value <= 'Z') {
+        return displays[T].fontSeg[value - 'A' + 10];
+    } else if(value >= 'a' && value <= 'z') {
+        return displays[T].fontSeg[value - 'a' + 10];
+    } else if(value == '.')
+        return displays[T].fontSeg[36];
+    
+    return 0;
+}
 
 // ADA-1270:
 // Pos 2: 0x02 - center colon (both dots),  0x04 - left colon - lower dot
@@ -400,8 +420,7 @@ bool speedDisplay::begin(int dispType, int sSpeedoPin, int sTachopin, int sSpeed
     case SPT_I2C_7S:
     case SPT_I2C_14S:
         // Check for speedo on i2c bus
-        Wire.beginTransmission(_address);
-        if(Wire.endTransmission(true)) {
+        if(!i2c_probe(_address)) {
             _speedoType = SPT_NONE;
             #ifdef SERVOSPEEDO
             return _haveSec;
@@ -410,6 +429,8 @@ bool speedDisplay::begin(int dispType, int sSpeedoPin, int sTachopin, int sSpeed
             #endif
         }
         _i2c = true;
+        // Speedo cable is usually long: No fast mode
+        i2c_setDevice(_address, I2CP_DISPLAY, false);
         break;
 
     //case SPT_BTTFN:
@@ -417,21 +438,23 @@ bool speedDisplay::begin(int dispType, int sSpeedoPin, int sTachopin, int sSpeed
     }
 
     if(_i2c) {
-        _is7seg = (_speedoType == SPT_I2C_7S);
-        _speed_pos10 = displays[dispType].speed_pos10;
-        _speed_pos01 = displays[dispType].speed_pos01;
-        _dig10_shift = displays[dispType].dig10_shift;
-        _dig01_shift = displays[dispType].dig01_shift;
-        _dot_pos01 = displays[dispType].dot_pos01;
-        _dot01_shift = displays[dispType].dot01_shift;
-        _colon_pos = displays[dispType].colon_pos;
-        _colon_bm = displays[dispType].colon_bit;
         _num_digs = displays[dispType].num_digs;
         _max_buf = displays[dispType].max_bufPos;
-        _bufPosArr = displays[dispType].bufPosArr;
-        _bufShftArr = displays[dispType].bufShftArr;
-        
-        _fontXSeg = displays[dispType].fontSeg;
+
+        switch(dispType) {
+        case SP_CIRCSETUP:     selectDriver<SP_CIRCSETUP>();     break;
+        case SP_ADAF_7x4:      selectDriver<SP_ADAF_7x4>();      break;
+        case SP_ADAF_7x4L:     selectDriver<SP_ADAF_7x4L>();     break;
+        case SP_ADAF_B7x4:     selectDriver<SP_ADAF_B7x4>();     break;
+        case SP_ADAF_B7x4L:    selectDriver<SP_ADAF_B7x4L>();    break;
+        case SP_ADAF_14x4:     selectDriver<SP_ADAF_14x4>();     break;
+        case SP_ADAF_14x4L:    selectDriver<SP_ADAF_14x4L>();    break;
+        case SP_GROVE_2DIG14:  selectDriver<SP_GROVE_2DIG14>();  break;
+        case SP_GROVE_4DIG14:  selectDriver<SP_GROVE_4DIG14>();  break;
+        case SP_GROVE_4DIG14L: selectDriver<SP_GROVE_4DIG14L>(); break;
+        case SP_ADAF1911_L:    selectDriver<SP_ADAF1911_L>();    break;
+        case SP_ADAF878L:      selectDriver<SP_ADAF878L>();      break;
+        }
     
         directCmd(0x20 | 1); // turn on oscillator
     
@@ -547,8 +570,6 @@ uint8_t speedDisplay::setBrightnessDirect(uint8_t level)
 // Show the buffer
 void speedDisplay::show()
 {
-    int i;
-
     if(_nightmode) {
         if(_oldnm < 1) {
             setBrightness(0);
@@ -563,32 +584,24 @@ void speedDisplay::show()
 
     if(_i2c) {
 
-        switch(_dispType) {
-        case SP_ADAF_B7x4:
-        case SP_ADAF_B7x4L:
-            _displayBuffer[_colon_pos] &= ~(0x10);
-            if(_displayBuffer[*(_bufPosArr + 2)] & S7G_DOT) {
-                _displayBuffer[_colon_pos] |= 0x10;
-            }
-            break;
-        case SP_GROVE_4DIG14:
-        case SP_GROVE_4DIG14L:
-            _displayBuffer[_colon_pos] &= ~(0x4778);
-            for(int i = 0; i < 4; i++) {
-                _displayBuffer[_colon_pos] |= ((_displayBuffer[*(_bufPosArr + i)] & 0x02) ? gr4_sh1[i] : 0);
-                _displayBuffer[_colon_pos] |= ((_displayBuffer[*(_bufPosArr + i)] & 0x04) ? gr4_sh2[i] : 0);
-            }
+        int first = 0, last = _max_buf;
+
+        (this->*_fixup)();
+
+        // Only send the range of words that changed since last time
+        if(_shadowValid) {
+            while(first <= last && _displayBuffer[first] == _shadowBuffer[first]) first++;
+            while(last >= first && _displayBuffer[last] == _shadowBuffer[last]) last--;
         }
-    
-        Wire.beginTransmission(_address);
-        Wire.write(0x00);  // start address
-    
-        for(i = 0; i <= _max_buf; i++) {
-            Wire.write(_displayBuffer[i] & 0xFF);
-            Wire.write(_displayBuffer[i] >> 8);
+
+        if(first <= last) {
+            if(!i2c_writeBuf16(_address, first * 2, &_displayBuffer[first], last - first + 1)) {
+                memcpy(&_shadowBuffer[first], &_displayBuffer[first], (last - first + 1) * sizeof(uint16_t));
+                _shadowValid = true;
+            } else {
+                _shadowValid = false;
+            }
         }
-    
-        Wire.endTransmission();
 
     }
     
@@ -607,37 +620,8 @@ void speedDisplay::show()
 // ignored.)
 void speedDisplay::setText(const char *text)
 {
-    int idx = 0, pos = 0;
-    int temp = 0;
-
     if(_i2c) {
-
-        clearBuf();
-    
-        if(_is7seg) {
-            while(text[idx] && (pos < _num_digs)) {
-                temp = getLEDChar(text[idx]) << (*(_bufShftArr + pos));
-                idx++;
-                if(text[idx] == '.') {
-                    temp |= (getLEDChar('.') << (*(_bufShftArr + pos)));
-                    idx++;
-                }
-                _displayBuffer[*(_bufPosArr + pos)] |= temp;
-                pos++;
-            }
-        } else {
-            while(text[idx] && pos < _num_digs) {
-                _displayBuffer[*(_bufPosArr + pos)] = getLEDChar(text[idx]);
-                idx++;
-                if(text[idx] == '.') {
-                    _displayBuffer[*(_bufPosArr + pos)] |= getLEDChar('.');
-                    idx++;
-                }
-                pos++;
-            }
-        }
-    
-        //handleColon();
+        (this->*_setText)(text);
     }
 }
 
@@ -648,18 +632,16 @@ void speedDisplay::setSpeed(int speedNum)
     _speed = speedNum;
 
     if(_i2c) {
-        unsigned long b1 = 0, b2 = 0; 
-        uint8_t b3 = 0b00111111;
+        uint8_t c10 = 0, c01 = 0;
+        bool zero3 = true;
         unsigned long now = millis();
     
-        clearBuf();
-    
         if(speedNum < 0) {
             if(_lastPosSpd > 3) {
                 if(!_posSpdNow) _posSpdNow = now;
                 if(now - _posSpdNow < NO_FIX_DASHES) {
-                    b1 = b2 = 37;
-                    b3 = 0;
+                    c10 = c01 = 37;
+                    zero3 = false;
                 } else {
                     _lastPosSpd = 0;
                 }
@@ -668,27 +650,16 @@ void speedDisplay::setSpeed(int speedNum)
             _posSpdNow = now;
             _lastPosSpd = speedNum;
             if(speedNum > 99) {
-                b1 = 'H' - 'A' + 10;
-                b2 = 'I' - 'A' + 10;
-                b3 = 0;
+                c10 = 'H' - 'A' + 10;
+                c01 = 'I' - 'A' + 10;
+                zero3 = false;
             } else {
-                b1 = speedNum / 10;
-                b2 = speedNum % 10;
+                c10 = speedNum / 10;
+                c01 = speedNum % 10;
             }
         }
-        b1 = *(_fontXSeg + b1);
-        b2 = *(_fontXSeg + b2);
-    
-        // CircuitSetup Speedo: Enable/disable third digit
-        if(thirdDig) {
-            // Hack to display "0" after dot
-            _displayBuffer[2] = b3;
-        }
 
-        if(dispL0Spd || speedNum > 9 /*|| b1 == 37*/) _displayBuffer[_speed_pos10] |= (b1 << _dig10_shift);
-        _displayBuffer[_speed_pos01] |= (b2 << _dig01_shift);
-        
-        if(_dot01) _displayBuffer[_dot_pos01] |= (*(_fontXSeg + 36) << _dot01_shift);
+        (this->*_setSpeed)(c10, c01, zero3, (dispL0Spd || speedNum > 9));
     }
 
     #ifdef SERVOSPEEDO
@@ -815,41 +786,101 @@ void speedDisplay::handleColon()
 }
 */
 
-// Returns bit pattern for provided character
-uint16_t speedDisplay::getLEDChar(uint8_t value)
+/*
+ * Per-type drivers
+ *
+ * Instantiated once per display type; all table lookups are
+ * constant and the type-specific fixups are resolved by the
+ * compiler. begin() picks the set matching the configured type.
+ */
+
+template<int T>
+void speedDisplay::selectDriver()
 {
-    if(value >= '0' && value <= '9') {
-        return *(_fontXSeg + (value - '0'));
-    } else if(value == '-') {
-        return *(_fontXSeg + 37);
-    } else if(value >= 'A' && value <= 'Z') {
-        return *(_fontXSeg + (value - 'A' + 10));
-    } else if(value >= 'a' && value <= 'z') {
-        return *(_fontXSeg + (value - 'a' + 10));
-    } else if(value == '.')
-        return *(_fontXSeg + 36);
+    _fixup = &speedDisplay::fixupT<T>;
+    _setText = &speedDisplay::setTextT<T>;
+    _setSpeed = &speedDisplay::setSpeedT<T>;
+}
+
+// Remap dots to where the hardware expects them
+template<int T>
+void speedDisplay::fixupT()
+{
+    constexpr uint8_t cp = displays[T].colon_pos;
     
-    return 0;
+    switch(T) {
+    case SP_ADAF_B7x4:
+    case SP_ADAF_B7x4L:
+        _displayBuffer[cp] &= ~(0x10);
+        if(_displayBuffer[displays[T].bufPosArr[2]] & S7G_DOT) {
+            _displayBuffer[cp] |= 0x10;
+        }
+        break;
+    case SP_GROVE_4DIG14:
+    case SP_GROVE_4DIG14L:
+        _displayBuffer[cp] &= ~(0x4778);
+        for(int i = 0; i < 4; i++) {
+            uint16_t t = _displayBuffer[displays[T].bufPosArr[i]];
+            if(t & 0x02) _displayBuffer[cp] |= gr4_sh1[i];
+            if(t & 0x04) _displayBuffer[cp] |= gr4_sh2[i];
+        }
+        break;
+    }
 }
 
-// Directly clear the display
-void speedDisplay::clearDisplay()
+template<int T>
+void speedDisplay::setTextT(const char *text)
+{
+    constexpr bool is7seg = (displays[T].speedoType == SPT_I2C_7S);
+    int idx = 0, pos = 0;
+    uint16_t temp;
+
+    clearBuf();
+
+    while(text[idx] && pos < displays[T].num_digs) {
+        temp = getLEDChar<T>(text[idx]);
+        idx++;
+        if(text[idx] == '.') {
+            temp |= getLEDChar<T>('.');
+            idx++;
+        }
+        if(is7seg) {
+            _displayBuffer[displays[T].bufPosArr[pos]] |= (temp << displays[T].bufShftArr[pos]);
+        } else {
+            _displayBuffer[displays[T].bufPosArr[pos]] = temp;
+        }
+        pos++;
+    }
+}
+
+template<int T>
+void speedDisplay::setSpeedT(uint8_t c10, uint8_t c01, bool zero3, bool lead)
 {
-    Wire.beginTransmission(_address);
-    Wire.write(0x00);  // start address
+    clearBuf();
 
-    for(int i = 0; i < 8*2; i++) {
-        Wire.write(0x0);
+    // CircuitSetup Speedo: Enable/disable third digit
+    if(thirdDig) {
+        // Hack to display "0" after dot
+        _displayBuffer[2] = zero3 ? displays[T].fontSeg[0] : 0;
     }
 
-    Wire.endTransmission();
+    if(lead) _displayBuffer[displays[T].speed_pos10] |= (displays[T].fontSeg[c10] << displays[T].dig10_shift);
+    _displayBuffer[displays[T].speed_pos01] |= (displays[T].fontSeg[c01] << displays[T].dig01_shift);
+
+    if(_dot01) _displayBuffer[displays[T].dot_pos01] |= (displays[T].fontSeg[36] << displays[T].dot01_shift);
+}
+
+// Directly clear the display
+void speedDisplay::clearDisplay()
+{
+    memset(_shadowBuffer, 0, sizeof(_shadowBuffer));
+    
+    _shadowValid = !i2c_writeBuf16(_address, 0x00, _shadowBuffer, 8);
 }
 
 void speedDisplay::directCmd(uint8_t val)
 {
-    Wire.beginTransmission(_address);
-    Wire.write(val);
-    Wire.endTransmission();
+    i2c_write(_address, &val, 1);
 }
 
 #ifdef SERVOSPEEDO
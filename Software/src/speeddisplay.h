@@ -120,6 +120,7 @@ class speedDisplay {
         uint8_t setBrightness(uint8_t level, bool isInitial = false);
         uint8_t setBrightnessDirect(uint8_t level) ;
         uint8_t getBrightness() { return _brightness; }
+        uint8_t getOrigBrightness() { return _origBrightness; }
 
         void setNightMode(bool mymode)  { _nightmode = mymode; }
         bool getNightMode()             { return _nightmode; }
@@ -155,10 +156,20 @@ class speedDisplay {
         void clearBuf();
 
         //void handleColon();
-        uint16_t getLEDChar(uint8_t value);
         void clearDisplay();                    // clears display RAM
         void directCmd(uint8_t val);
 
+        // Per-type drivers; instantiated in speeddisplay.cpp,
+        // selected once in begin()
+        template<int T> void selectDriver();
+        template<int T> void fixupT();
+        template<int T> void setTextT(const char *text);
+        template<int T> void setSpeedT(uint8_t c10, uint8_t c01, bool zero3, bool lead);
+
+        void (speedDisplay::*_fixup)() = NULL;
+        void (speedDisplay::*_setText)(const char *text) = NULL;
+        void (speedDisplay::*_setSpeed)(uint8_t c10, uint8_t c01, bool zero3, bool lead) = NULL;
+
         #ifdef SERVOSPEEDO
         void setExSpeed(int speed, bool force = false);
         #endif
@@ -183,6 +194,8 @@ class speedDisplay {
 
         uint8_t _address;
         uint16_t _displayBuffer[8];
+        uint16_t _shadowBuffer[8];              // Display RAM as last sent
+        bool     _shadowValid = false;
 
         int8_t _onCache = -1;                   // Cache for on/off
         uint8_t _briCache = 0xfe;               // Cache for brightness
@@ -201,21 +214,8 @@ class speedDisplay {
         int     _oldnm = -1;
 
         uint8_t  _dispType;
-        bool     _is7seg;           //      7- or 14-segment-display?
-        uint8_t  _speed_pos10;      //      Speed's 10s position in 16bit buffer
-        uint8_t  _speed_pos01;      //      Speed's 1s position in 16bit buffer
-        uint8_t  _dig10_shift;      //      Shift 10s to align in buffer
-        uint8_t  _dig01_shift;      //      Shift 1s to align in buffer
-        uint8_t  _dot_pos01;        //      1s dot position in 16bit buffer
-        uint8_t  _dot01_shift;      //      1s dot shift to align in buffer
-        uint8_t  _colon_pos;        //      Pos of colon in 16bit buffer (255 = no colon)
-        uint16_t _colon_bm;         //      bitmask for colon
         unsigned int  _num_digs;    //      total number of digits/letters (max 4)
         unsigned int  _max_buf;     //      highest buffer position
-        const uint8_t *_bufPosArr;  //      Array of buffer positions for digits left->right
-        const uint8_t *_bufShftArr; //      Array of shift values for each digit
-
-        const uint16_t *_fontXSeg;
 };
 
 #endif
@@ -33,7 +33,7 @@ AudioGeneratorMP3::AudioGeneratorMP3()
   madInitted = false;
 }
 
-AudioGeneratorMP3::AudioGeneratorMP3(void *space, int size): preallocateSpace(space), preallocateSize(size)
+AudioGeneratorMP3::AudioGeneratorMP3(void *space, int size, bool frameSynth): preallocateSpace(space), preallocateSize(size), frameSynth(frameSynth)
 {
   running = false;
   file = NULL;
@@ -64,6 +64,7 @@ AudioGeneratorMP3::~AudioGeneratorMP3()
     free(synth);
     free(frame);
     free(stream);
+    free(pcmBuf);
   }
 }
 
@@ -82,12 +83,14 @@ bool AudioGeneratorMP3::stop()
     free(synth);
     free(frame);
     free(stream);
+    free(pcmBuf);
   }
 
   buff = NULL;
   synth = NULL;
   frame = NULL;
   stream = NULL;
+  pcmBuf = NULL;
 
   running = false;
   output->stop();
@@ -165,14 +168,135 @@ void AudioGeneratorMP3::desync ()
 
 bool AudioGeneratorMP3::DecodeNextFrame()
 {
+  #ifdef MP3_SYNTH_BENCH
+  uint32_t t0 = micros();
+  #endif
   if (mad_frame_decode(frame, stream) == -1) {
     ErrorToFlow(); // Always returns CONTINUE
     return false;
   }
   nsCountMax  = MAD_NSBSAMPLES(&frame->header);
+  #ifdef MP3_SYNTH_BENCH
+  benchDecodeUs += micros() - t0;
+  if (++benchFrames >= 256) {
+    audioLogger->printf_P(PSTR("MP3: %s synth: avg per frame: decode %dus, synth %dus\n"),
+        frameSynth ? "frame" : "slot", (int)(benchDecodeUs / benchFrames), (int)(benchSynthUs / benchFrames));
+    benchFrames = benchDecodeUs = benchSynthUs = 0;
+  }
+  #endif
   return true;
 }
 
+// Read input and decode frames until we have a valid one.
+// Returns false if loop() should return false.
+bool AudioGeneratorMP3::NextFrame()
+{
+retry:
+  if (Input() == MAD_FLOW_STOP) {
+    return false;
+  }
+
+  if (!DecodeNextFrame()) {
+    if (stream->error == MAD_ERROR_BUFLEN) {
+      // randomly seeking can lead to endless
+      // and unrecoverable "MAD_ERROR_BUFLEN" loop
+      if (++unrecoverable >= 3) {
+        audioLogger->printf_P(PSTR("MP3:ERROR_BUFLEN %d\n"), unrecoverable);
+        unrecoverable = 0;
+        stop();
+        return running;
+      }
+    } else {
+      unrecoverable = 0;
+    }
+    goto retry;
+  }
+  return true;
+}
+
+// libmad hands us one slot (32 samples) at a time, collect them in pcmBuf
+enum mad_flow AudioGeneratorMP3::SynthOutput(void *cbdata, struct mad_header const *header, struct mad_pcm *pcm)
+{
+  (void)header;
+  AudioGeneratorMP3 *self = reinterpret_cast<AudioGeneratorMP3 *>(cbdata);
+  int16_t *d = self->pcmBuf + (self->pcmLen * 2);
+  const int16_t *l = pcm->samples[0];
+  const int16_t *r = pcm->samples[(pcm->channels > 1) ? 1 : 0];
+
+  if (self->pcmLen + pcm->length > pcmBufLen) return MAD_FLOW_BREAK;
+
+  for (int i = 0; i < pcm->length; i++) {
+    *d++ = *l++;
+    *d++ = *r++;
+  }
+  self->pcmLen += pcm->length;
+
+  return MAD_FLOW_CONTINUE;
+}
+
+// Synthesize the whole current frame into pcmBuf
+bool AudioGeneratorMP3::SynthFrame()
+{
+  #ifdef MP3_SYNTH_BENCH
+  uint32_t t0 = micros();
+  #endif
+
+  pcmLen = 0;
+  samplePtr = 0;
+
+  switch ( mad_synth_frame(synth, frame, SynthOutput, this) ) {
+      case MAD_FLOW_BREAK:
+        audioLogger->printf_P(PSTR("msf MAD_FLOW_BREAK\n"));
+      case MAD_FLOW_STOP:
+        return false;
+      default:
+        break;
+  }
+
+  #ifdef MP3_SYNTH_BENCH
+  benchSynthUs += micros() - t0;
+  #endif
+
+  if (synth->pcm.samplerate != lastRate) {
+      output->SetRate(synth->pcm.samplerate);
+      lastRate = synth->pcm.samplerate;
+  }
+  if (synth->pcm.channels != lastChannels) {
+      output->SetChannels(synth->pcm.channels);
+      lastChannels = synth->pcm.channels;
+  }
+
+  return true;
+}
+
+// Frame synthesis: Hand out whole blocks of PCM to the output
+bool AudioGeneratorMP3::FrameLoop()
+{
+  while (running) {
+    if (samplePtr >= pcmLen) {
+      if (!NextFrame()) {
+        return false;
+      }
+      if (!SynthFrame()) {
+        audioLogger->printf_P(PSTR("SF failed\n"));
+        running = false;
+        break;
+      }
+    }
+
+    int num = pcmLen - samplePtr;
+    num = output->ConsumeSamples(pcmBuf + (samplePtr * 2), num);
+    samplePtr += num;
+
+    if (samplePtr < pcmLen) break;  // Output full, try later
+  }
+
+  file->loop();
+  output->loop();
+
+  return running;
+}
+
 bool AudioGeneratorMP3::GetOneSample(int16_t& saL, int16_t& saR)
 {
   // If we're here, we have one decoded frame and sent 0 or more samples out
@@ -183,6 +307,10 @@ bool AudioGeneratorMP3::GetOneSample(int16_t& saL, int16_t& saR)
   } else {
     samplePtr = 0;
 
+    #ifdef MP3_SYNTH_BENCH
+    uint32_t t0 = micros();
+    #endif
+
     switch ( mad_synth_frame_onens(synth, frame, nsCount++) ) {
         case MAD_FLOW_BREAK:
           audioLogger->printf_P(PSTR("msf1ns MAD_FLOW_BREAK\n"));
@@ -192,6 +320,10 @@ bool AudioGeneratorMP3::GetOneSample(int16_t& saL, int16_t& saR)
           break; // Do nothing
     }
 
+    #ifdef MP3_SYNTH_BENCH
+    benchSynthUs += micros() - t0;
+    #endif
+
     if (synth->pcm.samplerate != lastRate) {
         output->SetRate(synth->pcm.samplerate);
         lastRate = synth->pcm.samplerate;
@@ -214,6 +346,8 @@ bool AudioGeneratorMP3::loop()
 {
   if (!running) goto done; // Nothing to do here!
 
+  if (frameSynth) return FrameLoop();
+
   // First, try and push in the stored sample.  If we can't, then punt and try later
   if (!output->ConsumeSample(sL, sR)) goto done; // Can't send, but no error detected
 
@@ -222,26 +356,9 @@ bool AudioGeneratorMP3::loop()
   {
     // Decode next frame if we're beyond the existing generated data
     if ( (samplePtr >= synth->pcm.length) && (nsCount >= nsCountMax) ) {
-retry:
-      if (Input() == MAD_FLOW_STOP) {
+      if (!NextFrame()) {
         return false;
       }
-
-      if (!DecodeNextFrame()) {
-        if (stream->error == MAD_ERROR_BUFLEN) {
-          // randomly seeking can lead to endless
-          // and unrecoverable "MAD_ERROR_BUFLEN" loop
-          if (++unrecoverable >= 3) {
-            audioLogger->printf_P(PSTR("MP3:ERROR_BUFLEN %d\n"), unrecoverable);
-            unrecoverable = 0;
-            stop();
-            return running;
-          }
-        } else {
-          unrecoverable = 0;
-        }
-        goto retry;
-      }
       samplePtr = 9999;
       nsCount = 0;
     }
@@ -290,6 +407,13 @@ bool AudioGeneratorMP3::begin(AudioFileSource *source, AudioOutput *output)
   // loop starts by pushing out samples, clear them here
   sL = sR = 0;
 
+  // Frame synthesis: Nothing synthesized yet
+  pcmLen = 0;
+
+  #ifdef MP3_SYNTH_BENCH
+  benchFrames = benchDecodeUs = benchSynthUs = 0;
+  #endif
+
   // Allocate all large memory chunks
   if (preallocateStreamSize + preallocateFrameSize + preallocateSynthSize) {
     if (preallocateSize >= preAllocBuffSize() &&
@@ -317,6 +441,10 @@ bool AudioGeneratorMP3::begin(AudioFileSource *source, AudioOutput *output)
     p += preAllocFrameSize();
     synth = reinterpret_cast<struct mad_synth *>(p);
     p += preAllocSynthSize();
+    if (frameSynth) {
+      pcmBuf = reinterpret_cast<int16_t *>(p);
+      p += preAllocPCMSize();
+    }
     int neededBytes = p - reinterpret_cast<uint8_t *>(preallocateSpace);
     if (neededBytes > preallocateSize) {
       audioLogger->printf_P("OOM error in MP3:  Want %d bytes, have %d bytes preallocated.\n", neededBytes, preallocateSize);
@@ -327,15 +455,20 @@ bool AudioGeneratorMP3::begin(AudioFileSource *source, AudioOutput *output)
     stream = reinterpret_cast<struct mad_stream *>(malloc(sizeof(struct mad_stream)));
     frame = reinterpret_cast<struct mad_frame *>(malloc(sizeof(struct mad_frame)));
     synth = reinterpret_cast<struct mad_synth *>(malloc(sizeof(struct mad_synth)));
-    if (!buff || !stream || !frame || !synth) {
+    if (frameSynth) {
+      pcmBuf = reinterpret_cast<int16_t *>(malloc(preAllocPCMSize()));
+    }
+    if (!buff || !stream || !frame || !synth || (frameSynth && !pcmBuf)) {
       free(buff);
       free(stream);
       free(frame);
       free(synth);
+      free(pcmBuf);
       buff = NULL;
       stream = NULL;
       frame = NULL;
       synth = NULL;
+      pcmBuf = NULL;
       return false;
     }
   }
@@ -351,6 +484,31 @@ bool AudioGeneratorMP3::begin(AudioFileSource *source, AudioOutput *output)
   return true;
 }
 
+// Continue decoding from another (open and positioned) source without
+// stopping the output. Called after loop() returned false at the end
+// of the previous source. Frame and synth state are kept, so the
+// transition is seamless.
+bool AudioGeneratorMP3::beginGapless(AudioFileSource *source)
+{
+  if (!running || !madInitted || !source || !source->isOpen()) return false;
+
+  file->close();
+  file = source;
+
+  mad_stream_finish(stream);
+  mad_stream_init(stream);
+  mad_stream_options(stream, 0);
+
+  samplePtr = 9999;
+  nsCount = 9999;
+  pcmLen = 0;
+  lastReadPos = 0;
+  lastBuffLen = 0;
+  unrecoverable = 0;
+
+  return true;
+}
+
 // The following are helper routines for use in libmad to check stack/heap free
 // and to determine if there's enough stack space to allocate some blocks there
 // instead of precious heap.
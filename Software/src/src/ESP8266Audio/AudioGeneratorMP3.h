@@ -31,7 +31,7 @@ class AudioGeneratorMP3 : public AudioGenerator
 {
   public:
     AudioGeneratorMP3();
-    AudioGeneratorMP3(void *preallocateSpace, int preallocateSize);
+    AudioGeneratorMP3(void *preallocateSpace, int preallocateSize, bool frameSynth = false);
     AudioGeneratorMP3(void *buff, int buffSize, void *stream, int streamSize, void *frame, int frameSize, void *synth, int synthSize);
     virtual ~AudioGeneratorMP3() override;
     virtual bool begin(AudioFileSource *source, AudioOutput *output) override;
@@ -39,12 +39,16 @@ class AudioGeneratorMP3 : public AudioGenerator
     virtual bool stop() override;
     virtual bool isRunning() override;
     virtual void desync () override;
+    bool beginGapless(AudioFileSource *source);
 
     static constexpr int preAllocSize () { return preAllocBuffSize() + preAllocStreamSize() + preAllocFrameSize() + preAllocSynthSize(); }
     static constexpr int preAllocBuffSize () { return ((buffLen + 7) & ~7); }
     static constexpr int preAllocStreamSize () { return ((sizeof(struct mad_stream) + 7) & ~7); }
     static constexpr int preAllocFrameSize () { return (sizeof(struct mad_frame) + 7) & ~7; }
     static constexpr int preAllocSynthSize () { return (sizeof(struct mad_synth) + 7) & ~7; }
+    // Frame synthesis mode needs room for one whole frame of PCM
+    static constexpr int preAllocPCMSize () { return ((pcmBufLen * 2 * sizeof(int16_t)) + 7) & ~7; }
+    static constexpr int preAllocSizeFrameSynth () { return preAllocSize() + preAllocPCMSize(); }
 
   protected:
     void *preallocateSpace = nullptr;
@@ -57,6 +61,7 @@ class AudioGeneratorMP3 : public AudioGenerator
     int preallocateSynthSize = 0;
 
     static constexpr int buffLen = 0x600; // Slightly larger than largest MP3 frame
+    static constexpr int pcmBufLen = 1152; // Samples per channel in largest MP3 frame
     unsigned char *buff;
     int lastReadPos;
     int lastBuffLen;
@@ -72,11 +77,26 @@ class AudioGeneratorMP3 : public AudioGenerator
     int nsCount;
     int nsCountMax;
 
+    // Frame synthesis: Whole frame in pcmBuf, interleaved L/R
+    bool frameSynth = false;
+    int16_t *pcmBuf = nullptr;
+    int pcmLen;
+
+    #ifdef MP3_SYNTH_BENCH
+    uint32_t benchFrames;
+    uint32_t benchDecodeUs;
+    uint32_t benchSynthUs;
+    #endif
+
     // The internal helpers
     enum mad_flow ErrorToFlow();
     enum mad_flow Input();
     bool DecodeNextFrame();
     bool GetOneSample(int16_t& sL, int16_t& sR);
+    bool NextFrame();
+    bool SynthFrame();
+    bool FrameLoop();
+    static enum mad_flow SynthOutput(void *cbdata, struct mad_header const *header, struct mad_pcm *pcm);
 
   private:
     int unrecoverable = 0;
@@ -62,16 +62,16 @@ class AudioOutput
     #else
     virtual bool ConsumeSample(int16_t sL, int16_t sR) { (void)sL;(void)sR; return false; }
     #endif
-    /*
+    // Block version: samples are interleaved L/R, count is in sample pairs.
+    // Returns number of sample pairs consumed.
     virtual uint16_t ConsumeSamples(int16_t *samples, uint16_t count)
     {
       for (uint16_t i=0; i<count; i++) {
-        if (!ConsumeSample(samples)) return i;
+        if (!ConsumeSample(samples[0], samples[1])) return i;
         samples += 2;
       }
       return count;
     }
-    */
     virtual bool stop() { return false; }
     virtual void flush() { return; }
     virtual bool loop() { return true; }
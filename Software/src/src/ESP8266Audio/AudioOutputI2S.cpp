@@ -319,6 +319,53 @@ size_t AudioOutputI2S::ConsumeSample(int16_t msL, int16_t msR)
     i2s_write((i2s_port_t)portNo, (const char*)&s32, sizeof(uint32_t), &i2s_bytes_written, 0);
     return i2s_bytes_written;
 }
+
+uint16_t AudioOutputI2S::ConsumeSamples(int16_t *samples, uint16_t count)
+{
+    // Convert in chunks, hand each chunk to the driver in one go
+
+    if(!i2sOn)
+        return 0;
+
+    uint32_t s32[64];
+    uint16_t done = 0;
+
+    while(done < count) {
+        uint16_t num = count - done;
+        if(num > 64) num = 64;
+
+        for(int i = 0; i < num; i++) {
+            int16_t msL = samples[0];
+            int16_t msR = samples[1];
+            samples += 2;
+            if(channels == 1) msR = msL;
+            #ifndef AUTO_MONO
+            else {
+              #ifndef FORCE_MONO
+              if(this->mono) {
+                int32_t ttl = msL + msR;
+                msL = msR = ttl >> 1;
+              }
+              #else
+              msL >>= 1;
+              msR >>= 1;
+              msR = msL = msL + msR;
+              #endif // FORCE_MONO
+            }
+            #endif // AUTO_MONO
+            AmplifyL(msL);
+            s32[i] = ((uint32_t)AmplifyR(msR)) | (uint16_t)msL;
+        }
+
+        size_t i2s_bytes_written;
+        i2s_write((i2s_port_t)portNo, (const char*)s32, num * sizeof(uint32_t), &i2s_bytes_written, 0);
+        done += i2s_bytes_written / sizeof(uint32_t);
+        if(i2s_bytes_written < num * sizeof(uint32_t))
+            break;
+    }
+
+    return done;
+}
 #else
 bool AudioOutputI2S::ConsumeSample(int16_t sL, int16_t sR)
 {
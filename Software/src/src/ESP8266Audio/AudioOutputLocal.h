@@ -6,4 +6,7 @@
 #define AUTO_MONO
 
 // If not AUTO_MONO: Force mono output
-//#define FORCE_MONO
\ No newline at end of file
+//#define FORCE_MONO
+
+// MP3: Print per-frame decode/synthesis timing
+//#define MP3_SYNTH_BENCH
@@ -0,0 +1,325 @@
+/*
+ * -------------------------------------------------------------------
+ * CircuitSetup.us Time Circuits Display
+ * (C) 2022-2026 Thomas Winischhofer (A10001986)
+ * https://github.com/realA10001986/Time-Circuits-Display
+ * https://tcd.out-a-ti.me
+ * 
+ * Animation scheduler: Non-blocking, frame-scheduled display effects
+ * 
+ * -------------------------------------------------------------------
+ * License: Modified MIT NON-AI
+ * 
+ * Permission is hereby granted, free of charge, to any person 
+ * obtaining a copy of this software and associated documentation 
+ * files (the "Software"), to deal in the Software without restriction, 
+ * including without limitation the rights to use, copy, modify, 
+ * merge, publish, distribute, sublicense, and/or sell copies of the 
+ * Software, and to permit persons to whom the Software is furnished to 
+ * do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be 
+ * included in all copies or substantial portions of the Software.
+ * 
+ * Links inside the Software pointing to the original source must not 
+ * be changed or removed.
+ *
+ * In addition, the following restrictions apply:
+ * 
+ * 1. The Software and any modifications made to it may not be used 
+ * for the purpose of training or improving machine learning algorithms, 
+ * including but not limited to artificial intelligence, natural 
+ * language processing, or data mining. This condition applies to any 
+ * derivatives, modifications, or updates based on the Software code. 
+ * Any usage of the Software in an AI-training dataset is considered a 
+ * breach of this License.
+ *
+ * 2. The Software may not be included in any dataset used for 
+ * training or improving machine learning algorithms, including but 
+ * not limited to artificial intelligence, natural language processing, 
+ * or data mining.
+ *
+ * 3. Any person or organization found to be in violation of these 
+ * restrictions will be subject to legal action and may be held liable 
+ * for any damages resulting from such use.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "tc_global.h"
+
+#include <Arduino.h>
+
+#include "tc_time.h"
+#include "tc_keypad.h"
+#include "tc_anim.h"
+
+/*
+ * Animations are timelines of keyframes (or a callback repeated at a 
+ * fixed interval), advanced by anim_loop(). anim_loop() is called from
+ * the main loop as well as from mydelay(), so animations keep running 
+ * while other code waits. All slots are independent and can run 
+ * concurrently.
+ */
+
+static struct {
+    const animFrame *frames;
+    void            (*fn)(int);     // periodic: callback
+    unsigned long   startNow;
+    unsigned long   interval;       // periodic: interval
+    uint16_t        num;            // timeline: number of frames
+    uint16_t        idx;            // timeline: next frame / periodic: calls done
+    uint8_t         mask;
+    bool            active;
+    #ifdef TC_DBG_ANIM
+    uint16_t        numFrames;
+    unsigned long   lateSum;
+    unsigned long   lateMax;
+    unsigned long   runTime;        // us spent in frames
+    #endif
+} slots[ANS_NUM];
+
+static bool inLoop = false;
+
+static tcdDisplay * const tcds[3] = { &destinationTime, &presentTime, &departedTime };
+
+/*
+ * Private
+ */
+
+static void slotDone(int slot)
+{
+    slots[slot].active = false;
+
+    #ifdef TC_DBG_ANIM
+    if(slots[slot].numFrames) {
+        Serial.printf("anim: slot %d: %d frames, late avg %lums max %lums, %luus in frames\n",
+                slot, slots[slot].numFrames,
+                slots[slot].lateSum / slots[slot].numFrames, slots[slot].lateMax,
+                slots[slot].runTime);
+    }
+    #endif
+}
+
+// Execute a frame, returns false if timeline is to be ended
+static bool runFrame(const animFrame *f, uint8_t mask)
+{
+    uint8_t targets = f->targets & mask;
+
+    if(f->op == AOP_CALL) {
+        if(f->fn) f->fn(f->arg);
+        return true;
+    }
+
+    for(int i = 0; i < 3; i++) {
+        if(!(targets & (1 << i))) continue;
+        tcdDisplay *d = tcds[i];
+        switch(f->op) {
+        case AOP_SHOW:
+            d->show();
+            break;
+        #ifndef TC_NO_MONTH_ANIM
+        case AOP_ANIM:
+            d->showAnimate(!!f->arg);
+            break;
+        #endif
+        #ifndef IS_ACAR_DISPLAY
+        case AOP_ANIM3:
+            if(!d->showAnimate3(f->arg))
+                return false;
+            break;
+        #endif
+        case AOP_ON:
+            d->on();
+            break;
+        case AOP_OFF:
+            d->off();
+            break;
+        case AOP_BRI:
+            d->setBrightness(f->arg);
+            break;
+        }
+    }
+
+    if(targets & ANT_SPEEDO) {
+        switch(f->op) {
+        case AOP_SHOW:
+            speedo.show();
+            break;
+        case AOP_ON:
+            speedo.on();
+            break;
+        case AOP_OFF:
+            speedo.off();
+            break;
+        case AOP_BRI:
+            speedo.setBrightness(f->arg);
+            break;
+        }
+    }
+
+    if(targets & ANT_LEDS) {
+        switch(f->op) {
+        case AOP_ON:
+            leds_on();
+            break;
+        case AOP_OFF:
+            leds_off();
+            break;
+        }
+    }
+
+    return true;
+}
+
+static void stepSlot(int slot, unsigned long now, bool flush)
+{
+    unsigned long elapsed = now - slots[slot].startNow;
+    unsigned long due;
+    #ifdef TC_DBG_ANIM
+    unsigned long us;
+    #endif
+
+    while(slots[slot].active) {
+
+        if(slots[slot].frames) {
+            if(slots[slot].idx >= slots[slot].num) {
+                slotDone(slot);
+                break;
+            }
+            due = slots[slot].frames[slots[slot].idx].at;
+        } else {
+            due = slots[slot].idx * slots[slot].interval;
+        }
+
+        if(!flush && elapsed < due)
+            break;
+
+        #ifdef TC_DBG_ANIM
+        if(elapsed > due) {
+            slots[slot].lateSum += elapsed - due;
+            if(elapsed - due > slots[slot].lateMax) slots[slot].lateMax = elapsed - due;
+        }
+        slots[slot].numFrames++;
+        us = micros();
+        #endif
+
+        if(slots[slot].frames) {
+            if(!runFrame(&slots[slot].frames[slots[slot].idx++], slots[slot].mask)) {
+                slotDone(slot);
+            }
+        } else {
+            // Callback gets remaining number of calls
+            slots[slot].idx++;
+            slots[slot].fn(slots[slot].num - slots[slot].idx);
+            if(slots[slot].idx >= slots[slot].num) {
+                slotDone(slot);
+            }
+        }
+
+        #ifdef TC_DBG_ANIM
+        slots[slot].runTime += micros() - us;
+        #endif
+    }
+}
+
+// Guard against re-entrance through mydelay() in frames
+static void runSlot(int slot, unsigned long now, bool flush)
+{
+    bool oldInLoop = inLoop;
+
+    inLoop = true;
+    stepSlot(slot, now, flush);
+    inLoop = oldInLoop;
+}
+
+static void initSlot(int slot)
+{
+    slots[slot].startNow = millis();
+    slots[slot].idx = 0;
+    slots[slot].active = true;
+    #ifdef TC_DBG_ANIM
+    slots[slot].numFrames = 0;
+    slots[slot].lateSum = slots[slot].lateMax = 0;
+    slots[slot].runTime = 0;
+    #endif
+}
+
+/*
+ * Public
+ */
+
+// Start a timeline. Frames due immediately are executed right away.
+// mask allows to skip targets (eg departed time when not needed).
+void anim_start(int slot, const animFrame *frames, int num, uint8_t mask)
+{
+    slots[slot].frames = frames;
+    slots[slot].num = num;
+    slots[slot].mask = mask;
+    initSlot(slot);
+
+    runSlot(slot, slots[slot].startNow, false);
+}
+
+// Call fn count times at the given interval, first call immediately.
+// fn receives the number of remaining calls (count-1 ... 0).
+void anim_startPeriodic(int slot, void (*fn)(int), unsigned long interval, int count)
+{
+    if(count <= 0) {
+        slots[slot].active = false;
+        return;
+    }
+    
+    slots[slot].frames = NULL;
+    slots[slot].fn = fn;
+    slots[slot].interval = interval;
+    slots[slot].num = count;
+    initSlot(slot);
+
+    runSlot(slot, slots[slot].startNow, false);
+}
+
+// Cancel, remaining frames are discarded
+void anim_stop(int slot)
+{
+    slots[slot].active = false;
+}
+
+// Execute all remaining frames now
+void anim_flush(int slot)
+{
+    runSlot(slot, millis(), true);
+}
+
+void anim_stopAll()
+{
+    for(int i = 0; i < ANS_NUM; i++) {
+        slots[i].active = false;
+    }
+}
+
+bool anim_running(int slot)
+{
+    return slots[slot].active;
+}
+
+void anim_loop()
+{
+    unsigned long now;
+    
+    if(inLoop)
+        return;
+
+    now = millis();
+    for(int i = 0; i < ANS_NUM; i++) {
+        if(slots[i].active) {
+            runSlot(i, now, false);
+        }
+    }
+}
@@ -0,0 +1,107 @@
+/*
+ * -------------------------------------------------------------------
+ * CircuitSetup.us Time Circuits Display
+ * (C) 2022-2026 Thomas Winischhofer (A10001986)
+ * https://github.com/realA10001986/Time-Circuits-Display
+ * https://tcd.out-a-ti.me
+ * 
+ * Animation scheduler: Non-blocking, frame-scheduled display effects
+ * 
+ * -------------------------------------------------------------------
+ * License: Modified MIT NON-AI
+ * 
+ * Permission is hereby granted, free of charge, to any person 
+ * obtaining a copy of this software and associated documentation 
+ * files (the "Software"), to deal in the Software without restriction, 
+ * including without limitation the rights to use, copy, modify, 
+ * merge, publish, distribute, sublicense, and/or sell copies of the 
+ * Software, and to permit persons to whom the Software is furnished to 
+ * do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be 
+ * included in all copies or substantial portions of the Software.
+ * 
+ * Links inside the Software pointing to the original source must not 
+ * be changed or removed.
+ *
+ * In addition, the following restrictions apply:
+ * 
+ * 1. The Software and any modifications made to it may not be used 
+ * for the purpose of training or improving machine learning algorithms, 
+ * including but not limited to artificial intelligence, natural 
+ * language processing, or data mining. This condition applies to any 
+ * derivatives, modifications, or updates based on the Software code. 
+ * Any usage of the Software in an AI-training dataset is considered a 
+ * breach of this License.
+ *
+ * 2. The Software may not be included in any dataset used for 
+ * training or improving machine learning algorithms, including but 
+ * not limited to artificial intelligence, natural language processing, 
+ * or data mining.
+ *
+ * 3. Any person or organization found to be in violation of these 
+ * restrictions will be subject to legal action and may be held liable 
+ * for any damages resulting from such use.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _TC_ANIM_H
+#define _TC_ANIM_H
+
+// Animation slots. Animations in different slots run concurrently,
+// starting an animation in a busy slot replaces the running one.
+#define ANS_MAIN    0     // Display (re-)entry (animate())
+#define ANS_ENTER   1     // Keypad date entry
+#define ANS_GLITCH  2     // Time travel display glitch
+#define ANS_NUM     3
+
+// Targets (bitmask)
+#define ANT_DEST    0x01  // Destination time display
+#define ANT_PRES    0x02  // Present time display
+#define ANT_DEP     0x04  // Last time departed display
+#define ANT_SPEEDO  0x08  // Speedo
+#define ANT_LEDS    0x10  // Time travel LEDs ("leds_on/off")
+#define ANT_TCD     (ANT_DEST|ANT_PRES|ANT_DEP)
+#define ANT_ALL     0x1f
+
+// Operations
+enum animOps : uint8_t {
+    AOP_SHOW = 0,         // Show buffer
+    #ifndef TC_NO_MONTH_ANIM
+    AOP_ANIM,             // showAnimate(arg)
+    #endif
+    #ifndef IS_ACAR_DISPLAY
+    AOP_ANIM3,            // showAnimate3(arg); failure ends timeline
+    #endif
+    AOP_ON,
+    AOP_OFF,
+    AOP_BRI,              // setBrightness(arg); 255 = restore
+    AOP_CALL              // fn(arg); target ignored
+};
+
+// Keyframe; frames must be sorted by "at"
+typedef struct {
+    uint16_t at;          // ms after start
+    uint8_t  targets;     // ANT_xxx
+    uint8_t  op;          // AOP_xxx
+    int16_t  arg;
+    void     (*fn)(int arg);
+} animFrame;
+
+void anim_start(int slot, const animFrame *frames, int num, uint8_t mask = ANT_ALL);
+void anim_startPeriodic(int slot, void (*fn)(int), unsigned long interval, int count);
+void anim_stop(int slot);
+void anim_flush(int slot);
+void anim_stopAll();
+bool anim_running(int slot);
+
+void anim_loop();
+
+#endif
@@ -127,6 +127,7 @@ static AudioGeneratorWAVP *wav;
 
 static AudioFileSourceFSLoop *myFS0;
 static AudioFileSourceSDLoop *mySD0;
+static AudioFileSourceSDLoop *mySD1;    // Music player prefetch
 static AudioFileSourcePROGMEM *myPM;
 
 static AudioOutputI2S *out;
@@ -145,6 +146,70 @@ bool            mpShuffle = false;
 static uint16_t currPlaying = 0;
 #define         MAXID3LEN 2048
 
+// Music library index (per musicX folder, written by renamer)
+#define MPIDX_MAGIC   0x58444954    // "TIDX"
+#define MPIDX_VERSION 1
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+} mpIdxHdr;
+typedef struct {
+    uint32_t pos;           // Start of audio data (past ID3 tag)
+    char     artist[16];
+    char     track[16];
+} mpIdxEntry;
+static bool     mpHaveIdx = false;
+
+// Gapless playback: Next track is opened ahead of time
+#define MP_PREFETCH_BYTES (48*1024)
+static int      mpPrefNum = -1;       // Track num open in mySD1, -1 = none
+static bool     mpPrefDone = false;   // Prefetch attempted for current track
+static mpIdxEntry mpPrefEntry;
+
+// Music folder renamer
+#define MPREN_CHUNK_BUF  4096   // Name buffer for one sort run
+#define MPREN_CHUNK_NUM  64     // Max names in one sort run
+#define MPREN_LINE_LEN   256
+#define MPREN_AVAIL_NUM  8      // Background: Player available after this many files
+enum {
+    MPR_IDLE = 0,               // Phase numbers are stored in journal
+    MPR_SCAN,
+    MPR_MERGE,
+    MPR_RENAME,
+    MPR_INDEX,
+    MPR_FINISH
+};
+#define MPR_RUN     0
+#define MPR_JOURNAL 1
+typedef struct {
+    int           runFirst;     // Oldest run file
+    int           runNext;      // Next run file to be written
+    int           count;        // Next target file number
+    int           fileNum;      // Number of files to rename
+    int           renamed;      // Files renamed/indexed
+    unsigned long pos;          // Position in sorted list
+} mpRenJournal;
+static struct {
+    int           phase = MPR_IDLE;
+    int           folder;
+    bool          isSetup;
+    bool          background;
+    bool          indexOK;
+    bool          mergeOpen;
+    bool          have1, have2;
+    int           nameOffs;
+    int           chunkNum;
+    int           chunkUsed;
+    char          *buf = NULL;
+    char          **names = NULL;
+    File          in1, in2, out;
+    mpRenJournal  v;
+} mpr;
+#ifdef TC_DBG_MP
+static const char *mprenName = "MusicPlayer/Renamer: ";
+#endif
+
 static const float volTable[20] = {
     0.00f, 0.02f, 0.04f, 0.06f,
     0.08f, 0.10f, 0.13f, 0.16f,
@@ -183,6 +248,7 @@ static char     keySnd[] = "/key3.mp3";   // not const
 static uint32_t haveKeySnd = 0;
 
 static const char *tcdrdone = "/TCD_DONE.TXT";
+static const char *tcdridx  = "/TCD_IDX.BIN";
 bool          headLineShown = false;
 bool          blinker       = true;
 unsigned long renNow1, renNow2;
@@ -212,9 +278,36 @@ static void   mp_nextprev(bool forcePlay, bool next);
 static bool   mp_play_int(bool force);
 static void   mp_buildFileName(char *fnbuf, int num);
 static bool   mp_renameFilesInDir(bool isSetup);
-static void   mpren_quickSort(char **a, int s, int e);
+static void   mp_setupPlayList();
+static bool   mpren_start(int num, bool isSetup);
+static bool   mpren_enter(int phase);
+static void   mpren_abort();
+static void   mpren_scanStep();
+static void   mpren_mergeStep();
+static void   mpren_renameStep();
+static void   mpren_indexStep();
+static void   mpren_finish();
+static void   mpren_refreshPlayer(int num, bool withIdx);
+static void   mpren_buildName(char *fnbuf, int type, int num);
+static void   mpren_removeRun(int num);
+static void   mpren_writeJournal();
+static bool   mpren_readLine(File& f, char *buf);
+static void   mpren_closeAll();
+static void   mpren_freeBufs();
+static bool   mpren_strLT(const char *a, const char *b);
+static void   mpren_sort(char **a, int num);
+static bool   mp_indexEntry(File& idx, int num, char *id3, mpIdxEntry& e);
+static bool   mp_indexEnd(File& idx, bool ok, int count);
+static bool   mp_loadIndex();
+static bool   mp_writeIndex(int count, bool isSetup);
+static bool   mp_readIndex(int num, mpIdxEntry *e);
+static void   mp_prefetch();
+static void   mp_prefetchClose();
+static bool   mp_chainNext();
+static void   mpren_looper(bool isSetup, bool checking, int fileNum);
 
 static void   decodeID3(char *artist, char *track, char *id3, int id3size);
+static bool   play_file_int(const char *audio_file, uint32_t flags, float volumeFactor, const mpIdxEntry *idx);
 
 #include "tc_beep.h"
 
@@ -248,13 +341,15 @@ void audio_setup()
     out->SetOutputModeMono(false); 
     out->SetPinout(I2S_BCLK_PIN, I2S_LRCLK_PIN, I2S_DIN_PIN);
 
-    mp3 = new AudioGeneratorMP3();
+    // Synthesize whole frames (allocated on begin(), like the default)
+    mp3 = new AudioGeneratorMP3(NULL, 0, true);
     wav = new AudioGeneratorWAVP();
 
     myFS0 = new AudioFileSourceFSLoop();
     
     if(haveSD) {
         mySD0 = new AudioFileSourceSDLoop();
+        mySD1 = new AudioFileSourceSDLoop();
     }
 
     myPM = new AudioFileSourcePROGMEM();
@@ -306,17 +401,25 @@ void audio_loop()
         }
     } else if(mp3->isRunning()) {
         if(!mp3->loop()) {
+            if(mpActive && mp_chainNext()) {
+                return;
+            }
             mp3->stop();
             key_playing = 0;
             clear_sig_playing(alarmCanRunOut);
             if(mpActive) {
                 mp_next(true);
             }
-        } else if(dynVol) {
-            sampleCnt++;
-            if(sampleCnt > 1) {
-                out->SetGain(getVolume(), mutechannels);
-                sampleCnt = 0;
+        } else {
+            if(dynVol) {
+                sampleCnt++;
+                if(sampleCnt > 1) {
+                    out->SetGain(getVolume(), mutechannels);
+                    sampleCnt = 0;
+                }
+            }
+            if(mpActive && !mpPrefDone) {
+                mp_prefetch();
             }
         }
     } else if(mpActive) {
@@ -343,19 +446,27 @@ static int skipID3(char *buf)
 }
 
 void play_file(const char *audio_file, uint32_t flags, float volumeFactor)
+{
+    play_file_int(audio_file, flags, volumeFactor, NULL);
+}
+
+// idx: Music player index entry; if given, audio data position and
+// ID3 info are taken from there instead of reading the ID3 tag.
+// Returns true if the file was found.
+static bool play_file_int(const char *audio_file, uint32_t flags, float volumeFactor, const mpIdxEntry *idx)
 {
     char buf[10];
     int32_t pos = 0;
 
     // Only signals can interrupt signals
     if(sig_playing & PA_SIGNAL) {
-        if(!(flags & PA_SIGNAL)) return;
+        if(!(flags & PA_SIGNAL)) return false;
     }
     
     if(flags & PA_INTRMUS) {
         mpActive = false;
     } else {
-        if(mpActive) return;
+        if(mpActive) return false;
     }
 
     pwrNeedFullNow();
@@ -368,6 +479,9 @@ void play_file(const char *audio_file, uint32_t flags, float volumeFactor)
     stopAudio();
     beepRunning = false;
 
+    // Any pre-opened next track is now stale
+    mp_prefetchClose();
+
     mutechannels = alarmCanRunOut = 0;
 
     playLineOut = (haveLineOut && useLineOut && (flags & PA_LINEOUT)) ? true : false;
@@ -411,7 +525,11 @@ void play_file(const char *audio_file, uint32_t flags, float volumeFactor)
         if(flags & PA_ISWAV) {
             wav->begin(mySD0, out);
         } else {
-            if(flags & PA_DOID3TS) {
+            if(idx) {
+                memcpy(id3artist, idx->artist, sizeof(id3artist));
+                memcpy(id3track, idx->track, sizeof(id3track));
+                mySD0->seek(idx->pos, SEEK_SET);
+            } else if(flags & PA_DOID3TS) {
                 char *id3 = (char *)malloc(MAXID3LEN);
                 if(id3) {
                     id3[0] = 0;
@@ -463,7 +581,10 @@ void play_file(const char *audio_file, uint32_t flags, float volumeFactor)
         #ifdef TC_DBG_AUDIO
         Serial.println("Audio file not found");
         #endif
+        return false;
     }
+
+    return true;
 }
 
 /*
@@ -521,6 +642,14 @@ void play_hour_sound(int hour)
     }
 }
 
+// Will play_hour_sound() play anything for this hour?
+bool have_hour_sound(int hour)
+{
+    if(mpActive) return false;
+    
+    return !!(haveSpHrSnd & ((1 << hour) | HHS_HAVEHRSOUND));
+}
+
 void play_beep()
 {
     bool wavRunning = wav->isRunning();
@@ -1011,41 +1140,68 @@ void mp_init(bool isSetup)
         Serial.println("MusicPlayer: Checking for music files");
         #endif
 
-        mp_renameFilesInDir(isSetup);
+        // Renamer might continue in background
+        bool renBg = !mp_renameFilesInDir(isSetup) && (mpr.phase != MPR_IDLE);
 
-        mp_buildFileName(fnbuf, 0);
-        if(SD.exists(fnbuf)) {
+        mp_prefetchClose();
+
+        mpHaveIdx = false;
+
+        if(!renBg && (mpHaveIdx = mp_loadIndex())) {
+            // maxMusic set from index
             haveMusic = true;
-            
-            maxMusic = mp_findMaxNum();
             #ifdef TC_DBG_MP
-            Serial.printf("MusicPlayer: last file num %d\n", maxMusic);
+            Serial.printf("MusicPlayer: Index: last file num %d\n", maxMusic);
             #endif
-
-            playList = (uint16_t *)malloc((maxMusic + 1) * 2);
-
-            if(!playList) {
-
-                haveMusic = false;
+        } else {
+            mp_buildFileName(fnbuf, 0);
+            if(SD.exists(fnbuf)) {
+                haveMusic = true;
+                maxMusic = mp_findMaxNum();
                 #ifdef TC_DBG_MP
-                Serial.println("MusicPlayer: Failed to allocate PlayList");
+                Serial.printf("MusicPlayer: last file num %d\n", maxMusic);
                 #endif
-
-            } else {
-
-                // Init play list
-                mp_makeShuffle(mpShuffle);
-                
+                // Build index for next time (eg. after firmware update)
+                if(!renBg) {
+                    mpHaveIdx = mp_writeIndex(maxMusic + 1, isSetup);
+                }
             }
+        }
 
+        if(haveMusic) {
+            mp_setupPlayList();
         } else {
             #ifdef TC_DBG_MP
-            Serial.printf("MusicPlayer: Failed to open %s\n", fnbuf);
+            Serial.println("MusicPlayer: No music files found");
             #endif
         }
     }
 }
 
+static void mp_setupPlayList()
+{
+    if(playList) {
+        free(playList);
+        playList = NULL;
+    }
+
+    playList = (uint16_t *)malloc((maxMusic + 1) * 2);
+
+    if(!playList) {
+
+        haveMusic = false;
+        #ifdef TC_DBG_MP
+        Serial.println("MusicPlayer: Failed to allocate PlayList");
+        #endif
+
+    } else {
+
+        // Init play list
+        mp_makeShuffle(mpShuffle);
+        
+    }
+}
+
 static bool mp_checkForFile(int num)
 {
     char fnbuf[20];
@@ -1134,6 +1290,8 @@ bool mp_stop()
         mpActive = false;
         *id3artist = *id3track = 0;
     }
+
+    mp_prefetchClose();
     
     return ret;
 }
@@ -1194,8 +1352,20 @@ int mp_gotonum(int num, bool forcePlay)
 static bool mp_play_int(bool force)
 {
     char fnbuf[20];
+    mpIdxEntry e;
 
     mp_buildFileName(fnbuf, playList[mpCurrIdx]);
+
+    // With index: No need to probe or read ID3 tag
+    if(mpHaveIdx && mp_readIndex(playList[mpCurrIdx], &e)) {
+        if(force) {
+            if(!play_file_int(fnbuf, PA_LINEOUT|PA_CHECKNM|PA_INTRMUS|PA_ALLOWSD|PA_DYNVOL, 1.0f, &e))
+                return false;
+        }
+        currPlaying = playList[mpCurrIdx];
+        return true;
+    }
+    
     if(SD.exists(fnbuf)) {
         if(force) play_file(fnbuf, PA_LINEOUT|PA_DOID3TS|PA_CHECKNM|PA_INTRMUS|PA_ALLOWSD|PA_DYNVOL);
         currPlaying = playList[mpCurrIdx];
@@ -1217,6 +1387,269 @@ static void mp_buildFileName(char *fnbuf, int num)
     sprintf(fnbuf, "/music%1d/%03d.mp3", musFolderNum, num);
 }
 
+/*
+ * Music library index
+ *
+ * /musicX/TCD_IDX.BIN holds a header (magic, version, track count)
+ * followed by one mpIdxEntry per track (audio data position, artist
+ * and title). It is written by the renamer; the header's magic is
+ * written last so that an interrupted write leaves an invalid index.
+ */
+
+static void mp_buildIdxName(char *fnbuf, int folder)
+{
+    sprintf(fnbuf, "/music%1d%s", folder, tcdridx);
+}
+
+static bool mp_loadIndex()
+{
+    char fnbuf[32];
+    mpIdxHdr h;
+    bool ret = false;
+
+    mp_buildIdxName(fnbuf, musFolderNum);
+
+    File file = SD.open(fnbuf, FILE_READ);
+    if(!file) return false;
+
+    if((file.read((uint8_t *)&h, sizeof(h)) == sizeof(h)) &&
+       h.magic == MPIDX_MAGIC && h.version == MPIDX_VERSION &&
+       h.count > 0 && h.count <= 1000 &&
+       file.size() >= sizeof(h) + (h.count * sizeof(mpIdxEntry))) {
+        ret = true;
+    }
+    file.close();
+
+    if(!ret) return false;
+
+    // Quick sanity check: Last file must exist, next must not
+    mp_buildFileName(fnbuf, h.count - 1);
+    if(!SD.exists(fnbuf)) return false;
+    if(h.count < 1000) {
+        mp_buildFileName(fnbuf, h.count);
+        if(SD.exists(fnbuf)) return false;
+    }
+
+    maxMusic = h.count - 1;
+
+    return true;
+}
+
+static bool mp_readIndex(int num, mpIdxEntry *e)
+{
+    char fnbuf[32];
+    bool ret = false;
+
+    mp_buildIdxName(fnbuf, musFolderNum);
+
+    File file = SD.open(fnbuf, FILE_READ);
+    if(!file) return false;
+
+    if(file.seek(sizeof(mpIdxHdr) + (num * sizeof(mpIdxEntry)))) {
+        ret = (file.read((uint8_t *)e, sizeof(mpIdxEntry)) == sizeof(mpIdxEntry));
+    }
+    file.close();
+
+    e->artist[sizeof(e->artist) - 1] = 0;
+    e->track[sizeof(e->track) - 1] = 0;
+
+    return ret;
+}
+
+// Index is written in three steps so the renamer can do it
+// incrementally. Files are taken from the current music folder.
+static bool mp_indexBegin(File& idx, int count)
+{
+    char fnbuf[32];
+    mpIdxHdr h = { 0, MPIDX_VERSION, 0 };
+
+    if(count <= 0 || count > 1000) return false;
+
+    mp_buildIdxName(fnbuf, musFolderNum);
+    if(!(idx = SD.open(fnbuf, FILE_WRITE)))
+        return false;
+
+    // Header with invalid magic; fixed up at end
+    h.count = count;
+    return (idx.write((uint8_t *)&h, sizeof(h)) == sizeof(h));
+}
+
+// id3: Buffer of MAXID3LEN bytes
+static bool mp_indexEntry(File& idx, int num, char *id3, mpIdxEntry& e)
+{
+    char fnbuf[20];
+
+    memset((void *)&e, 0, sizeof(e));
+
+    mp_buildFileName(fnbuf, num);
+    File file = SD.open(fnbuf, FILE_READ);
+    if(!file) {
+        // Gap; index is useless
+        return false;
+    }
+
+    int32_t pos;
+    if((file.read((uint8_t *)id3, 10) == 10) && (pos = skipID3(id3))) {
+        int Id3Size = pos <= MAXID3LEN ? pos : MAXID3LEN;
+        file.read((uint8_t *)id3 + 10, Id3Size - 10);
+        decodeID3(e.artist, e.track, id3, Id3Size);
+        e.pos = pos;
+    }
+    file.close();
+
+    return (idx.write((uint8_t *)&e, sizeof(e)) == sizeof(e));
+}
+
+static bool mp_indexEnd(File& idx, bool ok, int count)
+{
+    char fnbuf[32];
+    mpIdxHdr h = { MPIDX_MAGIC, MPIDX_VERSION, (uint16_t)count };
+
+    if(ok) {
+        ok = idx.seek(0) && (idx.write((uint8_t *)&h, sizeof(h)) == sizeof(h));
+    }
+    idx.close();
+
+    if(!ok) {
+        mp_buildIdxName(fnbuf, musFolderNum);
+        SD.remove(fnbuf);
+    }
+
+    #ifdef TC_DBG_MP
+    Serial.printf("MusicPlayer/Index: %s\n", ok ? "written" : "failed");
+    #endif
+
+    return ok;
+}
+
+// Build index for files 000-(count-1) in current music folder
+static bool mp_writeIndex(int count, bool isSetup)
+{
+    File idx;
+    mpIdxEntry e;
+    bool ret = true;
+
+    char *id3 = (char *)malloc(MAXID3LEN);
+    if(!id3) return false;
+
+    if(!mp_indexBegin(idx, count)) {
+        if(idx) idx.close();
+        free(id3);
+        return false;
+    }
+
+    headLineShown = false;
+    blinker = true;
+    renNow1 = renNow2 = millis();
+
+    for(int i = 0; i < count && ret; i++) {
+        mpren_looper(isSetup, true, count - i);
+        ret = mp_indexEntry(idx, i, id3, e);
+    }
+
+    free(id3);
+
+    ret = mp_indexEnd(idx, ret, count);
+
+    // Clear displays
+    if(headLineShown) {
+        destinationTime.showTextDirect("");
+        presentTime.showTextDirect("");
+        departedTime.showTextDirect("");
+    }
+
+    return ret;
+}
+
+/*
+ * Gapless playback
+ *
+ * Towards the end of the current track, the next one is opened and
+ * positioned past its ID3 tag (info from the index). When the current
+ * track ends, the MP3 decoder continues with the new source without
+ * stopping the output.
+ */
+
+static void mp_prefetch()
+{
+    char fnbuf[20];
+    int nextIdx;
+
+    if(!mpHaveIdx || !haveMusic) {
+        mpPrefDone = true;
+        return;
+    }
+
+    // Wait until we are close to the end of the current track
+    if(mySD0->getSize() - mySD0->getPos() > MP_PREFETCH_BYTES)
+        return;
+
+    mpPrefDone = true;
+
+    nextIdx = mpCurrIdx + 1;
+    if(nextIdx > maxMusic) nextIdx = 0;
+
+    if(!mp_readIndex(playList[nextIdx], &mpPrefEntry))
+        return;
+
+    mp_buildFileName(fnbuf, playList[nextIdx]);
+    if(!mySD1->open(fnbuf))
+        return;
+
+    mySD1->setPlayLoop(false);
+    mySD1->setStartPos(0);
+    mySD1->seek(mpPrefEntry.pos, SEEK_SET);
+
+    mpPrefNum = playList[nextIdx];
+
+    #ifdef TC_DBG_MP
+    Serial.printf("MusicPlayer: Prefetched %s\n", fnbuf);
+    #endif
+}
+
+static void mp_prefetchClose()
+{
+    if(mpPrefNum >= 0) {
+        mySD1->close();
+        mpPrefNum = -1;
+    }
+    mpPrefDone = false;
+}
+
+static bool mp_chainNext()
+{
+    AudioFileSourceSDLoop *t;
+    int nextIdx;
+
+    if(mpPrefNum < 0 || isSignalPlaying()) {
+        mp_prefetchClose();
+        return false;
+    }
+
+    nextIdx = mpCurrIdx + 1;
+    if(nextIdx > maxMusic) nextIdx = 0;
+
+    // Playlist changed meanwhile (shuffle)?
+    if(playList[nextIdx] != mpPrefNum || !mp3->beginGapless(mySD1)) {
+        mp_prefetchClose();
+        return false;
+    }
+
+    t = mySD0;
+    mySD0 = mySD1;
+    mySD1 = t;
+
+    mpPrefNum = -1;
+    mpPrefDone = false;
+
+    mpCurrIdx = nextIdx;
+    currPlaying = playList[mpCurrIdx];
+    memcpy(id3artist, mpPrefEntry.artist, sizeof(id3artist));
+    memcpy(id3track, mpPrefEntry.track, sizeof(id3track));
+
+    return true;
+}
+
 // For keypad menu only
 int mp_checkForFolder(int num)
 {
@@ -1233,6 +1666,15 @@ int mp_checkForFolder(int num)
     if(num < 0 || num > 9)
         return 0;
 
+    // Shortcut: Index and DONE exist => ready
+    mp_buildIdxName(fnbuf, num);
+    if(SD.exists(fnbuf)) {
+        sprintf(fnbuf, "/music%1d%s", num, tcdrdone);
+        if(SD.exists(fnbuf)) {
+            return 1;
+        }
+    }
+
     // If folder does not exist, return 0
     sprintf(fnbuf, "/music%1d", num);
     if(!SD.exists(fnbuf))
@@ -1361,56 +1803,152 @@ static void mpren_looper(bool isSetup, bool checking, int fileNum)
     }
 }
 
+/*
+ * The renamer works in bounded memory and can be interrupted at any
+ * time (power loss, folder change) and resumed later:
+ *
+ * SCAN:   Eligible file names are collected in chunks of up to
+ *         MPREN_CHUNK_NUM names/MPREN_CHUNK_BUF bytes; each chunk is
+ *         sorted and written to a run file (TCD_Rnnn.TMP).
+ * MERGE:  The two oldest runs are merged into a new one until only
+ *         one (the sorted list) is left. Only two inputs and one output
+ *         are open at any time.
+ * RENAME: Files are renamed in the order of the sorted list.
+ * INDEX:  The music library index is written.
+ *
+ * The journal (TCD_JRNL.TXT) records phase, run numbers, next target
+ * number and position in the sorted list. It is rewritten after each
+ * run, each merge and each rename. SCAN is restarted from scratch on
+ * resume, everything else continues where it stopped.
+ */
+
+static bool mpren_doStep()
+{
+    int phase = mpr.phase;
+
+    switch(phase) {
+    case MPR_SCAN:
+        mpren_scanStep();
+        break;
+    case MPR_MERGE:
+        mpren_mergeStep();
+        break;
+    case MPR_RENAME:
+        mpren_renameStep();
+        break;
+    case MPR_INDEX:
+        mpren_indexStep();
+        break;
+    case MPR_FINISH:
+        mpren_finish();
+        break;
+    }
+
+    return (mpr.phase != MPR_IDLE);
+}
+
 static bool mp_renameFilesInDir(bool isSetup)
 {
-    char fnbuf[20];
-    char fnbuf3[32];
-    char fnbuf2[256];
-    char **a, **d;
-    char *c;
+    char fnbuf[32];
     int num = musFolderNum;
-    int count = 0;
-    int fileNum = 0;
-    int strLength;
-    int nameOffs = 8;
-    int allocBufIdx = 0;
-    const unsigned long bufSizes[8] = {
-        16384, 16384, 8192, 8192, 8192, 8192, 8192, 4096 
-    };
-    char *bufs[8] = { NULL };
-    unsigned long sz, bufSize;
-    bool stopLoop = false;
     bool hls = false;
-#ifdef HAVE_GETNEXTFILENAME
-    bool isDir;
-#endif
-    #ifdef TC_DBG_MP
-    const char *funcName = "MusicPlayer/Renamer: ";
+
+    // Renamer for another folder running in background? Stop it,
+    // it resumes from its journal when that folder is used again.
+    if(mpr.phase != MPR_IDLE) {
+        if(mpr.folder == num) {
+            if(mpr.background) return false;
+        } else {
+            mpren_abort();
+        }
+    }
+
+    // Check for DONE file
+    sprintf(fnbuf, "/music%1d%s", num, tcdrdone);
+    if(SD.exists(fnbuf)) {
+        #ifdef TC_DBG_MP
+        Serial.printf("%s%s exists\n", mprenName, fnbuf);
+        #endif
+        return true;
+    }
+
+    if(!mpren_start(num, isSetup)) {
+        return false;
+    }
+
+    #ifdef TC_BG_RENAMER
+    if(isSetup) {
+        mpr.background = true;
+        #ifdef TC_DBG_MP
+        Serial.printf("%sRunning in background\n", mprenName);
+        #endif
+        return false;
+    }
     #endif
 
     headLineShown = false;
     blinker = true;
     renNow1 = renNow2 = millis();
 
-    // Build "DONE"-file name
-    sprintf(fnbuf, "/music%1d", num);
-    strcpy(fnbuf3, fnbuf);
-    strcat(fnbuf3, tcdrdone);
+    while(mpren_doStep()) {
+        mpren_looper(isSetup, (mpr.phase != MPR_RENAME),
+                     (mpr.phase == MPR_RENAME) ? mpr.v.fileNum - mpr.v.renamed : 0);
+        if(mpr.phase == MPR_RENAME && !hls) {
+            // Trigger head line change
+            if((hls = headLineShown)) {
+                renNow2 = 0;
+                headLineShown = false;
+            }
+        }
+    }
 
-    // Check for DONE file
-    if(SD.exists(fnbuf3)) {
-        #ifdef TC_DBG_MP
-        Serial.printf("%s%s exists\n", funcName, fnbuf3);
-        #endif
-        return true;
+    // Clear displays
+    if(hls || headLineShown) {
+        destinationTime.showTextDirect("");
+        presentTime.showTextDirect("");
+        departedTime.showTextDirect("");
     }
 
-    // Check if folder exists
+    return true;
+}
+
+/*
+ * mp_renamer_loop()
+ *
+ * Runs background renamer steps for a few ms, if active.
+ */
+void mp_renamer_loop()
+{
+    unsigned long now;
+    unsigned long budget;
+
+    if(mpr.phase == MPR_IDLE || !mpr.background)
+        return;
+
+    // Stay out of the way during time travel
+    if(csf & (CSF_P0|CSF_P1|CSF_RE|CSF_P2|CSF_ST))
+        return;
+
+    budget = mp3->isRunning() ? 3 : 15;
+    now = millis();
+
+    do {
+        if(!mpren_doStep()) break;
+    } while(millis() - now < budget);
+}
+
+static bool mpren_start(int num, bool isSetup)
+{
+    char fnbuf[32];
+    int phase = MPR_SCAN;
+    int runFirst = 0, runNext = 0, count = 0, fileNum = 0, renamed = 0;
+    unsigned long pos = 0;
+
+    // Check if folder exists and is actually a folder
+    sprintf(fnbuf, "/music%1d", num);
     if(!SD.exists(fnbuf)) {
         return false;
     }
-
-    // Open folder and check if it is actually a folder
     File origin = SD.open(fnbuf);
     if(!origin) {
         return false;
@@ -1419,212 +1957,481 @@ static bool mp_renameFilesInDir(bool isSetup)
         origin.close();
         return false;
     }
-        
-    // Allocate pointer array
-    if(!(a = (char **)malloc(1000*sizeof(char *)))) {
-        origin.close();
-        return false;
+    origin.close();
+
+    memset((void *)&mpr.v, 0, sizeof(mpr.v));
+    mpr.folder = num;
+    mpr.isSetup = isSetup;
+    mpr.background = false;
+
+    // Index will be stale
+    mp_buildIdxName(fnbuf, num);
+    if(SD.exists(fnbuf)) {
+        SD.remove(fnbuf);
     }
 
-    // Allocate (first) buffer for file names
-    if(!(bufs[0] = (char *)malloc(bufSizes[0]))) {
-        origin.close();
-        free(a);
-        return false;
+    // Check for journal of interrupted run
+    mpren_buildName(fnbuf, MPR_JOURNAL, 0);
+    File jf = SD.open(fnbuf, FILE_READ);
+    if(jf) {
+        char jbuf[64];
+        int l = jf.read((uint8_t *)jbuf, sizeof(jbuf) - 1);
+        jf.close();
+        jbuf[l > 0 ? l : 0] = 0;
+        if(sscanf(jbuf, "%d %d %d %d %d %d %lu", &phase, &runFirst, &runNext,
+                        &count, &fileNum, &renamed, &pos) != 7) {
+            phase = MPR_SCAN;
+        }
+        #ifdef TC_DBG_MP
+        Serial.printf("%sResuming: phase %d, runs %d-%d\n", mprenName, phase, runFirst, runNext);
+        #endif
+    }
+
+    mpr.v.runFirst = runFirst;
+    mpr.v.runNext = runNext;
+    mpr.v.count = count;
+    mpr.v.fileNum = fileNum;
+    mpr.v.renamed = renamed;
+    mpr.v.pos = pos;
+
+    switch(phase) {
+    case MPR_MERGE:
+        // Output of interrupted merge is incomplete
+        mpren_removeRun(runNext);
+        break;
+    case MPR_RENAME:
+    case MPR_INDEX:
+        break;
+    default:
+        // Scan is restarted; remove runs written so far
+        for(int i = runFirst; i <= runNext; i++) {
+            mpren_removeRun(i);
+        }
+        mpr.v.runFirst = mpr.v.runNext = 0;
+        mpr.v.fileNum = 0;
+        phase = MPR_SCAN;
+    }
+
+    return mpren_enter(phase);
+}
+
+static void mpren_abort()
+{
+    mpren_closeAll();
+    mpren_freeBufs();
+    mpr.phase = MPR_IDLE;
+}
+
+// Set up for new phase
+static bool mpren_enter(int phase)
+{
+    char fnbuf[32];
+
+    mpren_closeAll();
+    mpren_freeBufs();
+
+    mpr.phase = phase;
+
+    switch(phase) {
+    case MPR_SCAN:
+        if(!(mpr.buf = (char *)malloc(MPREN_CHUNK_BUF)) ||
+           !(mpr.names = (char **)malloc(MPREN_CHUNK_NUM * sizeof(char *)))) {
+            break;
+        }
+        sprintf(fnbuf, "/music%1d", mpr.folder);
+        if(!(mpr.in1 = SD.open(fnbuf))) {
+            break;
+        }
+        mpr.nameOffs = -1;
+        mpr.chunkNum = mpr.chunkUsed = 0;
+        mpren_writeJournal();
+        return true;
+
+    case MPR_MERGE:
+        // Zero or one runs: No merging required
+        if(mpr.v.runNext - mpr.v.runFirst <= 1) {
+            return mpren_enter(mpr.v.runNext > mpr.v.runFirst ? MPR_RENAME : MPR_INDEX);
+        }
+        if(!(mpr.buf = (char *)malloc(MPREN_LINE_LEN * 2))) {
+            break;
+        }
+        mpr.mergeOpen = false;
+        mpren_writeJournal();
+        return true;
+
+    case MPR_RENAME:
+        if(!(mpr.buf = (char *)malloc(MPREN_LINE_LEN))) {
+            break;
+        }
+        mpren_buildName(fnbuf, MPR_RUN, mpr.v.runFirst);
+        if(!(mpr.in1 = SD.open(fnbuf, FILE_READ))) {
+            break;
+        }
+        if(!mpr.v.pos) {
+            // Fresh start: If 000.mp3 exists, find current count
+            // the usual way. Otherwise start at 000.
+            mp_buildFileName(fnbuf, 0);
+            mpr.v.count = SD.exists(fnbuf) ? mp_findMaxNum() + 1 : 0;
+            mpr.v.renamed = 0;
+        } else {
+            mpr.in1.seek(mpr.v.pos);
+        }
+        mpren_writeJournal();
+        return true;
+
+    case MPR_INDEX:
+        mp_buildFileName(fnbuf, 0);
+        if(!SD.exists(fnbuf)) {
+            return mpren_enter(MPR_FINISH);
+        }
+        mpr.v.count = mp_findMaxNum() + 1;
+        mpr.v.renamed = 0;
+        mpren_writeJournal();
+        if(!mp_indexBegin(mpr.out, mpr.v.count) ||
+           !(mpr.buf = (char *)malloc(MAXID3LEN))) {
+            // Proceed without index
+            return mpren_enter(MPR_FINISH);
+        }
+        return true;
+
+    case MPR_FINISH:
+        return true;
+    }
+
+    // Out of memory or SD error: Give up for now; journal is
+    // left in place, so we resume next time
+    #ifdef TC_DBG_MP
+    Serial.printf("%sFailed to enter phase %d\n", mprenName, phase);
+    #endif
+    mpren_abort();
+    return false;
+}
+
+// Sort current chunk, write it as a run file
+static bool mpren_flushChunk()
+{
+    char fnbuf[32];
+
+    if(!mpr.chunkNum)
+        return true;
+
+    mpren_sort(mpr.names, mpr.chunkNum);
+
+    mpren_buildName(fnbuf, MPR_RUN, mpr.v.runNext);
+    File run = SD.open(fnbuf, FILE_WRITE);
+    if(!run) return false;
+    for(int i = 0; i < mpr.chunkNum; i++) {
+        run.print(mpr.names[i]);
+        run.write('\n');
     }
+    run.close();
+
+    #ifdef TC_DBG_MP
+    Serial.printf("%sWrote run %d (%d names)\n", mprenName, mpr.v.runNext, mpr.chunkNum);
+    #endif
 
-    c = bufs[0];
-    bufSize = bufSizes[0];
-    d = a;
+    mpr.v.runNext++;
+    mpr.chunkNum = mpr.chunkUsed = 0;
 
-    // Loop through all files in folder
+    mpren_writeJournal();
 
+    return true;
+}
+
+// Process one directory entry
+static void mpren_scanStep()
+{
+    const char *fn;
+    bool haveEntry;
 #ifdef HAVE_GETNEXTFILENAME
-    String fileName = origin.getNextFileName(&isDir);
-    // Check if File::name() returns FQN or plain name
-    if(fileName.length() > 0) nameOffs = (fileName.charAt(0) == '/') ? 8 : 0;
-    while(!stopLoop && fileName.length() > 0)
+    bool isDir;
+    String fileName = mpr.in1.getNextFileName(&isDir);
+    haveEntry = (fileName.length() > 0);
+    fn = fileName.c_str();
 #else
-    File file = origin.openNextFile();
-    // Check if File::name() returns FQN or plain name
-    if(file) nameOffs = (file.name()[0] == '/') ? 8 : 0;
-    while(!stopLoop && file)
+    File file = mpr.in1.openNextFile();
+    bool isDir = false;
+    haveEntry = !!file;
+    if(haveEntry) isDir = file.isDirectory();
+    fn = haveEntry ? file.name() : "";
 #endif
-    {
 
-        mpren_looper(isSetup, true, 0);
+    if(haveEntry) {
 
-#ifdef HAVE_GETNEXTFILENAME
+        // Check if File::name() returns FQN or plain name
+        if(mpr.nameOffs < 0) mpr.nameOffs = (fn[0] == '/') ? 8 : 0;
 
-        if(!isDir) {
-            const char *fn = fileName.c_str();
-            strLength = strlen(fn);
-            sz = strLength - nameOffs + 1;
-            if((sz > bufSize) && (allocBufIdx < 7)) {
-                allocBufIdx++;
-                if(!(bufs[allocBufIdx] = (char *)malloc(bufSizes[allocBufIdx]))) {
-                    #ifdef TC_DBG_MP
-                    Serial.printf("%sFailed to allocate additional sort buffer\n", funcName);
-                    #endif
-                } else {
-                    #ifdef TC_DBG_MP
-                    Serial.printf("%sAllocated additional sort buffer\n", funcName);
-                    #endif
-                    c = bufs[allocBufIdx];
-                    bufSize = bufSizes[allocBufIdx];
-                }
-            }
-            if((strLength < 256) && (sz <= bufSize)) {
-                if(!mpren_checkFN(fn + nameOffs)) {
-                    *d++ = c;
-                    strcpy(c, fn + nameOffs);
-                    #ifdef TC_DBG_MP
-                    Serial.printf("%sAdding '%s'\n", funcName, c);
-                    #endif
-                    c += sz;
-                    bufSize -= sz;
-                    fileNum++;
-                }
-            } else if(sz > bufSize) {
-                stopLoop = true;
-                #ifdef TC_DBG_MP
-                Serial.printf("%sSort buffer(s) exhausted, remaining files ignored\n", funcName);
-                #endif
-            }
-        }
-        
-#else // --------------
-
-        if(!file.isDirectory()) {
-            strLength = strlen(file.name());
-            sz = strLength - nameOffs + 1;
-            if((sz > bufSize) && (allocBufIdx < 7)) {
-                allocBufIdx++;
-                if(!(bufs[allocBufIdx] = (char *)malloc(bufSizes[allocBufIdx]))) {
-                    #ifdef TC_DBG_MP
-                    Serial.printf("%sFailed to allocate additional sort buffer\n", funcName);
-                    #endif
-                } else {
-                    #ifdef TC_DBG_MP
-                    Serial.printf("%sAllocated additional sort buffer\n", funcName);
-                    #endif
-                    c = bufs[allocBufIdx];
-                    bufSize = bufSizes[allocBufIdx];
-                }
-            }
-            if((strLength < 256) && (sz <= bufSize)) {
-                if(!mpren_checkFN(file.name() + nameOffs)) {
-                    *d++ = c;
-                    strcpy(c, file.name() + nameOffs);
-                    #ifdef TC_DBG_MP
-                    Serial.printf("%sAdding '%s'\n", funcName, c);
+        int strLength = strlen(fn);
+        int sz = strLength - mpr.nameOffs + 1;
+
+        if(!isDir && (strLength < MPREN_LINE_LEN - 1) && !mpren_checkFN(fn + mpr.nameOffs)) {
+            if((mpr.chunkNum >= MPREN_CHUNK_NUM) || (mpr.chunkUsed + sz > MPREN_CHUNK_BUF)) {
+                if(!mpren_flushChunk()) {
+                    #ifndef HAVE_GETNEXTFILENAME
+                    file.close();
                     #endif
-                    c += sz;
-                    bufSize -= sz;
-                    fileNum++;
+                    mpren_abort();
+                    return;
                 }
-            } else if(sz > bufSize) {
-                stopLoop = true;
-                #ifdef TC_DBG_MP
-                Serial.printf("%sSort buffer(s) exhausted, remaining files ignored\n", funcName);
-                #endif
             }
+            char *c = mpr.buf + mpr.chunkUsed;
+            strcpy(c, fn + mpr.nameOffs);
+            mpr.names[mpr.chunkNum++] = c;
+            mpr.chunkUsed += sz;
+            mpr.v.fileNum++;
+            #ifdef TC_DBG_MP
+            Serial.printf("%sAdding '%s'\n", mprenName, c);
+            #endif
         }
+
+        #ifndef HAVE_GETNEXTFILENAME
         file.close();
-        
-#endif
-        
-        if(fileNum >= 1000) stopLoop = true;
+        #endif
+    }
 
-        if(!stopLoop) {
-            #ifdef HAVE_GETNEXTFILENAME
-            fileName = origin.getNextFileName(&isDir);
-            #else
-            file = origin.openNextFile();
-            #endif
+    if(!haveEntry || mpr.v.fileNum >= 1000) {
+        if(!mpren_flushChunk()) {
+            mpren_abort();
+            return;
+        }
+        #ifdef TC_DBG_MP
+        Serial.printf("%s%d files to process\n", mprenName, mpr.v.fileNum);
+        #endif
+        mpren_enter(MPR_MERGE);
+    }
+}
+
+// Merge a number of lines of the two oldest runs
+static void mpren_mergeStep()
+{
+    char fnbuf[32];
+    char *l1 = mpr.buf;
+    char *l2 = mpr.buf + MPREN_LINE_LEN;
+
+    if(!mpr.mergeOpen) {
+        mpren_buildName(fnbuf, MPR_RUN, mpr.v.runFirst);
+        mpr.in1 = SD.open(fnbuf, FILE_READ);
+        mpren_buildName(fnbuf, MPR_RUN, mpr.v.runFirst + 1);
+        mpr.in2 = SD.open(fnbuf, FILE_READ);
+        mpren_buildName(fnbuf, MPR_RUN, mpr.v.runNext);
+        mpr.out = SD.open(fnbuf, FILE_WRITE);
+        if(!mpr.in1 || !mpr.in2 || !mpr.out) {
+            mpren_abort();
+            return;
         }
+        mpr.have1 = mpren_readLine(mpr.in1, l1);
+        mpr.have2 = mpren_readLine(mpr.in2, l2);
+        mpr.mergeOpen = true;
     }
 
-    origin.close();
+    for(int i = 0; i < 16 && (mpr.have1 || mpr.have2); i++) {
+        if(mpr.have1 && (!mpr.have2 || !mpren_strLT(l2, l1))) {
+            mpr.out.print(l1);
+            mpr.have1 = mpren_readLine(mpr.in1, l1);
+        } else {
+            mpr.out.print(l2);
+            mpr.have2 = mpren_readLine(mpr.in2, l2);
+        }
+        mpr.out.write('\n');
+    }
+
+    if(mpr.have1 || mpr.have2)
+        return;
+
+    // Merge complete
+    mpren_closeAll();
+    mpr.mergeOpen = false;
 
     #ifdef TC_DBG_MP
-    Serial.printf("%s%d files to process\n", funcName, fileNum);
+    Serial.printf("%sMerged runs %d+%d into %d\n", mprenName, mpr.v.runFirst, mpr.v.runFirst + 1, mpr.v.runNext);
     #endif
 
-    // Sort file names, and rename
+    mpr.v.runNext++;
+    mpr.v.runFirst += 2;
+    mpren_writeJournal();
+    mpren_removeRun(mpr.v.runFirst - 2);
+    mpren_removeRun(mpr.v.runFirst - 1);
 
-    if(fileNum) {
-        
-        // Sort file names
-        mpren_quickSort(a, 0, fileNum - 1);
-    
-        sprintf(fnbuf2, "/music%1d/", num);
-        strcpy(fnbuf, fnbuf2);
+    if(mpr.v.runNext - mpr.v.runFirst <= 1) {
+        mpr.v.pos = 0;
+        mpren_enter(MPR_RENAME);
+    }
+}
 
-        // If 000.mp3 exists, find current count
-        // the usual way. Otherwise start at 000.
-        strcpy(fnbuf + 8, "000.mp3");
-        if(SD.exists(fnbuf)) {
-            count = mp_findMaxNum() + 1;
-        }
+// Rename one file
+static void mpren_renameStep()
+{
+    char fnbuf[20];
+    char fnbuf2[MPREN_LINE_LEN + 8];
+    char *name = mpr.buf;
 
-        // Trigger head line change
-        if((hls = headLineShown)) {
-            renNow2 = 0;
-            headLineShown = false;
-        }
+    if(!mpren_readLine(mpr.in1, name) || mpr.v.count > 999) {
+        mpren_enter(MPR_INDEX);
+        return;
+    }
 
-        for(int i = 0; i < fileNum && count <= 999; i++) {
-            
-            mpren_looper(isSetup, false, fileNum - i);
-
-            sprintf(fnbuf + 8, "%03d.mp3", count);
-            strcpy(fnbuf2 + 8, a[i]);
-            if(!SD.rename(fnbuf2, fnbuf)) {
-                bool done = false;
-                while(!done) {
-                    count++;
-                    if(count <= 999) {
-                        sprintf(fnbuf + 8, "%03d.mp3", count);
-                        done = SD.rename(fnbuf2, fnbuf);
-                    } else {
-                        done = true;
-                    }
+    sprintf(fnbuf2, "/music%1d/%s", mpr.folder, name);
+
+    // Source gone? Then it was renamed before power loss,
+    // but the journal was not updated any more.
+    if(SD.exists(fnbuf2)) {
+        sprintf(fnbuf, "/music%1d/%03d.mp3", mpr.folder, mpr.v.count);
+        if(!SD.rename(fnbuf2, fnbuf)) {
+            bool done = false;
+            while(!done) {
+                mpr.v.count++;
+                if(mpr.v.count <= 999) {
+                    sprintf(fnbuf + 8, "%03d.mp3", mpr.v.count);
+                    done = SD.rename(fnbuf2, fnbuf);
+                } else {
+                    done = true;
                 }
             }
-            #ifdef TC_DBG_MP
-            Serial.printf("%sRenamed '%s' to '%s'\n", funcName, fnbuf2, fnbuf);
-            #endif
-            
-            count++;
         }
+        #ifdef TC_DBG_MP
+        Serial.printf("%sRenamed '%s' to '%s'\n", mprenName, fnbuf2, fnbuf);
+        #endif
+        mpr.v.count++;
     }
 
-    for(int i = 0; i <= allocBufIdx; i++) {
-        if(bufs[i]) free(bufs[i]);
+    mpr.v.renamed++;
+    mpr.v.pos = mpr.in1.position();
+    mpren_writeJournal();
+
+    // Background: Make player available once first files are done
+    if(mpr.background && (mpr.v.renamed == MPREN_AVAIL_NUM)) {
+        mpren_refreshPlayer(mpr.v.count, false);
     }
-    free(a);
+}
+
+// Add one file to the index
+static void mpren_indexStep()
+{
+    mpIdxEntry e;
+
+    if(!mp_indexEntry(mpr.out, mpr.v.renamed, mpr.buf, e) ||
+       ++mpr.v.renamed >= mpr.v.count) {
+        if(mp_indexEnd(mpr.out, mpr.v.renamed == mpr.v.count, mpr.v.count)) {
+            mpr.indexOK = true;
+        }
+        mpren_enter(MPR_FINISH);
+    }
+}
+
+static void mpren_finish()
+{
+    char fnbuf[32];
+
+    // Remove sorted list and journal. If we are interrupted before
+    // DONE is written, the next run finds nothing to rename.
+    mpren_removeRun(mpr.v.runFirst);
+    mpren_buildName(fnbuf, MPR_JOURNAL, 0);
+    SD.remove(fnbuf);
 
     // Write "DONE" file
-    if((origin = SD.open(fnbuf3, FILE_WRITE))) {
-        origin.close();
+    sprintf(fnbuf, "/music%1d%s", mpr.folder, tcdrdone);
+    File file = SD.open(fnbuf, FILE_WRITE);
+    if(file) {
+        file.close();
         #ifdef TC_DBG_MP
-        Serial.printf("%sWrote %s\n", funcName, fnbuf3);
+        Serial.printf("%sWrote %s\n", mprenName, fnbuf);
         #endif
     }
 
-    // Clear displays
-    if(hls || headLineShown) {
-        destinationTime.showTextDirect("");
-        presentTime.showTextDirect("");
-        departedTime.showTextDirect("");
+    if(mpr.background && mpr.v.count) {
+        mpren_refreshPlayer(mpr.v.count, mpr.indexOK);
     }
 
-    return true;
+    mpren_abort();
+}
+
+// Background: Update player after files were renamed
+static void mpren_refreshPlayer(int num, bool withIdx)
+{
+    mp_prefetchClose();
+
+    haveMusic = true;
+    maxMusic = num - 1;
+    mpHaveIdx = withIdx;
+    if(mpCurrIdx > maxMusic) mpCurrIdx = 0;
+
+    mp_setupPlayList();
+
+    #ifdef TC_DBG_MP
+    Serial.printf("%sPlayer now has %d files\n", mprenName, num);
+    #endif
+}
+
+/*
+ * Renamer helpers
+ */
+
+static void mpren_buildName(char *fnbuf, int type, int num)
+{
+    if(type == MPR_JOURNAL) {
+        sprintf(fnbuf, "/music%1d/TCD_JRNL.TXT", mpr.folder);
+    } else {
+        sprintf(fnbuf, "/music%1d/TCD_R%03d.TMP", mpr.folder, num % 1000);
+    }
+}
+
+static void mpren_removeRun(int num)
+{
+    char fnbuf[32];
+
+    mpren_buildName(fnbuf, MPR_RUN, num);
+    if(SD.exists(fnbuf)) {
+        SD.remove(fnbuf);
+    }
+}
+
+static void mpren_writeJournal()
+{
+    char fnbuf[32];
+
+    mpren_buildName(fnbuf, MPR_JOURNAL, 0);
+    File jf = SD.open(fnbuf, FILE_WRITE);
+    if(jf) {
+        jf.printf("%d %d %d %d %d %d %lu\n", mpr.phase, mpr.v.runFirst, mpr.v.runNext,
+                  mpr.v.count, mpr.v.fileNum, mpr.v.renamed, mpr.v.pos);
+        jf.close();
+    }
+}
+
+static bool mpren_readLine(File& f, char *buf)
+{
+    int i = 0, c;
+
+    while((c = f.read()) >= 0) {
+        if(c == '\n') break;
+        if(i < MPREN_LINE_LEN - 1) buf[i++] = c;
+    }
+    buf[i] = 0;
+
+    return (c >= 0 || i > 0);
+}
+
+static void mpren_closeAll()
+{
+    if(mpr.in1) mpr.in1.close();
+    if(mpr.in2) mpr.in2.close();
+    if(mpr.out) mpr.out.close();
+}
+
+static void mpren_freeBufs()
+{
+    if(mpr.buf) {
+        free(mpr.buf);
+        mpr.buf = NULL;
+    }
+    if(mpr.names) {
+        free(mpr.names);
+        mpr.names = NULL;
+    }
 }
 
 /*
- * QuickSort for file names
+ * Sort for file names
  */
 
 static unsigned char mpren_toUpper(char a)
@@ -1652,35 +2459,16 @@ static bool mpren_strLT(const char *a, const char *b)
     return false;
 }
 
-static int mpren_partition(char **a, int s, int e)
+// Chunks are small (MPREN_CHUNK_NUM), insertion sort is fine
+static void mpren_sort(char **a, int num)
 {
-    char *t;
-    char *p = a[e];
-    int   i = s - 1;
- 
-    for(int j = s; j <= e - 1; j++) {
-        if(mpren_strLT(a[j], p)) {
-            i++;
-            t = a[i];
-            a[i] = a[j];
-            a[j] = t;
+    for(int i = 1; i < num; i++) {
+        char *t = a[i];
+        int j = i - 1;
+        while(j >= 0 && mpren_strLT(t, a[j])) {
+            a[j + 1] = a[j];
+            j--;
         }
-    }
-
-    i++;
-
-    t = a[i];
-    a[i] = a[e];
-    a[e] = t;
-    
-    return i;
-}
-
-static void mpren_quickSort(char **a, int s, int e)
-{
-    if(s < e) {
-        int p = mpren_partition(a, s, e);
-        mpren_quickSort(a, s, p - 1);
-        mpren_quickSort(a, p + 1, e);
+        a[j + 1] = t;
     }
 }
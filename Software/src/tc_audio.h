@@ -85,6 +85,7 @@ void  audio_loop();
 void     play_file(const char *audio_file, uint32_t flags, float volumeFactor = 1.0f);
 uint32_t play_keypad_sound(char key);
 void     play_hour_sound(int hour);
+bool     have_hour_sound(int hour);
 void     play_beep();
 void     play_key(int k, uint32_t preDTMFkp);
 void     play_door_snd(int doorNum, int state, uint32_t doorFlags);
@@ -113,6 +114,7 @@ int   mp_gotonum(int num, bool force = false);
 void  mp_makeShuffle(bool enable);
 int   mp_checkForFolder(int num);
 int   mp_get_currently_playing();
+void  mp_renamer_loop();
 
 extern int  volumePin;
 
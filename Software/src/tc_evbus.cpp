@@ -0,0 +1,207 @@
+/*
+ * -------------------------------------------------------------------
+ * CircuitSetup.us Time Circuits Display
+ * (C) 2022-2026 Thomas Winischhofer (A10001986)
+ * https://github.com/realA10001986/Time-Circuits-Display
+ * https://tcd.out-a-ti.me
+ * 
+ * Event bus: Lock-free command queue from network handlers to main loop
+ * 
+ * -------------------------------------------------------------------
+ * License: Modified MIT NON-AI
+ * 
+ * Permission is hereby granted, free of charge, to any person 
+ * obtaining a copy of this software and associated documentation 
+ * files (the "Software"), to deal in the Software without restriction, 
+ * including without limitation the rights to use, copy, modify, 
+ * merge, publish, distribute, sublicense, and/or sell copies of the 
+ * Software, and to permit persons to whom the Software is furnished to 
+ * do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be 
+ * included in all copies or substantial portions of the Software.
+ * 
+ * Links inside the Software pointing to the original source must not 
+ * be changed or removed.
+ *
+ * In addition, the following restrictions apply:
+ * 
+ * 1. The Software and any modifications made to it may not be used 
+ * for the purpose of training or improving machine learning algorithms, 
+ * including but not limited to artificial intelligence, natural 
+ * language processing, or data mining. This condition applies to any 
+ * derivatives, modifications, or updates based on the Software code. 
+ * Any usage of the Software in an AI-training dataset is considered a 
+ * breach of this License.
+ *
+ * 2. The Software may not be included in any dataset used for 
+ * training or improving machine learning algorithms, including but 
+ * not limited to artificial intelligence, natural language processing, 
+ * or data mining.
+ *
+ * 3. Any person or organization found to be in violation of these 
+ * restrictions will be subject to legal action and may be held liable 
+ * for any damages resulting from such use.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "tc_global.h"
+
+#include <Arduino.h>
+#include <atomic>
+
+#include "tc_time.h"
+#include "tc_wifi.h"
+#include "tc_evbus.h"
+
+/*
+ * Commands from network sources (MQTT, BTTFN) are not executed in the 
+ * context they were received in; they are posted here and dispatched 
+ * at one point in the main loop, so state (csf, eef, keypad input, 
+ * time travel) is only ever modified from there.
+ * 
+ * The queue is a bounded multi-producer/single-consumer ring. Each
+ * cell carries a sequence number which tells producers and the
+ * consumer whose turn it is; producers claim a cell by CAS on the 
+ * write position. No locks, no allocation; if the queue is full, 
+ * the event is dropped.
+ * Cell sequence numbers are stored relative to the cell index, so
+ * the zero-initialized queue is valid without any setup.
+ */
+
+#define EVB_QSIZE   16    // Must be power of 2
+#define EVB_QMASK   (EVB_QSIZE - 1)
+
+static struct {
+    std::atomic<uint32_t> seq;
+    evbEvent              ev;
+} evbQueue[EVB_QSIZE];
+
+static std::atomic<uint32_t> evbWritePos(0);
+static uint32_t              evbReadPos = 0;
+
+static evbStats              stats = { 0 };
+static std::atomic<uint32_t> evbPosted(0);
+static std::atomic<uint32_t> evbDropped(0);
+
+#ifdef TC_DBG_EVB
+static unsigned long         lastStatsNow = 0;
+#endif
+
+static inline uint32_t cellSeq(uint32_t pos)
+{
+    return evbQueue[pos & EVB_QMASK].seq.load(std::memory_order_acquire) + (pos & EVB_QMASK);
+}
+
+static inline void setCellSeq(uint32_t pos, uint32_t seq)
+{
+    evbQueue[pos & EVB_QMASK].seq.store(seq - (pos & EVB_QMASK), std::memory_order_release);
+}
+
+/*
+ * evb_post()
+ * 
+ * May be called from any task; returns false if queue is full.
+ */
+bool evb_post(evbEvent *ev)
+{
+    uint32_t pos = evbWritePos.load(std::memory_order_relaxed);
+
+    while(1) {
+        int32_t diff = (int32_t)(cellSeq(pos) - pos);
+        if(!diff) {
+            if(evbWritePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if(diff < 0) {
+            evbDropped.fetch_add(1, std::memory_order_relaxed);
+            #ifdef TC_DBG_EVB
+            Serial.printf("evb: queue full, dropping event type %d\n", ev->type);
+            #endif
+            return false;
+        } else {
+            pos = evbWritePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    ev->now = millis();
+    evbQueue[pos & EVB_QMASK].ev = *ev;
+    setCellSeq(pos, pos + 1);
+
+    evbPosted.fetch_add(1, std::memory_order_relaxed);
+
+    return true;
+}
+
+int evb_depth()
+{
+    return (int)(evbWritePos.load(std::memory_order_relaxed) - evbReadPos);
+}
+
+void evb_getStats(evbStats *s)
+{
+    *s = stats;
+    s->posted = evbPosted.load(std::memory_order_relaxed);
+    s->dropped = evbDropped.load(std::memory_order_relaxed);
+}
+
+static void evb_dispatch(evbEvent *ev)
+{
+    switch(ev->type) {
+    #ifdef TC_HAVEMQTT
+    case EVB_MQTT_CMD:
+        mqttEvalEvent(ev);
+        break;
+    #endif
+    #ifdef TC_HAVE_REMOTE
+    case EVB_REM_CMD:
+        bttfnEvalEvent(ev);
+        break;
+    #endif
+    }
+}
+
+/*
+ * evb_loop()
+ * 
+ * Dispatches all queued events. Only to be called from the 
+ * main loop.
+ */
+void evb_loop()
+{
+    evbEvent ev;
+    int depth;
+
+    depth = evb_depth();
+    if(depth > stats.maxDepth) stats.maxDepth = depth;
+
+    while(1) {
+        uint32_t pos = evbReadPos;
+        if(cellSeq(pos) != pos + 1)
+            break;
+
+        ev = evbQueue[pos & EVB_QMASK].ev;
+        setCellSeq(pos, pos + EVB_QSIZE);
+        evbReadPos = pos + 1;
+
+        unsigned long lat = millis() - ev.now;
+        if(lat > stats.maxLatency) stats.maxLatency = lat;
+
+        evb_dispatch(&ev);
+    }
+
+    #ifdef TC_DBG_EVB
+    if(millis() - lastStatsNow > 10000) {
+        lastStatsNow = millis();
+        Serial.printf("evb: %u events, max depth %d, max latency %lums, %u dropped\n", 
+            evbPosted.load(std::memory_order_relaxed), stats.maxDepth, stats.maxLatency, 
+            evbDropped.load(std::memory_order_relaxed));
+    }
+    #endif
+}
@@ -0,0 +1,94 @@
+/*
+ * -------------------------------------------------------------------
+ * CircuitSetup.us Time Circuits Display
+ * (C) 2022-2026 Thomas Winischhofer (A10001986)
+ * https://github.com/realA10001986/Time-Circuits-Display
+ * https://tcd.out-a-ti.me
+ * 
+ * Event bus: Lock-free command queue from network handlers to main loop
+ * 
+ * -------------------------------------------------------------------
+ * License: Modified MIT NON-AI
+ * 
+ * Permission is hereby granted, free of charge, to any person 
+ * obtaining a copy of this software and associated documentation 
+ * files (the "Software"), to deal in the Software without restriction, 
+ * including without limitation the rights to use, copy, modify, 
+ * merge, publish, distribute, sublicense, and/or sell copies of the 
+ * Software, and to permit persons to whom the Software is furnished to 
+ * do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be 
+ * included in all copies or substantial portions of the Software.
+ * 
+ * Links inside the Software pointing to the original source must not 
+ * be changed or removed.
+ *
+ * In addition, the following restrictions apply:
+ * 
+ * 1. The Software and any modifications made to it may not be used 
+ * for the purpose of training or improving machine learning algorithms, 
+ * including but not limited to artificial intelligence, natural 
+ * language processing, or data mining. This condition applies to any 
+ * derivatives, modifications, or updates based on the Software code. 
+ * Any usage of the Software in an AI-training dataset is considered a 
+ * breach of this License.
+ *
+ * 2. The Software may not be included in any dataset used for 
+ * training or improving machine learning algorithms, including but 
+ * not limited to artificial intelligence, natural language processing, 
+ * or data mining.
+ *
+ * 3. Any person or organization found to be in violation of these 
+ * restrictions will be subject to legal action and may be held liable 
+ * for any damages resulting from such use.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _TC_EVBUS_H
+#define _TC_EVBUS_H
+
+// Event types
+#define EVB_MQTT_CMD    0     // MQTT command (bttf/tcd/cmd)
+#define EVB_REM_CMD     1     // BTTFN command from Remote
+#define EVB_NUMTYPES    2
+
+#define EVB_DATA_LEN   16
+
+typedef struct {
+    uint8_t       type;           // EVB_xxx
+    uint8_t       a, b, c;        // type specific
+    uint32_t      val;            // type specific
+    unsigned long now;            // millis() when posted (set by evb_post())
+    char          data[EVB_DATA_LEN];
+} evbEvent;
+
+typedef struct {
+    uint32_t      posted;         // successful evb_post() calls
+    uint32_t      dropped;        // queue full
+    uint16_t      maxDepth;
+    unsigned long maxLatency;     // ms between post and dispatch
+} evbStats;
+
+bool evb_post(evbEvent *ev);
+int  evb_depth();
+void evb_getStats(evbStats *stats);
+
+void evb_loop();
+
+// Handlers, called from evb_loop()
+#ifdef TC_HAVEMQTT
+void mqttEvalEvent(evbEvent *ev);     // tc_wifi
+#endif
+#ifdef TC_HAVE_REMOTE
+void bttfnEvalEvent(evbEvent *ev);    // tc_time
+#endif
+
+#endif
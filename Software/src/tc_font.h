@@ -57,7 +57,7 @@
 #define _TC_FONT_H
 
 #ifndef IS_ACAR_DISPLAY
-static const uint16_t alphaChars[127-31-1+4] = {
+static constexpr uint16_t alphaChars[127-31-1+4] = {
     0b0000000000000000,  // <space>
     0b0000000000000110,  // !
     0b0000001000100000,  // "
@@ -160,7 +160,7 @@ static const uint16_t alphaChars[127-31-1+4] = {
 };
 #endif
 
-static const uint8_t numDigs[127-31-1+4] = {
+static constexpr uint8_t numDigs[127-31-1+4] = {
     0b00000000, // space
     0b00000010, // !
     0b00100010, // "
@@ -116,9 +116,26 @@
 #define TC_NO_MONTH_ANIM
 #endif
 
+// Uncomment to have the music folder renamer run in the background after
+// boot instead of blocking the boot process. The music player becomes
+// available as soon as the first files are renamed. (When triggered from
+// the keypad menu, the renamer always runs in the foreground.)
+//#define TC_BG_RENAMER
+
+// Uncomment to run the MQTT client in a separate task on core 0. Broker
+// connection attempts, pings and reconnects then no longer stall the
+// displays, sound and time keeping. This covers MQTT only: WiFi
+// (re)connects, NTP and BTTFN are still handled in the main loop.
+//#define TC_MQTT_TASK
+
 // Use SPIFFS (if defined) or LittleFS (if undefined; esp32-arduino 2.x)
 //#define USE_SPIFFS
 
+// Uncomment to access i2c devices capable of 400kHz (TCD displays, RTC)
+// in fast mode. All other devices (keypad, speedo, sensors, GPS) are 
+// still accessed at 100kHz; the bus clock is switched as needed.
+//#define TC_I2C_FASTMODE
+
 /*************************************************************************
  ***                           Customization                           ***
  *************************************************************************/
@@ -153,6 +170,13 @@
 //#define TC_DBG_TT             // Time travel
 //#define TC_DBG_GPS            // GPS-related
 //#define TC_DBG_GEN            // Generic
+//#define TC_DBG_I2C            // i2c bus statistics
+//#define TC_DBG_ANIM           // Animation frame timing
+//#define TC_TT_TRACE           // Time travel event timeline & timing
+//#define TC_DBG_EVB            // Event bus depth & latency
+//#define TC_DBG_PWR            // CPU frequency statistics & energy estimate
+//#define TC_DBG_PERS           // Write-behind persistence
+//#define TC_BTTFN_BENCH        // BTTFN load & latency statistics
 #endif
 
 /*************************************************************************
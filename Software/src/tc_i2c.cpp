@@ -0,0 +1,383 @@
+/*
+ * -------------------------------------------------------------------
+ * CircuitSetup.us Time Circuits Display
+ * (C) 2022-2026 Thomas Winischhofer (A10001986)
+ * https://github.com/realA10001986/Time-Circuits-Display
+ * https://tcd.out-a-ti.me
+ * 
+ * I2C bus access: Priorities, batching, bus time accounting
+ * 
+ * -------------------------------------------------------------------
+ * License: Modified MIT NON-AI
+ * 
+ * Permission is hereby granted, free of charge, to any person 
+ * obtaining a copy of this software and associated documentation 
+ * files (the "Software"), to deal in the Software without restriction, 
+ * including without limitation the rights to use, copy, modify, 
+ * merge, publish, distribute, sublicense, and/or sell copies of the 
+ * Software, and to permit persons to whom the Software is furnished to 
+ * do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be 
+ * included in all copies or substantial portions of the Software.
+ * 
+ * Links inside the Software pointing to the original source must not 
+ * be changed or removed.
+ *
+ * In addition, the following restrictions apply:
+ * 
+ * 1. The Software and any modifications made to it may not be used 
+ * for the purpose of training or improving machine learning algorithms, 
+ * including but not limited to artificial intelligence, natural 
+ * language processing, or data mining. This condition applies to any 
+ * derivatives, modifications, or updates based on the Software code. 
+ * Any usage of the Software in an AI-training dataset is considered a 
+ * breach of this License.
+ *
+ * 2. The Software may not be included in any dataset used for 
+ * training or improving machine learning algorithms, including but 
+ * not limited to artificial intelligence, natural language processing, 
+ * or data mining.
+ *
+ * 3. Any person or organization found to be in violation of these 
+ * restrictions will be subject to legal action and may be held liable 
+ * for any damages resulting from such use.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "tc_global.h"
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#include "tc_i2c.h"
+
+#define I2C_CLK_STD     100000
+#define I2C_CLK_FAST    400000
+
+// Max number of devices we keep statistics for
+#define I2C_MAX_DEVS    12
+
+// Sensors/GPS are held off for this long after a display flip
+#define I2C_DISP_GUARD  20
+
+static struct {
+    uint8_t  addr;
+    uint8_t  prio;
+    bool     fast;
+    #ifdef TC_DBG_I2C
+    uint32_t numTrans;
+    uint32_t numBytes;
+    uint32_t numErrs;
+    uint32_t busTime;       // us
+    uint32_t maxTime;       // us
+    #endif
+} i2cDevs[I2C_MAX_DEVS + 1];    // last one: unregistered devices
+
+static int           numDevs = 0;
+static int           curDev = I2C_MAX_DEVS;
+static unsigned long curTransStart = 0;
+
+#ifdef TC_I2C_FASTMODE
+static uint32_t      curClock = I2C_CLK_STD;
+#endif
+
+static unsigned long lastDispNow = 0;
+static unsigned long reserveNow  = 0;
+static unsigned long reserveDur  = 0;
+
+// Maximum time a low-priority transaction is held off
+static const unsigned long maxDefer[I2CP_NUM] = { 0, 0, 0, 2000, 200 };
+static unsigned long deferNow[I2CP_NUM] = { 0 };
+
+#ifdef TC_DBG_I2C
+static uint32_t      numDeferred[I2CP_NUM] = { 0 };
+static uint32_t      numForced[I2CP_NUM] = { 0 };
+static unsigned long maxDeferred[I2CP_NUM] = { 0 };
+#endif
+
+/*
+ * Private
+ */
+
+static int findDev(uint8_t addr)
+{
+    for(int i = 0; i < numDevs; i++) {
+        if(i2cDevs[i].addr == addr) return i;
+    }
+    return I2C_MAX_DEVS;
+}
+
+static void transStart(uint8_t addr)
+{
+    curDev = findDev(addr);
+
+    #ifdef TC_I2C_FASTMODE
+    // Switch bus clock only if the device wants something else
+    // than what we currently have.
+    uint32_t clk = i2cDevs[curDev].fast ? I2C_CLK_FAST : I2C_CLK_STD;
+    if(clk != curClock) {
+        Wire.setClock(clk);
+        curClock = clk;
+    }
+    #endif
+
+    #ifdef TC_DBG_I2C
+    curTransStart = micros();
+    #endif
+}
+
+static void transEnd(int bytes, bool error)
+{
+    if(i2cDevs[curDev].prio == I2CP_DISPLAY) {
+        lastDispNow = millis();
+    }
+
+    #ifdef TC_DBG_I2C
+    uint32_t t = micros() - curTransStart;
+    i2cDevs[curDev].numTrans++;
+    i2cDevs[curDev].numBytes += bytes;
+    i2cDevs[curDev].busTime += t;
+    if(t > i2cDevs[curDev].maxTime) i2cDevs[curDev].maxTime = t;
+    if(error) i2cDevs[curDev].numErrs++;
+    #endif
+}
+
+/*
+ * Public
+ */
+
+void i2c_setup()
+{
+    // Make sure our i2c buf is 128 bytes
+    Wire.setBufferSize(128);
+    // PCF8574 only supports 100kHz, can't go to 400 here.
+    // Also, speedo cable is usually quite long, play it safe.
+    // Devices marked as "fast" are accessed at 400kHz if
+    // TC_I2C_FASTMODE is defined.
+    Wire.begin(-1, -1, I2C_CLK_STD);
+
+    i2cDevs[I2C_MAX_DEVS].prio = I2CP_DISPLAY;
+}
+
+/*
+ * Register a device with its priority and speed capability.
+ * Unregistered devices (eg during detection) are treated as
+ * high-priority and accessed at standard speed.
+ */
+void i2c_setDevice(uint8_t addr, uint8_t prio, bool fast)
+{
+    int i = findDev(addr);
+
+    if(i == I2C_MAX_DEVS) {
+        if(numDevs >= I2C_MAX_DEVS) return;
+        i = numDevs++;
+        memset((void *)&i2cDevs[i], 0, sizeof(i2cDevs[i]));
+        i2cDevs[i].addr = addr;
+    }
+    i2cDevs[i].prio = (prio < I2CP_NUM) ? prio : I2CP_GPS;
+    i2cDevs[i].fast = fast;
+}
+
+bool i2c_probe(uint8_t addr)
+{
+    uint8_t err;
+    
+    transStart(addr);
+    Wire.beginTransmission(addr);
+    err = Wire.endTransmission(true);
+    transEnd(0, false);
+
+    return !err;
+}
+
+uint8_t i2c_write(uint8_t addr, const uint8_t *buf, int len, bool stop)
+{
+    uint8_t err;
+    
+    transStart(addr);
+    Wire.beginTransmission(addr);
+    Wire.write(buf, len);
+    err = Wire.endTransmission(stop);
+    transEnd(len, !!err);
+
+    return err;
+}
+
+uint8_t i2c_writeReg(uint8_t addr, uint8_t reg, const uint8_t *buf, int len)
+{
+    uint8_t err;
+
+    transStart(addr);
+    Wire.beginTransmission(addr);
+    Wire.write(reg);
+    if(len) Wire.write(buf, len);
+    err = Wire.endTransmission();
+    transEnd(len + 1, !!err);
+
+    return err;
+}
+
+// Write 16bit words (LSB first), as used by HT16K33 display RAM
+uint8_t i2c_writeBuf16(uint8_t addr, uint8_t reg, const uint16_t *buf, int len)
+{
+    uint8_t err;
+
+    transStart(addr);
+    Wire.beginTransmission(addr);
+    Wire.write(reg);
+    for(int i = 0; i < len; i++) {
+        Wire.write(buf[i] & 0xff);
+        Wire.write(buf[i] >> 8);
+    }
+    err = Wire.endTransmission();
+    transEnd((len * 2) + 1, !!err);
+
+    return err;
+}
+
+/*
+ * Send a sequence of single-byte commands (HT16K33 style)
+ * back-to-back, without a possible clock switch in between.
+ */
+uint8_t i2c_cmdBatch(uint8_t addr, const uint8_t *cmds, int num)
+{
+    uint8_t err = 0;
+
+    transStart(addr);
+    for(int i = 0; i < num; i++) {
+        Wire.beginTransmission(addr);
+        Wire.write(cmds[i]);
+        err |= Wire.endTransmission();
+    }
+    transEnd(num, !!err);
+
+    return err;
+}
+
+int i2c_read(uint8_t addr, uint8_t *buf, int len)
+{
+    int i2clen;
+
+    transStart(addr);
+    i2clen = Wire.requestFrom(addr, (uint8_t)len);
+    for(int i = 0; i < i2clen; i++) {
+        buf[i] = Wire.read();
+    }
+    transEnd(i2clen, (i2clen != len));
+
+    return i2clen;
+}
+
+/*
+ * Read a block of registers starting at reg. If stop is false,
+ * a repeated start is used between address and data phase.
+ */
+int i2c_readReg(uint8_t addr, uint8_t reg, uint8_t *buf, int len, bool stop)
+{
+    int i2clen;
+
+    transStart(addr);
+    Wire.beginTransmission(addr);
+    Wire.write(reg);
+    Wire.endTransmission(stop);
+    i2clen = Wire.requestFrom(addr, (uint8_t)len);
+    for(int i = 0; i < i2clen; i++) {
+        buf[i] = Wire.read();
+    }
+    transEnd(i2clen + 1, (i2clen != len));
+
+    return i2clen;
+}
+
+/*
+ * Check whether a transaction of given priority should be
+ * done now. Displays, inputs and RTC always get the bus.
+ * Lower priorities are held off while a display flip just
+ * happened or the bus is reserved, but never longer than 
+ * their respective maxDefer time.
+ */
+bool i2c_slack(uint8_t prio)
+{
+    unsigned long now = millis();
+
+    if(prio <= I2CP_RTC || prio >= I2CP_NUM)
+        return true;
+
+    if((now - lastDispNow < I2C_DISP_GUARD) ||
+       (reserveDur && (now - reserveNow < reserveDur))) {
+        if(!deferNow[prio]) {
+            deferNow[prio] = now ? now : 1;
+        } else if(now - deferNow[prio] >= maxDefer[prio]) {
+            #ifdef TC_DBG_I2C
+            numForced[prio]++;
+            if(now - deferNow[prio] > maxDeferred[prio]) maxDeferred[prio] = now - deferNow[prio];
+            #endif
+            deferNow[prio] = 0;
+            return true;
+        }
+        #ifdef TC_DBG_I2C
+        numDeferred[prio]++;
+        #endif
+        return false;
+    }
+
+    #ifdef TC_DBG_I2C
+    if(deferNow[prio] && (now - deferNow[prio] > maxDeferred[prio])) {
+        maxDeferred[prio] = now - deferNow[prio];
+    }
+    #endif
+    
+    deferNow[prio] = 0;
+    
+    return true;
+}
+
+/*
+ * Reserve the bus for high-priority devices for the given
+ * duration (ms), eg. during time travel sequences.
+ */
+void i2c_reserve(unsigned long duration)
+{
+    unsigned long now = millis();
+
+    if(reserveDur && (now - reserveNow < reserveDur)) {
+        unsigned long remaining = reserveDur - (now - reserveNow);
+        if(remaining > duration) return;
+    }
+    
+    reserveNow = now;
+    reserveDur = duration;
+}
+
+#ifdef TC_DBG_I2C
+void i2c_printStats()
+{
+    Serial.println("I2C bus statistics:");
+    for(int i = 0; i <= I2C_MAX_DEVS; i++) {
+        if(i == numDevs) i = I2C_MAX_DEVS;
+        if(!i2cDevs[i].numTrans) continue;
+        if(i == I2C_MAX_DEVS) {
+            Serial.printf("  (other) ");
+        } else {
+            Serial.printf("  0x%02x/%d%s ", i2cDevs[i].addr, i2cDevs[i].prio, i2cDevs[i].fast ? "F" : "");
+        }
+        Serial.printf("trans %u bytes %u errs %u bus %ums (avg %uus, max %uus)\n",
+                    i2cDevs[i].numTrans, i2cDevs[i].numBytes, i2cDevs[i].numErrs,
+                    i2cDevs[i].busTime / 1000,
+                    i2cDevs[i].busTime / i2cDevs[i].numTrans,
+                    i2cDevs[i].maxTime);
+    }
+    for(int i = I2CP_SENSOR; i < I2CP_NUM; i++) {
+        Serial.printf("  prio %d: deferred %u, forced %u, max defer %lums\n",
+                    i, numDeferred[i], numForced[i], maxDeferred[i]);
+    }
+}
+#endif
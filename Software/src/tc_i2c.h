@@ -0,0 +1,89 @@
+/*
+ * -------------------------------------------------------------------
+ * CircuitSetup.us Time Circuits Display
+ * (C) 2022-2026 Thomas Winischhofer (A10001986)
+ * https://github.com/realA10001986/Time-Circuits-Display
+ * https://tcd.out-a-ti.me
+ * 
+ * I2C bus access: Priorities, batching, bus time accounting
+ * 
+ * -------------------------------------------------------------------
+ * License: Modified MIT NON-AI
+ * 
+ * Permission is hereby granted, free of charge, to any person 
+ * obtaining a copy of this software and associated documentation 
+ * files (the "Software"), to deal in the Software without restriction, 
+ * including without limitation the rights to use, copy, modify, 
+ * merge, publish, distribute, sublicense, and/or sell copies of the 
+ * Software, and to permit persons to whom the Software is furnished to 
+ * do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be 
+ * included in all copies or substantial portions of the Software.
+ * 
+ * Links inside the Software pointing to the original source must not 
+ * be changed or removed.
+ *
+ * In addition, the following restrictions apply:
+ * 
+ * 1. The Software and any modifications made to it may not be used 
+ * for the purpose of training or improving machine learning algorithms, 
+ * including but not limited to artificial intelligence, natural 
+ * language processing, or data mining. This condition applies to any 
+ * derivatives, modifications, or updates based on the Software code. 
+ * Any usage of the Software in an AI-training dataset is considered a 
+ * breach of this License.
+ *
+ * 2. The Software may not be included in any dataset used for 
+ * training or improving machine learning algorithms, including but 
+ * not limited to artificial intelligence, natural language processing, 
+ * or data mining.
+ *
+ * 3. Any person or organization found to be in violation of these 
+ * restrictions will be subject to legal action and may be held liable 
+ * for any damages resulting from such use.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _TC_I2C_H
+#define _TC_I2C_H
+
+// Transaction priorities (lower value = higher priority)
+// Displays and inputs always get the bus immediately. Sensors
+// and GPS are polled in slack time only, ie when no display
+// flip happened recently and no time-critical sequence (time
+// travel, animations) has reserved the bus.
+#define I2CP_DISPLAY  0     // TCD displays, speedo
+#define I2CP_INPUT    1     // Keypad, rotary encoders
+#define I2CP_RTC      2     // RTC
+#define I2CP_SENSOR   3     // Light/temperature sensors
+#define I2CP_GPS      4     // GPS receiver
+#define I2CP_NUM      5
+
+void    i2c_setup();
+
+void    i2c_setDevice(uint8_t addr, uint8_t prio, bool fast = false);
+
+bool    i2c_probe(uint8_t addr);
+uint8_t i2c_write(uint8_t addr, const uint8_t *buf, int len, bool stop = true);
+uint8_t i2c_writeReg(uint8_t addr, uint8_t reg, const uint8_t *buf, int len);
+uint8_t i2c_writeBuf16(uint8_t addr, uint8_t reg, const uint16_t *buf, int len);
+uint8_t i2c_cmdBatch(uint8_t addr, const uint8_t *cmds, int num);
+int     i2c_read(uint8_t addr, uint8_t *buf, int len);
+int     i2c_readReg(uint8_t addr, uint8_t reg, uint8_t *buf, int len, bool stop = true);
+
+bool    i2c_slack(uint8_t prio);
+void    i2c_reserve(unsigned long duration);
+
+#ifdef TC_DBG_I2C
+void    i2c_printStats();
+#endif
+
+#endif
@@ -65,6 +65,8 @@
 #include "tc_keypad.h"
 #include "tc_settings.h"
 #include "tc_wifi.h"
+#include "tc_anim.h"
+#include "tc_sched.h"
 
 #define KEYPAD_ADDR     0x20    // I2C address of the PCF8574 port expander (keypad)
 
@@ -222,6 +224,8 @@ static TCButton ettKey = TCButton(EXTERNAL_TIMETRAVEL_IN_PIN,
 // File copy progress
 static bool          fcprog = false;
 static unsigned long fcstart = 0;
+static unsigned long fcbegin = 0;
+static uint32_t      fcbytes = 0;
 
 static void keypadEvent(char key, KeyState kstate);
 
@@ -234,6 +238,42 @@ static void ettKeyHeld();
 
 static void resetEnterAnim();
 
+#ifndef TC_NO_MONTH_ANIM
+static int  enterAnimDep = 0;
+#ifdef TC_HAVEGPS
+static char enterDestDisp[16];
+static char enterDepDisp[16];
+#endif
+static void enterAnimStage(int stage);
+
+// Date entry: All but month, then all
+static const animFrame enterAnimTL[2] = {
+    {  0, 0, AOP_CALL, 1, enterAnimStage },
+    { 80, 0, AOP_CALL, 0, enterAnimStage }
+};
+static const animFrame enterAnim2TL[2] = {
+    {  0, ANT_DEST|ANT_DEP, AOP_ANIM, 1, NULL },
+    { 80, ANT_DEST|ANT_DEP, AOP_ANIM, 0, NULL }
+};
+#endif
+#ifndef IS_ACAR_DISPLAY
+// Date entry, part-3-style: Field by field
+static const animFrame enterAnim3TL[12] = {
+    {  0, ANT_DEST|ANT_DEP, AOP_ANIM3,  0, NULL },
+    {  6, ANT_DEST|ANT_DEP, AOP_ANIM3,  1, NULL },
+    { 12, ANT_DEST|ANT_DEP, AOP_ANIM3,  2, NULL },
+    { 18, ANT_DEST|ANT_DEP, AOP_ANIM3,  3, NULL },
+    { 24, ANT_DEST|ANT_DEP, AOP_ANIM3,  4, NULL },
+    { 30, ANT_DEST|ANT_DEP, AOP_ANIM3,  5, NULL },
+    { 36, ANT_DEST|ANT_DEP, AOP_ANIM3,  6, NULL },
+    { 42, ANT_DEST|ANT_DEP, AOP_ANIM3,  7, NULL },
+    { 48, ANT_DEST|ANT_DEP, AOP_ANIM3,  8, NULL },
+    { 54, ANT_DEST|ANT_DEP, AOP_ANIM3,  9, NULL },
+    { 60, ANT_DEST|ANT_DEP, AOP_ANIM3, 10, NULL },
+    { 66, ANT_DEST|ANT_DEP, AOP_ANIM3, 11, NULL }
+};
+#endif
+
 static void enterPressedPrepare();
 
 static void resetDisplayMode(bool setDep = false);
@@ -390,7 +430,7 @@ static void keypadEvent(char key, KeyState kstate)
         case '4':    // "4" held down -> toggle night-mode on/off
             manualNightMode = toggleNightMode();
             play_file(manualNightMode ? "/nmon.mp3" : "/nmoff.mp3", PA_INTSPKR|PA_ALLOWSD|PA_DYNVOL);
-            manualNMNow = millis();
+            sched_at(SCH_MANNM, MANNM_DUR);
             break;
         case '3':    // "3" held down -> play audio file "key3.mp3"
         case '6':    // "6" held down -> play audio file "key6.mp3"
@@ -1003,6 +1043,7 @@ void keypad_loop()
                     break;
                 case 440:
                     ctDown = 0;
+                    sched_cancel(SCH_CTDOWN);
                     displayTmrOff();    // Sets specDisp = 10
                     validEntry = 1;
                     break;
@@ -1249,10 +1290,12 @@ void keypad_loop()
                 mins = read2digs(2);
                 if(!mins) {
                     ctDown = 0;
+                    sched_cancel(SCH_CTDOWN);
                     displayTmrOff();  // sets specDisp = 10
                 } else {
                     ctDown = mins * 60 * 1000;
                     ctDownNow = millis();
+                    sched_at(SCH_CTDOWN, ctDown);
                     displayTmrString();
                     specDisp = 30;
                 }
@@ -1653,19 +1696,22 @@ void keypad_loop()
             // Fill audio buffer, avoid a pause in the actual animation
             audio_loop();
 
+            // Complete a previous animation, and remember whether
+            // to include the departed time (reset below)
+            anim_flush(ANS_ENTER);
+            #ifndef TC_NO_MONTH_ANIM
+            enterAnimDep = needDepTime;
+            #endif
+
             #ifdef TC_HAVEGPS
             if(isNavMode()) {
                 char destDisp[16];
                 char depDisp[16];
                 gpsMakePos(destDisp, depDisp);
                 #ifndef TC_NO_MONTH_ANIM // ------------------
-                for(bool i : { true, false }) {
-                    destinationTime.showNavDirect(destDisp, i);
-                    if(needDepTime) {
-                        departedTime.showNavDirect(depDisp, i);
-                    }
-                    if(i) mydelay(80);
-                }
+                memcpy(enterDestDisp, destDisp, sizeof(enterDestDisp));
+                memcpy(enterDepDisp, depDisp, sizeof(enterDepDisp));
+                anim_start(ANS_ENTER, enterAnimTL, 2);
                 #else // -------------------------------------
                 destinationTime.showNavDirect(destDisp, false);
                 if(needDepTime) {
@@ -1680,23 +1726,7 @@ void keypad_loop()
                 if(isRcMode() && (!isWcMode() || (!(wcf & WCF_HaveTZ1)) || needDepTime)) {
 
                     #ifndef TC_NO_MONTH_ANIM // -----------------------------------
-                    for(bool i : { true, false }) {
-                        if(!isWcMode() || (!(wcf & WCF_HaveTZ1))) {
-                            destinationTime.showTempDirect(tempSens.readLastTemp(), i);
-                        } else {
-                            destinationTime.showAnimate(i);
-                        }
-                        if(needDepTime) {
-                            if(isWcMode() && (wcf & WCF_HaveTZ1)) {
-                                departedTime.showTempDirect(tempSens.readLastTemp(), i);
-                            } else if(!isWcMode() && tempSens.haveHum()) {
-                                departedTime.showHumDirect(tempSens.readHum(), i);
-                            } else {
-                                departedTime.showAnimate(i);
-                            }
-                        }
-                        if(i) mydelay(80);
-                    }
+                    anim_start(ANS_ENTER, enterAnimTL, 2);
                     #else // TC_NO_MONTH_ANIM -------------------------------------
                     if(!isWcMode() || (!(wcf & WCF_HaveTZ1))) {
                         destinationTime.showTempDirect(tempSens.readLastTemp(), false);
@@ -1732,24 +1762,13 @@ void keypad_loop()
     
                         #ifndef IS_ACAR_DISPLAY
                         if(p3anim) {
-                            for(int i = 0; i < 12; i++) {
-                                if(!destinationTime.showAnimate3(i))
-                                    break;
-                                if(needDepTime) {
-                                    departedTime.showAnimate3(i);
-                                }
-                                mydelay(5);
-                            }
+                            anim_start(ANS_ENTER, enterAnim3TL, sizeof(enterAnim3TL) / sizeof(enterAnim3TL[0]),
+                                       needDepTime ? ANT_ALL : (ANT_ALL & ~ANT_DEP));
                         } else {
                         #endif    // IS_ACAR_DISPLAY
                             #ifndef TC_NO_MONTH_ANIM // ---------------------
-                            for(bool i : { true, false }) {
-                                destinationTime.showAnimate(i);
-                                if(needDepTime) {
-                                    departedTime.showAnimate(i);
-                                }
-                                if(i) mydelay(80);
-                            }
+                            anim_start(ANS_ENTER, enterAnim2TL, 2,
+                                       needDepTime ? ANT_ALL : (ANT_ALL & ~ANT_DEP));
                             #else // TC_NO_MONTH_ANIM -----------------------
                             destinationTime.show();
                             if(needDepTime) {
@@ -1778,8 +1797,47 @@ void keypad_loop()
     }
 }
 
+#ifndef TC_NO_MONTH_ANIM
+// Date entry in nav/rc/wc modes; stage 1 (arg 1): All but month, 
+// stage 2 (arg 0): All
+static void enterAnimStage(int stage)
+{
+    bool i = !!stage;
+    
+    #ifdef TC_HAVEGPS
+    if(isNavMode()) {
+        destinationTime.showNavDirect(enterDestDisp, i);
+        if(enterAnimDep) {
+            departedTime.showNavDirect(enterDepDisp, i);
+        }
+        return;
+    }
+    #endif
+    
+    #ifdef TC_HAVETEMP
+    if(!isWcMode() || (!(wcf & WCF_HaveTZ1))) {
+        destinationTime.showTempDirect(tempSens.readLastTemp(), i);
+    } else {
+        destinationTime.showAnimate(i);
+    }
+    if(enterAnimDep) {
+        if(isWcMode() && (wcf & WCF_HaveTZ1)) {
+            departedTime.showTempDirect(tempSens.readLastTemp(), i);
+        } else if(!isWcMode() && tempSens.haveHum()) {
+            departedTime.showHumDirect(tempSens.readHum(), i);
+        } else {
+            departedTime.showAnimate(i);
+        }
+    }
+    #endif
+}
+#endif
+
 void cancelEnterAnim(bool reenableDT)
 {
+    // Month animation still running: Complete it
+    anim_flush(ANS_ENTER);
+    
     if(enterTimerNow) {
 
         if(reenableDT) {
@@ -2080,6 +2138,12 @@ void setBeepMode(int mode)
         beepTimeout = BEEPM3_SECS*1000;
         break;
     }
+    if(beepTimer) {
+        unsigned long el = now - beepTimerNow;
+        sched_at(SCH_BEEP, (el < beepTimeout) ? beepTimeout - el : 0);
+    } else {
+        sched_cancel(SCH_BEEP);
+    }
     if(nb) {
         settings.beep[0] = beepMode + '0';
         saveBeepAutoInterval();
@@ -2094,6 +2158,7 @@ void startBeepTimer()
     if(beepMode >= 2) {
         beepTimer = true;
         beepTimerNow = millis();
+        sched_at(SCH_BEEP, beepTimeout);
         muteBeep = false;
     }
 
@@ -2129,6 +2194,7 @@ void nightModeOn()
     // Expire beep timer
     if(beepMode >= 2) {
         beepTimer = false;
+        sched_cancel(SCH_BEEP);
         muteBeep = true;
     }
 }
@@ -2248,21 +2314,46 @@ void start_file_copy()
     allresetBrightness();
     
     fcprog = false;
-    fcstart = millis();
+    fcbytes = 0;
+    fcbegin = fcstart = millis();
 }
 
-void file_copy_progress()
+/*
+ * file_copy_progress()
+ *
+ * bytes is the total number of bytes installed so far. Alternates
+ * "PLEASE" with the current throughput (KB/s) on the last dep. time
+ * display; with TC_DBG_BOOT, bytes/sec are logged once per second.
+ */
+void file_copy_progress(uint32_t bytes)
 {
-    if(millis() - fcstart >= 1000) {
-        lt_showTextDirect(fcprog ? "PLEASE" : "WAIT");
+    unsigned long now = millis();
+    unsigned long el = now - fcstart;
+    char buf[16];
+
+    if(el >= 1000) {
+        uint32_t bps = (uint32_t)(((uint64_t)(bytes - fcbytes) * 1000) / el);
+        if(fcprog) {
+            lt_showTextDirect("PLEASE");
+        } else {
+            snprintf(buf, sizeof(buf), "%uKB/S", (unsigned int)(bps / 1024));
+            lt_showTextDirect(buf);
+        }
+        #ifdef TC_DBG_BOOT
+        Serial.printf("Sound pack: %u bytes, %u bytes/s\n", (unsigned int)bytes, (unsigned int)bps);
+        #endif
         fcprog = !fcprog;
-        fcstart = millis();
+        fcbytes = bytes;
+        fcstart = now;
     }
 }
 
 void file_copy_done(int err)
 {
     lt_showTextDirect(err ? "ERROR" : "DONE");
+    #ifdef TC_DBG_BOOT
+    Serial.printf("Sound pack installation %s after %lums\n", err ? "failed" : "done", millis() - fcbegin);
+    #endif
 }
 
 
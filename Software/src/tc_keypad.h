@@ -99,7 +99,7 @@ void s5(bool b);
 
 void doCopyAudioFiles();
 void start_file_copy();
-void file_copy_progress();
+void file_copy_progress(uint32_t bytes);
 void file_copy_done(int err);
 
 void prepareReboot();
@@ -237,9 +237,10 @@
 #define MODE_DEST 7
 #define MODE_DEPT 8
 #define MODE_SENS 9
-#define MODE_LTS  10
-#define MODE_CLI  11
-#define MODE_VER  12
+#define MODE_ABRI 10
+#define MODE_LTS  11
+#define MODE_CLI  12
+#define MODE_VER  13
 
 #define MODE_MIN  MODE_ALRM
 #define MODE_MAX  MODE_VER
@@ -290,6 +291,9 @@ static int  doSetBrightness(tcdDisplay* displaySet, uint8_t& newbri);
 #if defined(TC_HAVELIGHT) || defined(TC_HAVETEMP)
 static void doShowSensors();
 #endif
+#ifdef TC_HAVELIGHT
+static int  doSetAutoBri();
+#endif
 static void doShowNetInfo();
 static void doShowBTTFNInfo();
 static bool menuWaitForReleaseNC();
@@ -413,6 +417,12 @@ static void menuShow(int number, tcdDisplay*& displayHelp)
         sw_sel(D_D);
         break;
     #endif
+    #ifdef TC_HAVELIGHT
+    case MODE_ABRI:
+        dt_showTextDirect("AUTO BRIGHT");
+        sw_sel(D_D);
+        break;
+    #endif
     case MODE_LTS:    // Last time sync info
         dt_showTextDirect("TIME SYNC");
         if(!lastAuthTime64) {
@@ -494,11 +504,21 @@ static int menuSelect(int& number, DateTime& dtu, DateTime& dtl, tcdDisplay*& di
                     #else
                     if(number == MODE_SENS) number++;
                     #endif
+                    #ifdef TC_HAVELIGHT
+                    if(number == MODE_ABRI && (!(sgf & SGF_ULightSens))) number++;
+                    #else
+                    if(number == MODE_ABRI) number++;
+                    #endif
                 }
             } else {
                 if(number == MODE_MIN) number = MODE_MAX;
                 else {
                     number--;
+                    #ifdef TC_HAVELIGHT
+                    if(number == MODE_ABRI && (!(sgf & SGF_ULightSens))) number--;
+                    #else
+                    if(number == MODE_ABRI) number--;
+                    #endif
                     #if defined(TC_HAVELIGHT) || defined(TC_HAVETEMP)
                     if(number == MODE_SENS && (!(sgf & (SGF_UTemp|SGF_ULightSens)))) number--;
                     #else
@@ -942,6 +962,14 @@ void enter_menu()
         doShowSensors();
     #endif
 
+    #ifdef TC_HAVELIGHT
+    } else if(menuItemNum == MODE_ABRI) {   // Auto brightness
+
+        allOffWaitEnterRelease();
+
+        showCancel = doSetAutoBri();
+    #endif
+
     }                                      // LTS, VERSION: Bail out
 
 quitMenu:
@@ -1802,6 +1830,154 @@ static int doSetBrightness(tcdDisplay* displaySet, uint8_t& newbri)
     return 0;
 }
 
+#ifdef TC_HAVELIGHT
+/*
+ * Auto brightness #############################################
+ */
+
+// Show live lux value until ENTER is pressed
+static int doABriCalib(const char *text, int32_t& lux)
+{
+    char buf[16];
+    bool luxDone = false;
+    unsigned long sensNow = millis() - 5000;
+    bool wasEnter, dirDown, wasQuit = false, wasSelect;
+
+    lux = -1;
+
+    dt_showTextDirect(text);
+    pt_showTextDirect("WAIT...");
+    lt_showTextDirect("ENTER TO SET");
+    sw_sel(D_L|D_P|D_D);
+
+    prepareForInput();
+
+    // No timeout; user might need some time to set
+    // up the room's lighting
+
+    while(!luxDone) {
+
+        if(checkForMenuControl(wasEnter, dirDown, wasQuit, wasSelect)) {
+
+            if(wasQuit) break;
+
+            luxDone = (wasSelect || (wasEnter && menuWaitForReleaseNC())) && (lux >= 0);
+
+        } else {
+
+            menuDelay(50);
+
+            if(millis() - sensNow > 3000) {
+                lightSens.loop();
+                lux = lightSens.readLux();
+                if(lux >= 0) {
+                    sprintf(buf, "%d LUX", lux);
+                } else {
+                    strcpy(buf, "OVERLOAD");
+                }
+                pt_showTextDirect(buf);
+                sensNow = millis();
+            }
+            
+        }
+
+    }
+
+    keypadMode = 0;
+
+    return (luxDone && !wasQuit) ? 0 : 1;
+}
+
+/*
+ * Switch auto brightness on/off, calibrate lux range, and save
+ */
+static int doSetAutoBri()
+{
+    bool newAutoBri = autoBri;
+    bool abDone = false;
+    bool blinkSwitch = false;
+    unsigned long blinkNow = millis();
+    bool wasEnter, dirDown, wasQuit = false, wasSelect;
+    int32_t luxLo = abriLuxLo, luxHi = abriLuxHi;
+
+    dt_showTextDirect("AUTO BRIGHT");
+    pt_showTextDirect(newAutoBri ? "ON" : "OFF");
+    sw_sel(D_P|D_D);
+
+    prepareForInput();
+
+    while(!checkTimeOut() && !abDone) {
+
+        if(checkForMenuControl(wasEnter, dirDown, wasQuit, wasSelect)) {
+
+            if(wasQuit) break;
+
+            abDone = (wasSelect || (wasEnter && menuWaitForReleaseNC()));
+
+            if(!abDone) {
+                newAutoBri = !newAutoBri;
+            }
+
+            pt_showTextDirect(newAutoBri ? "ON" : "OFF");
+            blinkSwitch = false;
+            blinkNow = millis();
+
+        } else {
+
+            unsigned long mm = millis();
+
+            if(mm - blinkNow > 500) {
+                blinkSwitch = !blinkSwitch;
+                pt_showTextDirect(newAutoBri ? "ON" : "OFF", blinkSwitch ? (CDT_CLEAR|CDT_BLINK) : CDT_CLEAR);
+                blinkNow = mm;
+            }
+
+            menuDelay(50);
+
+        }
+
+    }
+
+    keypadMode = 0;
+
+    if(!abDone || wasQuit)
+        return 1;
+
+    if(newAutoBri) {
+        // Calibrate: Lux for lowest, and for configured brightness
+        waitForEnterRelease();
+        if(doABriCalib("LOW LIGHT", luxLo))
+            return 1;
+        waitForEnterRelease();
+        if(doABriCalib("BRIGHT LIGHT", luxHi))
+            return 1;
+        if(luxHi < luxLo) {
+            int32_t t = luxHi; luxHi = luxLo; luxLo = t;
+        }
+        if(luxLo > 65534) luxLo = 65534;
+        if(luxHi > 65535) luxHi = 65535;
+        if(luxHi <= luxLo) luxHi = luxLo + 1;
+    }
+
+    allOff();
+    dt_showTextDirect(StrSaving);
+    sw_sel(D_D);
+
+    autoBri = newAutoBri;
+    abriLuxLo = luxLo;
+    abriLuxHi = luxHi;
+    saveAutoBri();
+
+    if(!autoBri) {
+        autoBriReset();
+    }
+
+    menuDelay(1000);
+
+    return 0;
+}
+#endif
+
 /*
  * Show sensor info ############################################
  */
@@ -0,0 +1,189 @@
+/*
+ * -------------------------------------------------------------------
+ * CircuitSetup.us Time Circuits Display
+ * (C) 2022-2026 Thomas Winischhofer (A10001986)
+ * https://github.com/realA10001986/Time-Circuits-Display
+ * https://tcd.out-a-ti.me
+ * 
+ * Scheduler: One-shot timers, min-heap ordered by due time
+ * 
+ * -------------------------------------------------------------------
+ * License: Modified MIT NON-AI
+ * 
+ * Permission is hereby granted, free of charge, to any person 
+ * obtaining a copy of this software and associated documentation 
+ * files (the "Software"), to deal in the Software without restriction, 
+ * including without limitation the rights to use, copy, modify, 
+ * merge, publish, distribute, sublicense, and/or sell copies of the 
+ * Software, and to permit persons to whom the Software is furnished to 
+ * do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be 
+ * included in all copies or substantial portions of the Software.
+ * 
+ * Links inside the Software pointing to the original source must not 
+ * be changed or removed.
+ *
+ * In addition, the following restrictions apply:
+ * 
+ * 1. The Software and any modifications made to it may not be used 
+ * for the purpose of training or improving machine learning algorithms, 
+ * including but not limited to artificial intelligence, natural 
+ * language processing, or data mining. This condition applies to any 
+ * derivatives, modifications, or updates based on the Software code. 
+ * Any usage of the Software in an AI-training dataset is considered a 
+ * breach of this License.
+ *
+ * 2. The Software may not be included in any dataset used for 
+ * training or improving machine learning algorithms, including but 
+ * not limited to artificial intelligence, natural language processing, 
+ * or data mining.
+ *
+ * 3. Any person or organization found to be in violation of these 
+ * restrictions will be subject to legal action and may be held liable 
+ * for any damages resulting from such use.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "tc_global.h"
+
+#include <Arduino.h>
+
+#include "tc_sched.h"
+
+/*
+ * Each timer ID can be armed once; arming it again reschedules it. 
+ * The main loop only looks at the top of the heap, so its cost does
+ * not depend on the number of armed timers.
+ * Due times are absolute millis(), compared as signed difference; 
+ * timers must not be more than 24 days apart.
+ * Not thread safe; to be used from the main loop only.
+ * Wall-clock events (alarm, reminder, sound-on-the-hour, time 
+ * cycling) are not handled here: They are checked once per second, 
+ * on the second change, against a time that may be set or jump at
+ * any moment (NTP, GPS, keypad, time travel). Likewise, the WiFi 
+ * power-save timeouts stay in wifi_loop(), as their conditions 
+ * (BTTFN clients, AP stations) are re-evaluated continuously.
+ */
+
+static struct {
+    unsigned long due;
+    uint8_t       id;
+} heap[SCH_NUM];
+
+static uint8_t heapNum = 0;
+static uint8_t heapPos[SCH_NUM] = { 0 };   // heap index + 1, 0 = not armed
+
+static inline bool before(int a, int b)
+{
+    return (long)(heap[a].due - heap[b].due) < 0;
+}
+
+static void swapEntries(int a, int b)
+{
+    unsigned long tdue = heap[a].due;
+    uint8_t tid = heap[a].id;
+    
+    heap[a].due = heap[b].due; heap[a].id = heap[b].id;
+    heap[b].due = tdue;        heap[b].id = tid;
+    
+    heapPos[heap[a].id] = a + 1;
+    heapPos[heap[b].id] = b + 1;
+}
+
+static void siftUp(int i)
+{
+    while(i > 0) {
+        int p = (i - 1) / 2;
+        if(!before(i, p)) break;
+        swapEntries(i, p);
+        i = p;
+    }
+}
+
+static void siftDown(int i)
+{
+    while(1) {
+        int l = 2 * i + 1, r = l + 1, m = i;
+        if(l < heapNum && before(l, m)) m = l;
+        if(r < heapNum && before(r, m)) m = r;
+        if(m == i) break;
+        swapEntries(i, m);
+        i = m;
+    }
+}
+
+static void removeAt(int i)
+{
+    heapPos[heap[i].id] = 0;
+    heapNum--;
+    if(i < heapNum) {
+        heap[i].due = heap[heapNum].due;
+        heap[i].id = heap[heapNum].id;
+        heapPos[heap[i].id] = i + 1;
+        siftDown(i);
+        siftUp(i);
+    }
+}
+
+/*
+ * sched_at()
+ * 
+ * (Re)arm timer "id" to fire "delay" ms from now.
+ */
+void sched_at(uint8_t id, unsigned long delay)
+{
+    int i;
+    
+    if(id >= SCH_NUM) return;
+
+    if(heapPos[id]) {
+        i = heapPos[id] - 1;
+    } else {
+        i = heapNum++;
+        heap[i].id = id;
+        heapPos[id] = i + 1;
+    }
+    heap[i].due = millis() + delay;
+    
+    siftDown(i);
+    siftUp(i);
+}
+
+void sched_cancel(uint8_t id)
+{
+    if(id < SCH_NUM && heapPos[id]) {
+        removeAt(heapPos[id] - 1);
+    }
+}
+
+bool sched_pending(uint8_t id)
+{
+    return (id < SCH_NUM && heapPos[id]);
+}
+
+/*
+ * sched_next()
+ * 
+ * Returns the ID of a due timer (which is disarmed thereby),
+ * or -1 if none is due.
+ */
+int sched_next(unsigned long now)
+{
+    int id;
+    
+    if(!heapNum || (long)(now - heap[0].due) < 0)
+        return -1;
+
+    id = heap[0].id;
+    removeAt(0);
+
+    return id;
+}
@@ -0,0 +1,242 @@
+/*
+ * -------------------------------------------------------------------
+ * CircuitSetup.us Time Circuits Display
+ * (C) 2022-2026 Thomas Winischhofer (A10001986)
+ * https://github.com/realA10001986/Time-Circuits-Display
+ * https://tcd.out-a-ti.me
+ * 
+ * Segment rendering core shared by the TC LED segment displays
+ * 
+ * -------------------------------------------------------------------
+ * License: Modified MIT NON-AI
+ * 
+ * Permission is hereby granted, free of charge, to any person 
+ * obtaining a copy of this software and associated documentation 
+ * files (the "Software"), to deal in the Software without restriction, 
+ * including without limitation the rights to use, copy, modify, 
+ * merge, publish, distribute, sublicense, and/or sell copies of the 
+ * Software, and to permit persons to whom the Software is furnished to 
+ * do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be 
+ * included in all copies or substantial portions of the Software.
+ * 
+ * Links inside the Software pointing to the original source must not 
+ * be changed or removed.
+ *
+ * In addition, the following restrictions apply:
+ * 
+ * 1. The Software and any modifications made to it may not be used 
+ * for the purpose of training or improving machine learning algorithms, 
+ * including but not limited to artificial intelligence, natural 
+ * language processing, or data mining. This condition applies to any 
+ * derivatives, modifications, or updates based on the Software code. 
+ * Any usage of the Software in an AI-training dataset is considered a 
+ * breach of this License.
+ *
+ * 2. The Software may not be included in any dataset used for 
+ * training or improving machine learning algorithms, including but 
+ * not limited to artificial intelligence, natural language processing, 
+ * or data mining.
+ *
+ * 3. Any person or organization found to be in violation of these 
+ * restrictions will be subject to legal action and may be held liable 
+ * for any damages resulting from such use.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _TC_SEGRENDER_H
+#define _TC_SEGRENDER_H
+
+#include "tc_font.h"
+
+/*
+ * The display layout is 8 words (16 bit):
+ * Month (1 word of 2 7-seg digits on the A-Car display, 3 words of
+ * 14-seg letters on all others), day, year (2 words), hour, minute.
+ * Each numeric word holds two 7-seg digits, MSB = 1s, LSB = 10s.
+ *
+ * Number and month segments are precomputed at compile time, so
+ * rendering a date boils down to a few table loads.
+ */
+
+// Index sequence (not part of C++11)
+template<unsigned... I> struct segIdxSeq {};
+template<unsigned N, unsigned... I> struct segMkSeq : segMkSeq<N - 1, N - 1, I...> {};
+template<unsigned... I> struct segMkSeq<0, I...> { typedef segIdxSeq<I...> type; };
+
+// Segments for a 2-digit number (valid up to 255)
+constexpr uint16_t segNum2(unsigned int num)
+{
+    return numDigs[(num / 10) + '0' - 32] | (numDigs[(num % 10) + '0' - 32] << 8);
+}
+
+template<typename S> struct segNumTbl;
+template<unsigned... I> struct segNumTbl<segIdxSeq<I...>> {
+    static constexpr uint16_t tbl[sizeof...(I)] = { segNum2(I)... };
+};
+template<unsigned... I> constexpr uint16_t segNumTbl<segIdxSeq<I...>>::tbl[sizeof...(I)];
+
+// 00-99
+typedef segNumTbl<segMkSeq<100>::type> segNums;
+
+static inline uint16_t segNum(unsigned int num, bool noLead0 = false)
+{
+    uint16_t segs = (num < 100) ? segNums::tbl[num] : segNum2(num);
+
+    return (noLead0 && num < 10) ? (segs & 0xff00) : segs;
+}
+
+// Month field: Specialized by number of month digits/letters
+template<int MonthDigs> struct segMonthField;
+
+// A-Car: 2-digit month on 7-seg
+template<> struct segMonthField<2> {
+    static constexpr int size = 1;
+
+    static inline void month(uint16_t *buf, int monthNum, bool noLead0 = false)
+    {
+        buf[0] = segNum(monthNum, noLead0);
+    }
+};
+
+#ifndef IS_ACAR_DISPLAY
+#define SEG_M14(s) { alphaChars[s[0] - 32], alphaChars[s[1] - 32], alphaChars[s[2] - 32] }
+static constexpr uint16_t segMonths14[13][3] = {
+    SEG_M14("JAN"), SEG_M14("FEB"), SEG_M14("MAR"), SEG_M14("APR"),
+    SEG_M14("MAY"), SEG_M14("JUN"), SEG_M14("JUL"), SEG_M14("AUG"),
+    SEG_M14("SEP"), SEG_M14("OCT"), SEG_M14("NOV"), SEG_M14("DEC"),
+    SEG_M14("  _")
+};
+#undef SEG_M14
+
+// All others: 3-letter month on 14-seg
+template<> struct segMonthField<3> {
+    static constexpr int size = 3;
+
+    // monthNum 1-12; 0 = "  _"
+    static inline void month(uint16_t *buf, int monthNum, bool = false)
+    {
+        memcpy(buf, segMonths14[monthNum ? monthNum - 1 : 12], 3 * sizeof(uint16_t));
+    }
+};
+#endif
+
+template<int MonthDigs>
+struct segRender {
+
+    static constexpr int bufSize   = 8;
+    static constexpr int monthPos  = 0;
+    static constexpr int monthDigs = MonthDigs;
+    static constexpr int monthSize = segMonthField<MonthDigs>::size;
+    static constexpr int dayPos    = 3;
+    static constexpr int yearPos   = 4;
+    static constexpr int hourPos   = 6;
+    static constexpr int minPos    = 7;
+
+    // Segment data for a 2 digit number
+    static inline uint16_t num(unsigned int num, bool noLead0 = false)
+    {
+        return segNum(num, noLead0);
+    }
+
+    // Month: 1-12 (A-Car: 0-12 displayed as number)
+    static inline void month(uint16_t *buf, int monthNum, bool noLead0 = false)
+    {
+        segMonthField<MonthDigs>::month(buf + monthPos, monthNum, noLead0);
+    }
+
+    // Year: 0-9999, two words
+    static inline void year(uint16_t *buf, unsigned int yearNum)
+    {
+        buf[yearPos]     = segNums::tbl[yearNum / 100];
+        buf[yearPos + 1] = segNums::tbl[yearNum % 100];
+    }
+
+    // Character on 7 segment display
+    static inline uint8_t char7(uint8_t value, uint8_t corr6 = 0)
+    {
+        if(value < 32 || value >= 127 + 4)
+            return 0;
+
+        // For text, use common "6" pattern if requested
+        if(value == '6') return numDigs['6' - 32] | corr6;
+
+        return numDigs[value - 32];
+    }
+
+    #ifndef IS_ACAR_DISPLAY
+    // Character on 14 segment display
+    static inline uint16_t char14(uint8_t value, uint8_t corr6 = 0)
+    {
+        if(value < 32 || value >= 127 + 4)
+            return 0;
+
+        // For text, use common "6" pattern if requested
+        if(value == '6') return alphaChars['6' - 32] | corr6;
+
+        return alphaChars[value - 32];
+    }
+    #endif
+
+    // Render text into segBuf, returns number of words used
+    static int text(uint16_t *segBuf, const char *text, uint8_t corr6 = 0, bool clear = true)
+    {
+        int idx = 0, pos = monthPos;
+        uint16_t temp;
+
+        if(MonthDigs == 2) {
+            while(text[idx] && pos < monthPos + monthSize) {
+                temp = char7(text[idx++], corr6);
+                if(text[idx]) {
+                    temp |= (char7(text[idx++], corr6) << 8);
+                }
+                segBuf[pos++] = temp;
+            }
+        } else {
+            while(text[idx] && pos < monthPos + monthSize) {
+                segBuf[pos++] = char14or7(text[idx++], corr6);
+            }
+        }
+
+        while(pos < dayPos) {
+            segBuf[pos++] = 0;
+        }
+
+        while(text[idx] && pos <= minPos) {
+            temp = char7(text[idx++], corr6);
+            if(text[idx]) {
+                temp |= (char7(text[idx++], corr6) << 8);
+            }
+            segBuf[pos++] = temp;
+        }
+
+        if(clear) {
+            while(pos <= minPos) {
+                segBuf[pos++] = 0;
+            }
+        }
+
+        return pos;
+    }
+
+  private:
+
+    static inline uint16_t char14or7(uint8_t value, uint8_t corr6)
+    {
+        #ifndef IS_ACAR_DISPLAY
+        return char14(value, corr6);
+        #else
+        return char7(value, corr6);
+        #endif
+    }
+};
+
+#endif
@@ -74,6 +74,7 @@
 #include <LittleFS.h>
 #endif
 #include <Update.h>
+#include <Preferences.h>
 
 #include "tc_settings.h"
 #include "tc_audio.h"
@@ -117,6 +118,7 @@
 
 static const char *CONFN  = "/TCDA.bin";
 static const char *CONFND = "/TCDA.old";
+static const char *CONJN  = "/TCDA.jnl";
 static const char *CONID  = "TCDA";
 const  char       rspv[]  = SND_REQ_VERSION;
 static uint32_t   soa = AC_TS;
@@ -152,6 +154,9 @@ static struct [[gnu::packed]] {
     dateStruct exhDates[2]; // initialized to default in time_boot()
     uint8_t updateV         = 0;
     uint8_t updateR         = 0;
+    uint8_t autoBri         = 0;
+    uint16_t abriLuxLo      = DEF_ABRI_LUX_LO;
+    uint16_t abriLuxHi      = DEF_ABRI_LUX_HI;
 } secSettings;
 
 // Tertiary settings (SD only)
@@ -239,6 +244,9 @@ static const char *obsFiles[] = {
 
 static const char fwfn[]      = "/tcdfw.bin";
 static const char fwfnold[]   = "/tcdfw.old";
+static const char fwmd5fn[]   = "/tcdfw.md5";
+static const char fwfnbgu[]   = "/tcdfw.bgu";
+static bool       fwuPending  = false;
 
 static const char *fsNoAvail     = "File System not available";
 static const char *failFileWrite = "Failed to open file for writing";
@@ -253,6 +261,12 @@ static char mqm[] = "mqxx";
 // If LittleFS/SPIFFS is mounted
 bool haveFS = false;
 
+// Binary settings files destined for flash are kept in NVS
+// (key = file name without "/"), no FS directory traffic
+#define NVS_NAMESPACE "tcdcfg"
+static Preferences nvsPrefs;
+static bool        haveNVS = false;
+
 // If a SD card is found
 bool haveSD = false;
 
@@ -295,6 +309,9 @@ static void loadCarMode();
 #ifdef TC_HAVE_REMOTE
 static void loadRemoteAllowed();
 #endif
+#ifdef TC_HAVELIGHT
+static void loadAutoBri();
+#endif
 static void loadUpdAvail();
 uint16_t    loadClockState(int16_t& yoffs);
 bool        saveClockState(uint16_t curYear, int16_t yearoffset);
@@ -306,7 +323,8 @@ void        updateClockDataP();
 bool        saveClockDataP(bool force);
 static void loadAllClockData();
 
-static void cfc(File& sfile, int& haveErr, int& haveWriteErr);
+static void cfc(File& sfile, int& haveErr, int& haveWriteErr, int idx, bool skip);
+static void cfc_journal_new(uint32_t packSize, uint32_t packHash);
 static bool audio_files_present(int& alienVER);
 
 static DeserializationError readJSONCfgFile(JsonDocument& json, File& configFile, uint32_t *newHash = NULL);
@@ -319,21 +337,30 @@ static bool writeFileToFS(const char *fn, uint8_t *buf, int len);
 
 static bool loadConfigFile(const char *fn, uint8_t *buf, int len, int& validBytes, int forcefs = 0);
 static bool saveConfigFile(const char *fn, uint8_t *buf, int len, int forcefs = 0);
-static uint32_t calcHash(uint8_t *buf, int len);
+static uint32_t calcHash(uint8_t *buf, int len, uint32_t hash = 2166136261UL);
 static bool saveSecSettings(bool useCache);
 static bool saveTerSettings(bool useCache);
+
+static void persist_setup();
+static bool persWrite(const char *fn, uint8_t *buf, int len, bool toSD);
+static bool persPending(const char *fn);
+
+static bool nvsLoad(const char *fn, uint8_t *buf, int len, int& validBytes);
+static bool nvsSave(const char *fn, uint8_t *buf, int len);
+static void nvsRemove(const char *fn);
 #ifdef SETTINGS_TRANSITION
 static void removeOldFiles(const char *oldfn);
 #endif
 
 static bool formatFlashFS(bool userSignal);
-
 static void firmware_update();
+static void fwupd_discard();
 
 // Helpers from tc_keypad
 extern void start_file_copy();
-extern void file_copy_progress();
+extern void file_copy_progress(uint32_t bytes);
 extern void file_copy_done(int err);
+extern void prepareReboot();
 
 #ifdef TC_HAVEMQTT
 static void preAllocMQTTTopMsg()
@@ -444,6 +471,8 @@ void settings_setup()
     preAllocMQTTTopMsg();
     #endif
 
+    haveNVS = nvsPrefs.begin(NVS_NAMESPACE, false);
+
     #ifdef TC_DBG_BOOT
     Serial.printf("%s: Mounting flash FS... ", funcName);
     #endif
@@ -551,7 +580,15 @@ void settings_setup()
 
     if(haveSD) {
 
-        firmware_update();
+        // Firmware update runs in background once we are up;
+        // if a background update was interrupted (power loss, 
+        // crash), fall back to updating right here.
+        if(SD.exists(fwfn)) {
+            if(SD.exists(fwfnbgu)) {
+                firmware_update();
+            }
+            fwuPending = true;
+        }
 
         if(SD.exists("/TCD_FLASH_RO") || !haveFS) {
             bool writedefault2 = true;
@@ -650,6 +687,10 @@ void settings_setup()
     loadRemoteAllowed();
     #endif
 
+    #ifdef TC_HAVELIGHT
+    loadAutoBri();
+    #endif
+
     #ifdef SERVOSPEEDO
     ttinpin = atoi(settings.ttinpin);
     ttoutpin = atoi(settings.ttoutpin);
@@ -703,10 +744,16 @@ void settings_setup()
         }
         digitalWrite(WHITE_LED_PIN, LOW);
     }
+
+    // Start write-behind for settings
+    persist_setup();
 }
 
 void unmount_fs()
 {
+    persist_flush();
+    fwupd_stop(false);
+    
     if(haveFS) {
         MYNVS.end();
         #ifdef TC_DBG_GEN
@@ -1403,6 +1450,8 @@ bool evalBoolSetClear(char *s, uint32_t& ff, uint32_t fl)
 static bool openCfgFileRead(const char *fn, File& f)
 {
     bool haveConfigFile = false;
+
+    if(persPending(fn)) persist_flush();
     
     if(configOnSD) {
         if(SD.exists(fn)) {
@@ -1864,6 +1913,34 @@ void saveRemoteAllowed()
 }
 #endif
 
+/*
+ *  Load/save auto brightness settings
+ */
+
+#ifdef TC_HAVELIGHT
+static void loadAutoBri()
+{
+    if(haveSecSettings) {
+        #ifdef TC_DBG_BOOT
+        Serial.println("loadAutoBri: extracting from secSettings");
+        #endif
+        if(secSettings.abriLuxLo < secSettings.abriLuxHi) {
+            autoBri = !!secSettings.autoBri;
+            abriLuxLo = secSettings.abriLuxLo;
+            abriLuxHi = secSettings.abriLuxHi;
+        }
+    }
+}
+
+void saveAutoBri()
+{
+    secSettings.autoBri = autoBri ? 1 : 0;
+    secSettings.abriLuxLo = abriLuxLo;
+    secSettings.abriLuxHi = abriLuxHi;
+    saveSecSettings(true);
+}
+#endif
+
 #ifdef SERVOSPEEDO
 void loadServoCorr(int& scorr, int& tcorr)
 {
@@ -2141,10 +2218,13 @@ void deleteIpSettings()
 
     ipHash = 0;
 
+    persist_flush();
+
     if(FlashROMode) {
         SD.remove(ipCfgName);
-    } else if(haveFS) {
-        MYNVS.remove(ipCfgName);
+    } else {
+        nvsRemove(ipCfgName);
+        if(haveFS) MYNVS.remove(ipCfgName);
     }
 }
 
@@ -2376,6 +2456,15 @@ static uint32_t getuint32(uint8_t *buf)
     return t;
 }
 
+static bool checkPackHeader(uint8_t *dbuf)
+{
+    return ((!memcmp(dbuf, CONID, 4))             && 
+            ((*(dbuf+4) & 0x7f) == AC_FMTV)       &&
+            (!memcmp(dbuf+5, rspv, 4))            &&
+            (*(dbuf+9) == (10+NUM_AUDIOFILES+1))  &&
+            (getuint32(dbuf+10) == soa));
+}
+
 bool check_if_default_audio_present()
 {
     uint8_t dbuf[16]; 
@@ -2392,12 +2481,7 @@ bool check_if_default_audio_present()
             ts = file.size();
             file.read(dbuf, 14);
             file.close();
-            if((!memcmp(dbuf, CONID, 4))             && 
-               ((*(dbuf+4) & 0x7f) == AC_FMTV)       &&
-               (!memcmp(dbuf+5, rspv, 4))            &&
-               (*(dbuf+9) == (10+NUM_AUDIOFILES+1))  &&
-               (getuint32(dbuf+10) == soa)           &&
-               (ts > soa + AC_OHSZ)) {
+            if(checkPackHeader(dbuf) && (ts > soa + AC_OHSZ)) {
                 ic = true;
                 if(!(*(dbuf+4) & 0x80)) r=f;
             }
@@ -2407,6 +2491,115 @@ bool check_if_default_audio_present()
     return ic;
 }
 
+/*
+ * Sound-pack installer
+ *
+ * The pack is read from SD in chunks of CFC_CHUNK bytes (the flash
+ * block size, so destination writes stay block-aligned). If the
+ * destination is the flash FS, a reader task on core 0 fills one
+ * buffer while the other one is decoded and written; in FlashROMode
+ * both source and destination are on SD, so we copy synchronously.
+ * Pack data is encoded in blocks of CFC_DBLOCK bytes, so each chunk
+ * is decoded in pieces of that size.
+ *
+ * Completed files are recorded in a journal on SD; an interrupted
+ * install resumes after the last completed file. The pack is hashed
+ * as it is read; for each file, the journal holds this running hash
+ * and a hash of the file's decoded data. On resume, the source of 
+ * a completed file is read again (but not written); the file is only 
+ * skipped if both hashes still match, so a changed pack or a damaged
+ * copy is installed anew. If the pack was uploaded through the Config
+ * Portal, the journal starts out with the hash computed while it 
+ * streamed in, and the complete install is checked against it.
+ */
+
+#define CFC_CHUNK   4096
+#define CFC_DBLOCK  1024
+#define CFC_NBUF    2
+#define CFC_NFILES  (NUM_AUDIOFILES+10+1)
+
+static File              *cfcSrc = NULL;
+static uint8_t           *cfcBuf[CFC_NBUF] = { NULL, NULL };
+static volatile int      cfcLen[CFC_NBUF];
+static uint32_t          cfcRemain = 0;
+static volatile bool     cfcAbort = false;
+static SemaphoreHandle_t cfcFilled = NULL;
+static SemaphoreHandle_t cfcFreed  = NULL;
+static uint32_t          cfcBytes = 0;
+
+static struct {
+    char     id[4];
+    uint32_t packSize;
+    uint32_t packHash;                // From upload; 0 = unknown
+    uint32_t done;
+    uint32_t shash[CFC_NFILES];       // Running pack hash after file
+    uint32_t fhash[CFC_NFILES];       // Hash of decoded file data
+} cfcJnl;
+static uint32_t cfcSHash;
+
+static void cfcReader(void *parameter)
+{
+    uint32_t remain = cfcRemain, t;
+    int i = 0, len;
+
+    while(remain) {
+        t = (remain < CFC_CHUNK) ? remain : CFC_CHUNK;
+        xSemaphoreTake(cfcFreed, portMAX_DELAY);
+        if(cfcAbort || (cfcSrc->read(cfcBuf[i], t) != t)) {
+            len = -1;
+        } else {
+            len = (int)t;
+        }
+        cfcLen[i] = len;
+        xSemaphoreGive(cfcFilled);
+        if(len < 0) break;
+        remain -= t;
+        i ^= 1;
+    }
+
+    vTaskDelete(NULL);
+}
+
+static void cfc_journal_init(uint32_t packSize, uint32_t packHash)
+{
+    memset((void *)&cfcJnl, 0, sizeof(cfcJnl));
+    memcpy(cfcJnl.id, CONID, 4);
+    cfcJnl.packSize = packSize;
+    cfcJnl.packHash = packHash;
+}
+
+// Start journal for a freshly uploaded pack
+static void cfc_journal_new(uint32_t packSize, uint32_t packHash)
+{
+    cfc_journal_init(packSize, packHash);
+    writeFileToSD(CONJN, (uint8_t *)&cfcJnl, sizeof(cfcJnl));
+}
+
+static uint32_t cfc_journal_load(uint32_t packSize)
+{
+    if(!SD.exists(CONJN) || 
+       !readFileFromSD(CONJN, (uint8_t *)&cfcJnl, sizeof(cfcJnl)) ||
+       memcmp(cfcJnl.id, CONID, 4) ||
+       cfcJnl.packSize != packSize ||
+       cfcJnl.done > CFC_NFILES) {
+        cfc_journal_init(packSize, 0);
+    }
+
+    #ifdef TC_DBG_BOOT
+    if(cfcJnl.done) {
+        Serial.printf("cfc: Resuming install after %d files\n", cfcJnl.done);
+    }
+    #endif
+
+    return cfcJnl.done;
+}
+
+static void cfc_journal_save(uint32_t done)
+{
+    cfcJnl.done = done;
+    writeFileToSD(CONJN, (uint8_t *)&cfcJnl, sizeof(cfcJnl));
+}
+
 // Returns false if copy failed because of a write error (which 
 //    might be cured by a reformat of the FlashFS)
 // Returns true if ok or source error (file missing, read error)
@@ -2422,18 +2615,45 @@ bool copy_audio_files(bool& delIDfile)
 
     start_file_copy();
 
-    if(ic) {
+    cfcBytes = 0;
+
+    if(ic && (cfcBuf[0] = (uint8_t *)malloc(CFC_NBUF * CFC_CHUNK))) {
         File sfile;
+        cfcBuf[1] = cfcBuf[0] + CFC_CHUNK;
+        if(!FlashROMode) {
+            cfcFilled = xSemaphoreCreateCounting(CFC_NBUF, 0);
+            cfcFreed  = xSemaphoreCreateCounting(CFC_NBUF, CFC_NBUF);
+        }
         if(sfile = SD.open(CONFN, FILE_READ)) {
-            sfile.seek(14);
-            for(i = 0; i < NUM_AUDIOFILES+10+1; i++) {
-               cfc(sfile, haveErr, haveWriteErr);
-               if(haveErr) break;
+            uint32_t done = cfc_journal_load(sfile.size());
+            if(sfile.read(cfcBuf[0], 14) != 14) {
+                haveErr++;
+            } else {
+                cfcSHash = calcHash(cfcBuf[0], 14);
+            }
+            for(i = 0; i < CFC_NFILES && !haveErr; i++) {
+                cfc(sfile, haveErr, haveWriteErr, i, (i < done));
+                if(haveErr) break;
+                cfc_journal_save(i + 1);
             }
             sfile.close();
+            if(!haveErr && cfcJnl.packHash && cfcSHash != cfcJnl.packHash) {
+                // Pack on SD is not what was uploaded: Start over next time
+                Serial.println("Sound pack: Checksum mismatch");
+                haveErr++;
+                SD.remove(CONJN);
+            }
+            if(!haveErr) {
+                SD.remove(CONJN);
+            }
         } else {
             haveErr++;
         }
+        if(cfcFilled) vSemaphoreDelete(cfcFilled);
+        if(cfcFreed)  vSemaphoreDelete(cfcFreed);
+        cfcFilled = cfcFreed = NULL;
+        free(cfcBuf[0]);
+        cfcBuf[0] = cfcBuf[1] = NULL;
     } else {
         haveErr++;
     }
@@ -2453,41 +2673,153 @@ static bool dfile_open(File& file, const char *fn, const char *md)
     return (file = MYNVS.open(fn, md));
 }
 
-static void cfc(File& sfile, int& haveErr, int& haveWriteErr)
+// Check if a destination file is complete and unchanged
+static bool dfile_check(const char *fn, uint32_t size, uint32_t fhash)
+{
+    File file;
+    uint32_t hash = 2166136261UL, t;
+    bool ret = false;
+
+    if(FlashROMode) {
+        if(!SD.exists(fn)) return false;
+    } else {
+        if(!haveFS || !MYNVS.exists(fn)) return false;
+    }
+    if(dfile_open(file, fn, FILE_READ)) {
+        if(file.size() == size) {
+            while(size) {
+                t = (size < CFC_CHUNK) ? size : CFC_CHUNK;
+                if(file.read(cfcBuf[0], t) != t) break;
+                hash = calcHash(cfcBuf[0], t, hash);
+                size -= t;
+            }
+            ret = (!size && hash == fhash);
+        }
+        file.close();
+    }
+    return ret;
+}
+
+static void cfc(File& sfile, int& haveErr, int& haveWriteErr, int idx, bool skip)
 {
     #ifdef TC_DBG_BOOT
     const char *funcName = "cfc";
     #endif
     uint8_t buf1[1+32+4];
-    uint8_t buf2[1024];
     File dfile;
+    uint32_t s, t, nchunks;
+    uint32_t fhash = 2166136261UL;
+    int i = 0, len;
+    bool piped = false, wrErr = false;
 
     buf1[0] = '/';
-    sfile.read(buf1 + 1, 32+4);   
-    if((dfile_open(dfile, (const char *)(*r)(buf1 + 1, soa, 32) - 1, FILE_WRITE))) {
-        uint32_t s = getuint32(buf1 + 1 + 32), t = 1024;
-        #ifdef TC_DBG_BOOT
-        Serial.printf("%s: Opened destination file: %s, length %d\n", funcName, (const char *)buf1, s);
-        #endif
-        while(s > 0) {
-            t = (s < t) ? s : t;
-            if(sfile.read(buf2, t) != t) {
-                haveErr++;
-                break;
+    if(sfile.read(buf1 + 1, 32+4) != 32+4) {
+        haveErr++;
+        return;
+    }
+    cfcSHash = calcHash(buf1 + 1, 32+4, cfcSHash);
+    (*r)(buf1 + 1, soa, 32);
+    s = getuint32(buf1 + 1 + 32);
+
+    // Resume: Skip files completed by an interrupted install
+    if(skip) {
+        uint32_t pos = sfile.position();
+        uint32_t hash = cfcSHash;
+        for(t = s; t; t -= len) {
+            len = (t < CFC_CHUNK) ? t : CFC_CHUNK;
+            if(sfile.read(cfcBuf[0], len) != (size_t)len) break;
+            hash = calcHash(cfcBuf[0], len, hash);
+        }
+        if(!t && hash == cfcJnl.shash[idx] && 
+           dfile_check((const char *)buf1, s, cfcJnl.fhash[idx])) {
+            #ifdef TC_DBG_BOOT
+            Serial.printf("%s: Skipping completed file: %s\n", funcName, (const char *)buf1);
+            #endif
+            cfcSHash = hash;
+            cfcBytes += s;
+            file_copy_progress(cfcBytes);
+            return;
+        }
+        if(!sfile.seek(pos)) {
+            haveErr++;
+            return;
+        }
+    }
+
+    if(!(dfile_open(dfile, (const char *)buf1, FILE_WRITE))) {
+        haveErr++;
+        haveWriteErr++;
+        Serial.printf("Error opening destination file: %s\n", buf1);
+        return;
+    }
+
+    #ifdef TC_DBG_BOOT
+    Serial.printf("%s: Opened destination file: %s, length %d\n", funcName, (const char *)buf1, s);
+    #endif
+
+    if(!s) {
+        cfcJnl.shash[idx] = cfcSHash;
+        cfcJnl.fhash[idx] = fhash;
+        return;
+    }
+
+    nchunks = (s + CFC_CHUNK - 1) / CFC_CHUNK;
+
+    if(cfcFilled && cfcFreed) {
+        cfcSrc = &sfile;
+        cfcRemain = s;
+        cfcAbort = false;
+        piped = (xTaskCreatePinnedToCore(cfcReader, "cfcReader", 4096, NULL, 1, NULL, 0) == pdPASS);
+    }
+
+    while(nchunks--) {
+        if(piped) {
+            xSemaphoreTake(cfcFilled, portMAX_DELAY);
+            len = cfcLen[i];
+        } else {
+            t = (s < CFC_CHUNK) ? s : CFC_CHUNK;
+            len = (sfile.read(cfcBuf[i], t) == t) ? (int)t : -1;
+        }
+        if(len < 0) {
+            haveErr++;
+            break;
+        }
+        if(!wrErr) {
+            cfcSHash = calcHash(cfcBuf[i], len, cfcSHash);
+            for(t = 0; t < (uint32_t)len; t += CFC_DBLOCK) {
+                (*r)(cfcBuf[i] + t, soa, (len - t < CFC_DBLOCK) ? len - t : CFC_DBLOCK);
             }
-            if(dfile.write((*r)(buf2, soa, t), t) != t) {
+            fhash = calcHash(cfcBuf[i], len, fhash);
+            if(dfile.write(cfcBuf[i], len) != (size_t)len) {
                 haveErr++;
                 haveWriteErr++;
-                break;
+                wrErr = true;
+                if(!piped) break;
+                // Let the reader stop; keep consuming until it did
+                cfcAbort = true;
             }
-            s -= t;
-            file_copy_progress();
         }
-    } else {
-        haveErr++;
-        haveWriteErr++;
-        Serial.printf("Error opening destination file: %s\n", buf1);
+        s -= len;
+        if(piped) {
+            xSemaphoreGive(cfcFreed);
+            i ^= 1;
+        }
+        if(!wrErr) {
+            cfcBytes += len;
+            file_copy_progress(cfcBytes);
+        }
+    }
+
+    if(piped) {
+        // Refill free slots for the next file
+        while(uxSemaphoreGetCount(cfcFreed) < CFC_NBUF) {
+            xSemaphoreGive(cfcFreed);
+        }
+        while(xSemaphoreTake(cfcFilled, 0) == pdTRUE) { }
     }
+
+    cfcJnl.shash[idx] = cfcSHash;
+    cfcJnl.fhash[idx] = fhash;
 }
 
 static bool audio_files_present(int& alienVER)
@@ -2549,6 +2881,8 @@ static bool formatFlashFS(bool userSignal)
         #endif
     }
 
+    persist_flush();
+
     MYNVS.format();
     if(MYNVS.begin()) ret = true;
 
@@ -2635,6 +2969,8 @@ void moveSettings()
         SD.remove(clkCfgName);
         SD.remove(secCfgName);
     } else {
+        nvsRemove(clkCfgName);
+        nvsRemove(secCfgName);
         MYNVS.remove(clkCfgName);
         MYNVS.remove(secCfgName);
     }
@@ -2708,13 +3044,8 @@ static bool writeJSONCfgFile(const JsonDocument& json, const char *fn, bool useS
         }
     }
 
-    if(useSD) {
-        success = writeFileToSD(fn, (uint8_t *)buf, (int)bufSize);
-    } else {
-        success = writeFileToFS(fn, (uint8_t *)buf, (int)bufSize);
-    }
-
-    free(buf);
+    // persWrite takes ownership of buf
+    success = persWrite(fn, (uint8_t *)buf, (int)bufSize, useSD);
 
     if(!success) {
         Serial.printf("wJSON: %s - %s\n", fn, failFileWrite);
@@ -2836,16 +3167,25 @@ static uint8_t cfChkSum(const uint8_t *buf, int len)
 static bool loadConfigFile(const char *fn, uint8_t *buf, int len, int& validBytes, int forcefs)
 {
     bool haveConfigFile = false;
+    bool migrate = false;
     int fl;
     uint8_t *bbuf = NULL;
 
     // forcefs: > 0: SD only; = 0 either (configOnSD); < 0: Flash if !FlashROMode, SD if FlashROMode
 
+    if(persPending(fn)) persist_flush();
+
     if(haveSD && ((!forcefs && configOnSD) || forcefs > 0 || (forcefs < 0 && FlashROMode))) {
         haveConfigFile = readFileFromSDU(fn, bbuf, fl);
     }
-    if(!haveConfigFile && haveFS && (!forcefs || (forcefs < 0 && !FlashROMode))) {
-        haveConfigFile = readFileFromFSU(fn, bbuf, fl);
+    if(!haveConfigFile && (!forcefs || (forcefs < 0 && !FlashROMode))) {
+        if(nvsLoad(fn, buf, len, validBytes)) {
+            return true;
+        }
+        // Not in NVS yet: Migrate file from flash FS
+        if(haveFS && (haveConfigFile = readFileFromFSU(fn, bbuf, fl))) {
+            migrate = haveNVS;
+        }
     }
     if(haveConfigFile) {
         uint8_t chksum = cfChkSum(bbuf, fl - 1);
@@ -2858,6 +3198,12 @@ static bool loadConfigFile(const char *fn, uint8_t *buf, int len, int& validByte
             for(int k = 0; k < len; k++) Serial.printf("%02x ", buf[k]);
             Serial.printf("chksum %02x\n", chksum);
             #endif
+            if(migrate && nvsSave(fn, bbuf + 2, validBytes)) {
+                #ifdef TC_DBG_BOOT
+                Serial.printf("loadConfigFile: migrated %s to NVS\n", fn);
+                #endif
+                MYNVS.remove(fn);
+            }
         } else {
             #ifdef TC_DBG_BOOT
             Serial.printf("loadConfigFile: Bad checksum %02x %02x\n", chksum, bbuf[fl - 1]);
@@ -2874,6 +3220,11 @@ static bool saveConfigFile(const char *fn, uint8_t *buf, int len, int forcefs)
 {
     uint8_t *bbuf;
     bool ret = false;
+    bool toSD = ((!forcefs && configOnSD) || forcefs > 0 || (forcefs < 0 && FlashROMode));
+
+    if(!toSD && haveNVS) {
+        return nvsSave(fn, buf, len);
+    }
 
     if(!(bbuf = (uint8_t *)malloc(len + 3)))
         return false;
@@ -2889,20 +3240,76 @@ static bool saveConfigFile(const char *fn, uint8_t *buf, int len, int forcefs)
     Serial.println("");
     #endif
 
-    if((!forcefs && configOnSD) || forcefs > 0 || (forcefs < 0 && FlashROMode)) {
-        ret = writeFileToSD(fn, bbuf, len + 3);
+    // persWrite takes ownership of bbuf
+    if(toSD) {
+        ret = persWrite(fn, bbuf, len + 3, true);
     } else if(haveFS) {
-        ret = writeFileToFS(fn, bbuf, len + 3);
+        ret = persWrite(fn, bbuf, len + 3, false);
+    } else {
+        free(bbuf);
     }
 
-    free(bbuf);
-
     return ret;
 }
 
-static uint32_t calcHash(uint8_t *buf, int len)
+/*
+ * NVS backend for binary settings
+ */
+
+static bool nvsLoad(const char *fn, uint8_t *buf, int len, int& validBytes)
+{
+    const char *key = fn + 1;
+    size_t l;
+    
+    if(!haveNVS || !(l = nvsPrefs.getBytesLength(key)))
+        return false;
+
+    if(l <= (size_t)len) {
+        if(nvsPrefs.getBytes(key, buf, l) != l)
+            return false;
+    } else {
+        // Stored by newer firmware, struct grew
+        uint8_t *tbuf;
+        if(!(tbuf = (uint8_t *)malloc(l)))
+            return false;
+        if(nvsPrefs.getBytes(key, tbuf, l) != l) {
+            free(tbuf);
+            return false;
+        }
+        memcpy(buf, tbuf, len);
+        free(tbuf);
+    }
+    
+    validBytes = l;
+
+    #ifdef TC_DBG_BOOT
+    Serial.printf("nvsLoad: loaded %s: need %d, got %d bytes\n", key, len, validBytes);
+    #endif
+    
+    return true;
+}
+
+static bool nvsSave(const char *fn, uint8_t *buf, int len)
+{
+    if(!haveNVS)
+        return false;
+
+    #ifdef TC_DBG_BOOT
+    Serial.printf("nvsSave: %s, %d bytes\n", fn + 1, len);
+    #endif
+    
+    return (nvsPrefs.putBytes(fn + 1, buf, len) == (size_t)len);
+}
+
+static void nvsRemove(const char *fn)
+{
+    if(haveNVS && nvsPrefs.isKey(fn + 1)) {
+        nvsPrefs.remove(fn + 1);
+    }
+}
+
+static uint32_t calcHash(uint8_t *buf, int len, uint32_t hash)
 {
-    uint32_t hash = 2166136261UL;
     for(int i = 0; i < len; i++) {
         hash = (hash ^ buf[i]) * 16777619;
     }
@@ -2948,6 +3355,232 @@ static bool saveTerSettings(bool useCache)
     return saveConfigFile(terCfgName, (uint8_t *)&terSettings, sizeof(terSettings), 1);
 }
 
+/*
+ * Write-behind persistence
+ *
+ * Writing to flash FS can take a whopping 1200ms, SD isn't much
+ * better with some cards. Therefore, saveConfigFile() (SD only;
+ * flash goes to NVS) and writeJSONCfgFile() only queue their
+ * (complete) file image here, and a low-priority task on core 0
+ * writes it out. Queuing the same file again while still pending
+ * replaces the old image. File names must be static strings (they
+ * are compared by pointer first, content second).
+ * persist_flush() is the durability barrier; it is called from
+ * flushDelayedSave(), unmount_fs() and before any operation that
+ * removes or re-formats what might still be pending.
+ */
+
+#define PERS_SLOTS    8
+#define PERS_COALESCE 250     // ms to wait for more writes before flushing
+#define PERS_TIMEOUT  5000    // max ms persist_flush() waits
+
+static struct {
+    const char *fn;
+    uint8_t    *buf;
+    int        len;
+    bool       toSD;
+} persQ[PERS_SLOTS];
+
+static SemaphoreHandle_t persMutex = NULL;
+static TaskHandle_t      persTask  = NULL;
+static volatile int      persNum   = 0;
+static volatile bool     persBusy  = false;
+static persStats         pStats    = { 0 };
+
+static bool persWriteNow(const char *fn, uint8_t *buf, int len, bool toSD)
+{
+    unsigned long now = millis();
+    bool ret = toSD ? writeFileToSD(fn, buf, len) : writeFileToFS(fn, buf, len);
+    
+    now = millis() - now;
+    pStats.lastLat = now;
+    if(now > pStats.maxLat) pStats.maxLat = now;
+    pStats.writes++;
+    if(!ret) pStats.fails++;
+
+    #ifdef TC_DBG_PERS
+    Serial.printf("persist: %s to %s, %d bytes, %dms%s\n", fn, toSD ? "SD" : "FS", len, now, ret ? "" : " - FAILED");
+    #endif
+
+    return ret;
+}
+
+// Write out all queued images; called by the task, and by
+// persist_flush() if the task does not get done in time.
+static void persDrain(bool isTask)
+{
+    const char *fn;
+    uint8_t *buf;
+    int len;
+    bool toSD;
+
+    while(1) {
+        xSemaphoreTake(persMutex, portMAX_DELAY);
+        if(!persNum) {
+            xSemaphoreGive(persMutex);
+            break;
+        }
+        persNum--;
+        fn   = persQ[0].fn;
+        buf  = persQ[0].buf;
+        len  = persQ[0].len;
+        toSD = persQ[0].toSD;
+        for(int i = 0; i < persNum; i++) {
+            persQ[i] = persQ[i + 1];
+        }
+        if(isTask) persBusy = true;
+        xSemaphoreGive(persMutex);
+
+        persWriteNow(fn, buf, len, toSD);
+        free(buf);
+
+        xSemaphoreTake(persMutex, portMAX_DELAY);
+        pStats.queued -= len;
+        if(isTask) persBusy = false;
+        xSemaphoreGive(persMutex);
+    }
+}
+
+static void persistTask(void *parm)
+{
+    while(1) {
+        
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // Let burst of saves (menus, CP) pile up
+        vTaskDelay(pdMS_TO_TICKS(PERS_COALESCE));
+
+        persDrain(true);
+    }
+}
+
+static void persist_setup()
+{
+    if(!(persMutex = xSemaphoreCreateMutex()))
+        return;
+        
+    if(xTaskCreatePinnedToCore(persistTask, "persist", 4096, NULL, 1, &persTask, 0) != pdPASS) {
+        persTask = NULL;
+        Serial.println("persist: Failed to create task, writing synchronously");
+    }
+}
+
+/*
+ * Queue file image "buf" (malloc'd; ownership passes to us) for
+ * writing to SD or flash FS.
+ */
+static bool persWrite(const char *fn, uint8_t *buf, int len, bool toSD)
+{
+    bool ret;
+    int i;
+
+    if(!(toSD ? haveSD : haveFS)) {
+        free(buf);
+        return false;
+    }
+
+    if(!persTask) {
+        ret = persWriteNow(fn, buf, len, toSD);
+        free(buf);
+        return ret;
+    }
+
+    xSemaphoreTake(persMutex, portMAX_DELAY);
+    
+    for(i = 0; i < persNum; i++) {
+        if(persQ[i].toSD == toSD && (persQ[i].fn == fn || !strcmp(persQ[i].fn, fn)))
+            break;
+    }
+    if(i < persNum) {
+        // Coalesce: Replace pending image
+        pStats.queued -= persQ[i].len;
+        free(persQ[i].buf);
+        pStats.coalesced++;
+    } else if(persNum < PERS_SLOTS) {
+        persNum++;
+    } else {
+        // Queue full: Write synchronously (should never happen)
+        xSemaphoreGive(persMutex);
+        persist_flush();
+        ret = persWriteNow(fn, buf, len, toSD);
+        free(buf);
+        return ret;
+    }
+    
+    persQ[i].fn = fn;
+    persQ[i].buf = buf;
+    persQ[i].len = len;
+    persQ[i].toSD = toSD;
+    pStats.queued += len;
+    if(pStats.queued > pStats.peakQueued) pStats.peakQueued = pStats.queued;
+    
+    xSemaphoreGive(persMutex);
+
+    xTaskNotifyGive(persTask);
+
+    return true;
+}
+
+static bool persPending(const char *fn)
+{
+    bool ret = false;
+    
+    if(!persTask)
+        return false;
+
+    xSemaphoreTake(persMutex, portMAX_DELAY);
+    if(persBusy) {
+        ret = true;
+    } else {
+        for(int i = 0; i < persNum; i++) {
+            if(persQ[i].fn == fn || !strcmp(persQ[i].fn, fn)) {
+                ret = true;
+                break;
+            }
+        }
+    }
+    xSemaphoreGive(persMutex);
+
+    return ret;
+}
+
+/*
+ * persist_flush()
+ *
+ * Wait until all queued writes are done. If the task does not
+ * get there in time (eg. stuck on a slow card), whatever is still 
+ * queued is written here synchronously.
+ */
+void persist_flush()
+{
+    unsigned long now = millis();
+    
+    if(!persTask)
+        return;
+
+    xTaskNotifyGive(persTask);
+    
+    while(persNum || persBusy) {
+        if(millis() - now > PERS_TIMEOUT) {
+            Serial.println("persist_flush: Timeout, writing synchronously");
+            persDrain(false);
+            // Give the task's current write a last chance to finish
+            while(persBusy && (millis() - now < 2 * PERS_TIMEOUT)) {
+                delay(5);
+            }
+            break;
+        }
+        delay(5);
+    }
+}
+
+void persist_getStats(persStats *s)
+{
+    if(persMutex) xSemaphoreTake(persMutex, portMAX_DELAY);
+    *s = pStats;
+    if(persMutex) xSemaphoreGive(persMutex);
+}
+
 #ifdef SETTINGS_TRANSITION
 static void removeOldFiles(const char *oldfn)
 {
@@ -2961,8 +3594,71 @@ static void removeOldFiles(const char *oldfn)
 
 /*
  * File upload
+ *
+ * HTTP chunks (HTTP_UPLOAD_BUFLEN bytes) are coalesced into 
+ * UPL_WBUF_SIZE bytes before being written, so SD writes are whole,
+ * aligned multiples of the 512 byte sector size (and whole clusters
+ * on cards with clusters of up to 8KB). A sound pack is validated
+ * (header, entry structure, size) and hashed while it streams in, 
+ * so it needs no second read after the upload; the hash is handed 
+ * to the installer's journal (see cfc_journal_new()).
  */
 
+static uint8_t *uplWBuf = NULL;
+static int     uplWLen = 0;
+
+static struct {
+    bool     active;
+    bool     valid;
+    int      phase;     // 0=pack header, 1=entry header, 2=entry data, 3=done, -1=bad
+    uint8_t  hbuf[32+4];
+    int      hlen;
+    int      entries;
+    uint32_t remain;
+    uint32_t total;
+    uint32_t hash;      // Over header and entries, as read by installer
+} uplPack;
+
+static void uplPackFeed(uint8_t *buf, size_t len)
+{
+    size_t t, need;
+
+    uplPack.total += len;
+
+    while(len && uplPack.phase >= 0 && uplPack.phase < 3) {
+
+        if(uplPack.phase == 2) {
+            t = (len < uplPack.remain) ? len : uplPack.remain;
+            uplPack.remain -= t;
+        } else {
+            need = (uplPack.phase ? 32+4 : 14) - uplPack.hlen;
+            t = (len < need) ? len : need;
+            memcpy(uplPack.hbuf + uplPack.hlen, buf, t);
+            uplPack.hlen += t;
+        }
+        uplPack.hash = calcHash(buf, t, uplPack.hash);
+        buf += t;
+        len -= t;
+
+        if(uplPack.phase == 0 && uplPack.hlen == 14) {
+            if(!checkPackHeader(uplPack.hbuf)) {
+                uplPack.phase = -1;
+                break;
+            }
+            uplPack.entries = uplPack.hbuf[9];
+            uplPack.hlen = 0;
+            uplPack.phase = 1;
+        } else if(uplPack.phase == 1 && uplPack.hlen == 32+4) {
+            uplPack.remain = getuint32(uplPack.hbuf + 32);
+            uplPack.hlen = 0;
+            uplPack.phase = 2;
+        }
+        if(uplPack.phase == 2 && !uplPack.remain) {
+            uplPack.phase = (--uplPack.entries) ? 1 : 3;
+        }
+    }
+}
+
 static char *allocateUploadFileName(const char *fn, int idx)
 {
     if(uploadFileNames[idx]) {
@@ -2988,29 +3684,30 @@ static char *allocateUploadFileName(const char *fn, int idx)
     return uploadRealFileNames[idx];
 }
 
-bool openUploadFile(String& fn, File& file, int idx, bool haveAC, int& opType, int& errNo)
+bool openUploadFile(const char *fn, File& file, int idx, bool haveAC, int& opType, int& errNo)
 {
     char *uploadFileName = NULL;
     bool ret = false;
+    int fnLen = strlen(fn);
     
     if(haveSD) {
 
         errNo = 0;
         opType = 0;  // 0=normal, 1=AC, -1=deletion
 
-        if(!(uploadFileName = allocateUploadFileName(fn.c_str(), idx))) {
+        if(!(uploadFileName = allocateUploadFileName(fn, idx))) {
             errNo = UPL_MEMERR;
             return false;
         }
-        strcpy(uploadFileNames[idx], fn.c_str());
+        strcpy(uploadFileNames[idx], fn);
         
         uploadFileName[0] = '/';
         uploadFileName[1] = '-';
         uploadFileName[2] = 0;
 
-        if(fn.length() > 4 && fn.endsWith(".mp3")) {
+        if(fnLen > 4 && !strcmp(fn + fnLen - 4, ".mp3")) {
 
-            strcat(uploadFileName, fn.c_str());
+            strcat(uploadFileName, fn);
 
             if((strlen(uploadFileName) > 9) &&
                (strstr(uploadFileName, "/-delete-") == uploadFileName)) {
@@ -3034,7 +3731,7 @@ bool openUploadFile(String& fn, File& file, int idx, bool haveAC, int& opType, i
                 opType = -1;
             }
 
-        } else if(fn.endsWith(".bin")) {
+        } else if(fnLen >= 4 && !strcmp(fn + fnLen - 4, ".bin")) {
 
             if(!haveAC) {
                 strcat(uploadFileName, CONFN+1);  // Skip '/', already there
@@ -3059,6 +3756,18 @@ bool openUploadFile(String& fn, File& file, int idx, bool haveAC, int& opType, i
         if(opType >= 0) {
             if((file = SD.open(uploadFileName, FILE_WRITE))) {
                 ret = true;
+                uplWLen = 0;
+                if(!uplWBuf) {
+                    // If this fails, we write through
+                    uplWBuf = (uint8_t *)malloc(UPL_WBUF_SIZE);
+                }
+                if(opType == 1) {
+                    memset((void *)&uplPack, 0, sizeof(uplPack));
+                    uplPack.active = true;
+                    uplPack.hash = 2166136261UL;
+                    // New pack: Drop install journal of old one
+                    SD.remove(CONJN);
+                }
             } else {
                 errNo = UPL_OPENERR;
             }
@@ -3075,12 +3784,62 @@ bool openUploadFile(String& fn, File& file, int idx, bool haveAC, int& opType, i
 
 size_t writeACFile(File& file, uint8_t *buf, size_t len)
 {
-    return file.write(buf, len);
+    size_t t, done = 0;
+
+    if(uplPack.active) {
+        uplPackFeed(buf, len);
+    }
+
+    if(!uplWBuf) {
+        return file.write(buf, len);
+    }
+
+    while(done < len) {
+        t = UPL_WBUF_SIZE - uplWLen;
+        if(t > len - done) t = len - done;
+        memcpy(uplWBuf + uplWLen, buf + done, t);
+        uplWLen += t;
+        done += t;
+        if(uplWLen == UPL_WBUF_SIZE) {
+            if(file.write(uplWBuf, UPL_WBUF_SIZE) != UPL_WBUF_SIZE) {
+                uplWLen = 0;
+                return 0;
+            }
+            uplWLen = 0;
+        }
+    }
+
+    return len;
 }
 
-void closeACFile(File& file)
+// Returns false if flushing the buffered tail failed
+bool closeACFile(File& file)
 {
+    bool ret = true;
+
+    if(uplWBuf && uplWLen) {
+        ret = (file.write(uplWBuf, uplWLen) == (size_t)uplWLen);
+    }
+    uplWLen = 0;
     file.close();
+
+    if(uplPack.active) {
+        uplPack.valid = ret && 
+                        (uplPack.phase == 3) && 
+                        (uplPack.total > soa + AC_OHSZ);
+        uplPack.active = false;
+        if(uplPack.valid) {
+            cfc_journal_new(uplPack.total, uplPack.hash);
+        }
+    }
+
+    return ret;
+}
+
+// Result of streamed validation of the last uploaded sound pack
+bool checkUploadedPack()
+{
+    return uplPack.valid;
 }
 
 void removeACFile(int idx)
@@ -3110,6 +3869,10 @@ char *getUploadFileName(int idx)
 
 void freeUploadFileNames()
 {
+    if(uplWBuf) {
+        free(uplWBuf);
+        uplWBuf = NULL;
+    }
     for(int i = 0; i < MAX_SIM_UPLOADS; i++) {
         if(uploadFileNames[i]) {
             free(uploadFileNames[i]);
@@ -3171,6 +3934,7 @@ static void firmware_update()
 {
     const char *upderr = "Firmware update error %d\n";
     uint8_t  buf[1024];
+    char     md5[33];
     unsigned int lastMillis = millis();
     bool     leds = false;
     size_t   s;
@@ -3192,6 +3956,11 @@ static void firmware_update()
         return;
     }
 
+    if(readFileFromSD(fwmd5fn, (uint8_t *)md5, 32)) {
+        md5[32] = 0;
+        Update.setMD5(md5);
+    }
+
     while((s = myFile.read(buf, 1024))) {
         if(Update.write(buf, s) != s) {
             break;
@@ -3211,10 +3980,293 @@ static void firmware_update()
     myFile.close();
     // Rename/remove in any case, we don't
     // want an update loop hammer our flash
-    SD.remove(fwfnold);
-    SD.rename(fwfn, fwfnold);
+    fwupd_discard();
     unmount_fs();
     delay(1000);
     fw_error_blink(0);
     esp_restart();
-}    
+}
+
+/*
+ * Firmware update from SD card
+ *
+ * If /tcdfw.bin is found at boot, a task on core 0 streams it into 
+ * the inactive OTA partition while the main loop keeps running. Each
+ * chunk erases a flash sector, which briefly stalls both cores; the 
+ * longest main loop gap seen during the write is logged with the 
+ * throughput. The image header is checked on the first chunk; Update 
+ * hashes the image as it goes and verifies it (including an optional 
+ * MD5 from /tcdfw.md5) in Update.end(), which the task calls as well, 
+ * and which also switches the boot partition. The image file is 
+ * renamed right after, and only the reboot is deferred to a quiet 
+ * moment (fake-off or night mode); if the clock is powered off 
+ * before that, the new firmware simply runs at next boot.
+ * A marker file is kept while the image is being written; if it is
+ * found at boot, the blocking update above is done instead.
+ */
+
+#define FWU_CHUNK   4096      // Flash sector size
+
+#define FWU_IDLE    0
+#define FWU_WRITING 1         // Task writing image
+#define FWU_WRITTEN 2         // Task done, result not yet evaluated
+#define FWU_READY   3         // Installed, waiting for quiet moment to reboot
+#define FWU_ERROR   4
+
+static volatile int      fwuState = FWU_IDLE;
+static volatile bool     fwuAbort = false;
+static volatile int      fwuErr = 0;
+static volatile uint32_t fwuBytes = 0;
+static uint32_t          fwuTotal = 0;
+static unsigned long     fwuStart = 0;
+static volatile unsigned long fwuDur = 0;
+static unsigned long     fwuErrNow = 0;
+static unsigned long     fwuReadyNow = 0;
+static unsigned long     fwuLoopNow = 0;
+static unsigned long     fwuMaxGap = 0;
+static File              fwuFile;
+
+static bool fwupd_checkHeader(uint8_t *buf, size_t len)
+{
+    // esp_image_header_t: magic, segment count, ..., chip id @12 (ESP32 = 0);
+    // esp_app_desc_t follows the first segment header @32
+    return (len >= 36)                        &&
+           (buf[0] == 0xe9)                   &&
+           (buf[1] > 0 && buf[1] <= 16)       &&
+           (!buf[12] && !buf[13])             &&
+           (getuint32(buf + 32) == 0xabcd5432);
+}
+
+static void fwupdTask(void *parameter)
+{
+    uint8_t *buf = (uint8_t *)malloc(FWU_CHUNK);
+    bool    first = true;
+    size_t  s;
+    int     err = 0;
+
+    if(!buf) err = 1;
+
+    while(!err && !fwuAbort && (s = fwuFile.read(buf, FWU_CHUNK))) {
+        if(first) {
+            if(!fwupd_checkHeader(buf, s)) {
+                err = 2;
+                break;
+            }
+            first = false;
+        }
+        if(Update.write(buf, s) != s) {
+            err = 3;
+            break;
+        }
+        fwuBytes += s;
+        // Let others access SD and flash
+        vTaskDelay(1);
+    }
+
+    if(!err && (fwuAbort || fwuBytes != fwuTotal)) err = 4;
+
+    if(buf) free(buf);
+    fwuFile.close();
+
+    // Verify image and switch boot partition
+    if(!err && !Update.end()) err = 5;
+
+    fwuDur = millis() - fwuStart;
+    fwuErr = err;
+    fwuState = FWU_WRITTEN;
+
+    vTaskDelete(NULL);
+}
+
+// Rename/remove in any case, we don't
+// want an update loop hammer our flash
+static void fwupd_discard()
+{
+    SD.remove(fwfnold);
+    SD.rename(fwfn, fwfnold);
+    SD.remove(fwmd5fn);
+    SD.remove(fwfnbgu);
+}
+
+static void fwupd_error(int err)
+{
+    Serial.printf("Firmware update error %d/%d\n", err, Update.getError());
+    fwupd_discard();
+    fwuErrNow = millis();
+    fwuState = FWU_ERROR;
+}
+
+static void fwupd_start()
+{
+    char md5[33];
+
+    if(!(fwuFile = SD.open(fwfn, FILE_READ)))
+        return;
+
+    fwuTotal = fwuFile.size();
+
+    if(!Update.begin(fwuTotal)) {
+        fwuFile.close();
+        fwupd_error(0);
+        return;
+    }
+
+    if(readFileFromSD(fwmd5fn, (uint8_t *)md5, 32)) {
+        md5[32] = 0;
+        Update.setMD5(md5);
+    }
+
+    // Mark update as in progress
+    File myFile = SD.open(fwfnbgu, FILE_WRITE);
+    if(myFile) myFile.close();
+
+    fwuBytes = 0;
+    fwuErr = 0;
+    fwuAbort = false;
+    fwuStart = fwuLoopNow = millis();
+    fwuMaxGap = 0;
+    fwuState = FWU_WRITING;
+
+    if(xTaskCreatePinnedToCore(fwupdTask, "fwupd", 4096, NULL, 1, NULL, 0) != pdPASS) {
+        // Try again at next boot
+        Update.abort();
+        fwuFile.close();
+        fwuState = FWU_IDLE;
+        return;
+    }
+
+    Serial.printf("Firmware update: Writing %u bytes\n", (unsigned int)fwuTotal);
+}
+
+static void fwupd_reboot()
+{
+    Serial.println("Firmware update: Rebooting");
+
+    prepareReboot();
+    delay(1000);
+    esp_restart();
+}
+
+/*
+ * fwupd_loop()
+ *
+ * Starts the background update, evaluates its result and 
+ * reboots at a quiet moment.
+ */
+void fwupd_loop()
+{
+    unsigned long now;
+
+    switch(fwuState) {
+    case FWU_WRITING:
+        now = millis();
+        if(now - fwuLoopNow > fwuMaxGap) fwuMaxGap = now - fwuLoopNow;
+        fwuLoopNow = now;
+        break;
+    case FWU_IDLE:
+        if(fwuPending && !(csf & (CSF_ST|CSF_BOOTSTRAP))) {
+            fwuPending = false;
+            fwupd_start();
+        }
+        break;
+    case FWU_WRITTEN:
+        if(fwuErr) {
+            fwupd_error(fwuErr);
+            Update.abort();
+        } else {
+            fwupd_discard();
+            Serial.printf("Firmware update: %u bytes written in %lums (%u bytes/s), longest main loop gap %lums; reboot at fake-off, night mode or power-up\n", 
+                (unsigned int)fwuBytes, fwuDur, 
+                fwuDur ? (unsigned int)(((uint64_t)fwuBytes * 1000) / fwuDur) : 0,
+                fwuMaxGap);
+            fwuReadyNow = millis();
+            fwuState = FWU_READY;
+        }
+        break;
+    case FWU_READY:
+        if((csf & (CSF_OFF|CSF_NM)) &&
+           !(csf & (CSF_P0|CSF_P1|CSF_RE|CSF_P2|CSF_ST|CSF_MA))) {
+            fwupd_reboot();
+        }
+        break;
+    case FWU_ERROR:
+        if(millis() - fwuErrNow > 30*1000) {
+            fwuState = FWU_IDLE;
+        }
+        break;
+    }
+}
+
+/*
+ * fwupd_getText()
+ *
+ * Progress text for a display; false if no update in progress.
+ */
+bool fwupd_getText(char *buf, int len)
+{
+    unsigned long el;
+
+    switch(fwuState) {
+    case FWU_WRITING:
+        el = millis() - fwuStart;
+        if(((el / 2000) & 1) && el) {
+            snprintf(buf, len, "FW %uKB/S", 
+                (unsigned int)((((uint64_t)fwuBytes * 1000) / el) / 1024));
+        } else {
+            snprintf(buf, len, "FW UPD %d%%", 
+                fwuTotal ? (int)(((uint64_t)fwuBytes * 100) / fwuTotal) : 0);
+        }
+        return true;
+    case FWU_WRITTEN:
+        snprintf(buf, len, "FW READY");
+        return true;
+    case FWU_READY:
+        if(millis() - fwuReadyNow < 30*1000) {
+            snprintf(buf, len, "FW READY");
+            return true;
+        }
+        break;
+    case FWU_ERROR:
+        snprintf(buf, len, "FW ERROR");
+        return true;
+    }
+
+    return false;
+}
+
+/*
+ * fwupd_stop()
+ *
+ * Abort a running image write and wait for the task to end, so
+ * that SD can be unmounted and Update is free for others (OTA).
+ * If discard is true, the SD image is dropped (superseded by a
+ * web OTA); otherwise the marker stays and the image is installed
+ * by the boot-time fallback.
+ */
+void fwupd_stop(bool discard)
+{
+    fwuPending = false;
+
+    if(fwuState == FWU_WRITING) {
+        fwuAbort = true;
+        // Task checks fwuAbort after each chunk
+        while(fwuState == FWU_WRITING) {
+            delay(10);
+        }
+    }
+
+    if(fwuState == FWU_WRITTEN) {
+        if(fwuErr) {
+            Update.abort();
+            if(discard || !fwuAbort) {
+                fwupd_discard();
+            }
+        } else {
+            // Installed, just not evaluated yet
+            fwupd_discard();
+        }
+        fwuState = FWU_IDLE;
+    } else if(discard && haveSD && SD.exists(fwfn)) {
+        fwupd_discard();
+    }
+}
@@ -97,6 +97,10 @@ void saveLineOut();
 void saveRemoteAllowed();
 #endif
 
+#ifdef TC_HAVELIGHT
+void saveAutoBri();
+#endif
+
 #ifdef SERVOSPEEDO
 void loadServoCorr(int& scorr, int& tcorr);
 void saveServoCorr(int scorr, int tcorr);
@@ -130,6 +134,23 @@ void delete_ID_file();
 void reInstallFlashFS();
 void moveSettings();
 
+typedef struct {
+    uint32_t queued;        // bytes currently queued
+    uint32_t peakQueued;
+    uint32_t writes;
+    uint32_t coalesced;     // writes replaced before hitting the medium
+    uint32_t fails;
+    uint32_t lastLat;       // ms spent in last write
+    uint32_t maxLat;
+} persStats;
+
+void persist_flush();
+void persist_getStats(persStats *s);
+
+void fwupd_loop();
+void fwupd_stop(bool discard);
+bool fwupd_getText(char *buf, int len);
+
 #define MAX_SIM_UPLOADS 16
 #define UPL_OPENERR 1
 #define UPL_NOSDERR 2
@@ -138,10 +159,12 @@ void moveSettings();
 #define UPL_MEMERR  5
 #define UPL_UNKNOWN 6
 #define UPL_DPLBIN  7
+#define UPL_WBUF_SIZE 8192    // Upload write buffer; multiple of SD sector size
 #include <FS.h>
-bool   openUploadFile(String& fn, File& file, int idx, bool haveAC, int& opType, int& errNo);
+bool   openUploadFile(const char *fn, File& file, int idx, bool haveAC, int& opType, int& errNo);
 size_t writeACFile(File& file, uint8_t *buf, size_t len);
-void   closeACFile(File& file);
+bool   closeACFile(File& file);
+bool   checkUploadedPack();
 void   removeACFile(int idx);
 void   renameUploadFile(int idx);
 char   *getUploadFileName(int idx);
@@ -202,6 +225,8 @@ extern int        stachopin;
 #define DEF_AUTONM_OFF      0
 #define DEF_USE_LIGHT       0     // 0: Ignore light sensor, 1: use sensor
 #define DEF_LUX_LIMIT       3     // Lux threshold for night mode
+#define DEF_ABRI_LUX_LO     5     // Auto brightness: Lux for lowest brightness
+#define DEF_ABRI_LUX_HI     300   // Auto brightness: Lux for configured brightness
 #define DEF_CFG_ON_SD       1     // 1: Save secondary settings on SD, 0: Do not (use internal Flash)
 #define DEF_TIMES_PERS      0     // 0: Timetravels not persistent; 1: TT persistent
 #define DEF_SD_FREQ         0     // 0: SD/SPI frequency: Default 16MHz
@@ -58,7 +58,6 @@
 #include <Arduino.h>
 #include <time.h>
 #include <WiFi.h>
-#include <Wire.h>
 #include <Udp.h>
 #include <WiFiUdp.h>
 
@@ -66,6 +65,11 @@
 #include "tc_audio.h"
 #include "tc_wifi.h"
 #include "tc_settings.h"
+#include "tc_i2c.h"
+#include "tc_anim.h"
+#include "tc_evbus.h"
+#include "tc_sched.h"
+#include "tc_ttplan.h"
 #if defined(TC_HAVE_RE) || defined(TC_HAVE_REMOTE)
 #include "input.h"
 #endif
@@ -138,8 +142,7 @@
 #define TT_P1_DELAY_P3  (5800-(TT_P1_DELAY_P2+TT_P1_DELAY_P1))                                      // Off
 #define TT_P1_DELAY_P4  (6800-(TT_P1_DELAY_P3+TT_P1_DELAY_P2+TT_P1_DELAY_P1))                       // Random display I
 #define TT_P1_DELAY_P5  (TT_P1_TOTAL-(TT_P1_DELAY_P4+TT_P1_DELAY_P3+TT_P1_DELAY_P2+TT_P1_DELAY_P1)) // Random display II
-// ACTUAL POINT OF TIME TRAVEL:
-#define TT_P1_POINT88   1400    // ms into "starttravel" sample, when 88mph is reached.
+// ACTUAL POINT OF TIME TRAVEL: TT_P1_POINT88 (tc_ttplan.h)
 #define TT_P1_EXT       TT_P1_TOTAL - TT_P1_DELAY_P1   // part of P1 between P0 and P2
 
 // Speedo display status
@@ -150,13 +153,6 @@
 #define SPST_ZERO 4
 #define SPST_REM  5
 
-// Preprocessor config for External Time Travel Output (ETTO):
-// Lead time from trigger (LOW->HIGH) to actual tt (ie when 88mph is reached)
-// The external prop has ETTO_LEAD_TIME ms to play its pre-tt sequence. After
-// ETTO_LEAD_TIME ms, 88mph is reached, and the actual tt takes place.
-#define ETTO_LEAD_TIME      5000
-#define ETTO_LAT              50  // DO NOT CHANGE
-
 // Native NTP
 #define NTP_PACKET_SIZE 48
 #define NTP_DEFAULT_LOCAL_PORT 1337
@@ -191,6 +187,16 @@ static unsigned long deferredCPNow = 0;
 static bool          x = false;  
 static bool          y = false;
 
+// SQW edges, captured by ISR
+#define SQW_RING_SIZE 8     // power of 2
+static volatile unsigned long sqwTime[SQW_RING_SIZE];
+static volatile uint8_t       sqwLevel[SQW_RING_SIZE];
+static volatile uint8_t       sqwHead = 0;
+static uint8_t                sqwTail = 0;
+static unsigned long          sqwLate = 0;      // ms between edge and its processing
+static unsigned long          sqwMaxLate = 0;
+static uint32_t               sqwDropped = 0;   // edges lost through ring overrun
+
 // For beep-auto-modes
 uint8_t              beepMode = DEF_BEEP;
 bool                 beepTimer = false;
@@ -247,7 +253,6 @@ static uint32_t sigFlags = 0;
 bool                 ETTOcommands = false;
 static bool          ETTOalarm = false;
 static unsigned long ETTOAlmDur = DEF_ETTO_ALM_D * 1000;
-static unsigned long ETTOAlmNow = 0;
 
 // Speedo & GPS stuff
 uint32_t             sgf = 0;
@@ -256,8 +261,6 @@ static unsigned long timetravelP0Now = 0;
 static unsigned long timetravelP0Delay = 0;
 static unsigned long ttP0Now = 0;
 static int           timeTravelP0Speed = 0;
-static long          pointOfP1 = 0;
-static long          pointOfP1NoLead = 0;
 static float         ttP0TimeFactor = 1.0f;
 
 uint32_t             ttinpin = 0;    // 0=TT_IN,  1=Servo Speedo, 2=Servo Tacho
@@ -334,14 +337,45 @@ static long          triggerP1LeadTime = 0;
 static bool          ETTWithFixedLead = false;
 static bool          useETTOWired = false;
 static bool          useETTOWiredNoLead = false;
-static const long    ettoLeadTime = ETTO_LEAD_TIME - ETTO_LAT;
 static bool          triggerETTO = false;
 static long          triggerETTOLeadTime = 0;
 static unsigned long triggerETTONow = 0;
-static long          ettoLeadPoint = 0;
-static long          origEttoLeadPoint = 0;
 static uint16_t      bttfnTTLeadTime = 0;
-static long          ettoBase;
+
+#ifdef TC_TT_TRACE
+// Time travel event timeline
+#define TTR_MAX 48
+enum {
+    TTR_TRIGGER = 0,    // arg: doComplete | (withSpeedo << 1) | (forceNoLead << 2)
+    TTR_P0START,        // arg: start speed
+    TTR_SPEED88,        // arg: speed (88 displayed on speedo)
+    TTR_PREPARE,        // PREPARE sent to network
+    TTR_NETTT,          // TT sent to network; arg: lead time
+    TTR_ETTO_ON,        // arg: ETTO timer lateness in main loop (ms)
+    TTR_ETTO_OFF,
+    TTR_P1START,        // arg: noLead
+    TTR_P1PHASE,        // arg: phase
+    TTR_REENTRY,
+    TTR_DONE,           // displays back on
+    TTR_P2END           // arg: final speed
+};
+static const char * const ttrNames[] = {
+    "trigger", "P0 start", "speedo 88", "net PREPARE", "net TT", "ETTO on", 
+    "ETTO off", "P1 start", "P1 phase", "re-entry", "displays on", "P2 end"
+};
+static struct {
+    unsigned long t;
+    uint8_t       ev;
+    long          arg;
+} ttTrace[TTR_MAX];
+static int           ttTraceNum = 0;
+static unsigned long ttTraceNow = 0;
+static void ttTraceAdd(uint8_t ev, long arg = 0);
+static void ttTraceDump();
+#define TT_TRACE(e, a) ttTraceAdd(e, a)
+#else
+#define TT_TRACE(e, a)
+#endif
 static bool          pubMQTTVL = false;
 #ifdef TC_HAVE_REMOTE
 static bool          remoteInducedTT = false;
@@ -365,7 +399,25 @@ static const char * const p1errStrs[4] = {
 static unsigned long timetravelNow = 0;
 
 // CPU power management
+// The governor steps down through pwrFreqs while loop latency
+// (predicted for the next lower frequency) stays within budget.
+#define PWR_WINDOW      10000   // Evaluation window (ms)
+#define PWR_LOOP_BUDGET 15000   // Max main loop latency (us)
+#define PWR_FULL_HOLD   (5*60*1000)
+#define PWR_EVENT_HOLD  (20*1000)   // Full speed around predicted events
+static const uint16_t pwrFreqs[]  = { 240, 160, 80 };
+#define PWR_NUM_LVL     3
 static unsigned long pwrFullNow = 0;
+static unsigned long pwrEventNow = 0;
+static uint8_t       pwrLevel = 0;
+static unsigned long pwrWindowNow = 0;
+static unsigned long pwrLastLoopUs = 0;
+static unsigned long pwrMaxLoopUs = 0;
+static unsigned long pwrLevelNow = 0;
+static uint64_t      pwrLevelTime[PWR_NUM_LVL] = { 0 };
+#ifdef TC_DBG_PWR
+static unsigned long pwrReportNow = 0;
+#endif
 
 // State flags & co
 static unsigned long lastAuthTime = 0;
@@ -475,9 +527,7 @@ static const uint8_t rtcAddr[RTC_NUMTYPES*2] = {
 tcRTC rtc(RTC_NUMTYPES, rtcAddr);
 #ifdef HAVE_PCF2129
 static unsigned long OTPRDoneNow = 0;
-static unsigned long OTPRStarted = 0;
 static bool          RTCNeedsOTPR = false;
-static bool          OTPRinProgress = false;
 #endif
 
 // The GPS object
@@ -603,8 +653,19 @@ static uint8_t autoNMOffHour = 0;
 static int8_t  timedNightMode = -1;
 static int8_t  sensorNightMode = -1;
 int8_t         manualNightMode = -1;
-unsigned long  manualNMNow = 0;
 int32_t        luxLimit = 3;
+#ifdef TC_HAVELIGHT
+// Auto brightness
+#define ABRI_INTERVAL   250     // Controller interval (ms)
+#define ABRI_STEP_INT   750     // Rate limit: Min ms between two steps (per display)
+#define ABRI_HYST       48      // Hysteresis (1/256 levels)
+bool           autoBri = false;
+uint16_t       abriLuxLo = DEF_ABRI_LUX_LO;
+uint16_t       abriLuxHi = DEF_ABRI_LUX_HI;
+static int32_t abriLux = -1;    // Filtered lux (<< 4)
+static unsigned long abriNow = 0;
+static unsigned long abriStepNow[4] = { 0 };
+#endif
 static const uint32_t autoNMhomePreset[7] = {     // Mo-Th 5pm-11pm, Fr 1pm-1am, Sa 9am-1am, Su 9am-11pm
         0b011111111000000000000001,   //Sun
         0b111111111111111110000001,   //Mon
@@ -659,6 +720,9 @@ const uint32_t *autoNMPresets[AUTONM_NUM_PRESETS] = {
 #ifdef TC_HAVELIGHT
 static unsigned long lastLoopLight = 0;
 #endif
+#ifdef TC_DBG_I2C
+static unsigned long i2cStatsNow = 0;
+#endif
 
 // Reminder
 uint8_t remMonth = 0;
@@ -855,33 +919,9 @@ static const uint64_t tdro = 5258964960;
 #define a(f, j) (f << (*monthDays - j))
 uint8_t* e(uint8_t *d, uint32_t m, int y) { return (*r)(d, m, y); }
 
-// Acceleraton times
-static const int16_t tt_p0_delays_rl[88] =
-{
-      0, 100, 100,  90,  80,  80,  80,  80,  80,  80,  // 0 - 9  10mph 0.8s    0.8=800ms
-     80,  80,  80,  80,  80,  80,  80,  80,  80,  80,  // 10-19  20mph 1.6s    0.8
-     90, 100, 110, 110, 110, 110, 110, 110, 120, 120,  // 20-29  30mph 2.7s    1.1
-    120, 130, 130, 130, 130, 130, 130, 130, 130, 140,  // 30-39  40mph 4.0s    1.3
-    150, 160, 190, 190, 190, 190, 190, 190, 210, 230,  // 40-49  50mph 5.9s    1.9
-    230, 230, 240, 240, 240, 240, 240, 240, 250, 250,  // 50-59  60mph 8.3s    2.4
-    250, 250, 260, 260, 270, 270, 270, 280, 290, 300,  // 60-69  70mph 11.0s   2.7
-    320, 330, 350, 370, 370, 380, 380, 390, 400, 410,  // 70-79  80mph 14.7s   3.7
-    410, 410, 410, 410, 410, 410, 410, 410             // 80-87  90mph 18.8s   4.1
-};
-static const int16_t tt_p0_delays_movie[88] =
-{
-      0,  90,  90,  90,  90,  90,  90,  95,  95, 100,  // m0 - 9  10mph  0- 9: 0.83s  (m=measured, i=interpolated)
-    105, 110, 115, 120, 125, 130, 135, 140, 145, 150,  // i10-19  20mph 10-19: 1.27s
-    155, 160, 165, 170, 175, 180, 185, 190, 195, 200,  // i20-29  30mph 20-29: 1.77s
-    200, 200, 202, 203, 204, 205, 206, 207, 208, 209,  // m30-39  40mph 30-39: 2s
-    210, 211, 212, 213, 214, 215, 216, 217, 218, 219,  // i40-49  50mph 40-49: 2.1s
-    220, 221, 222, 223, 224, 225, 226, 227, 228, 229,  // m50-59  60mph 50-59: 2.24s
-    230, 233, 236, 240, 243, 246, 250, 253, 256, 260,  // i60-69  70mph 60-69: 2.47s
-    263, 266, 270, 273, 276, 280, 283, 286, 290, 293,  // m70-79  80mph 70-79: 2.78s
-    296, 300, 300, 303, 303, 306, 310, 310             // i80-88  90mph 80-88: 2.4s   total 17.6 secs
-};
+// Acceleration curve (tables in tc_ttplan.cpp)
 static const int16_t *tt_p0_delays = tt_p0_delays_movie;
-static long tt_p0_totDelays[88];
+static ttCurve ttCrv;
 
 // BTTF-Network
 bool bttfnHaveClients = false;
@@ -928,6 +968,15 @@ bool bttfnHaveClients = false;
 #define BTTF_PACKET_SIZE          48
 #define BTTF_DEFAULT_LOCAL_PORT 1338
 #define BTTFN_MAX_CLIENTS          6
+#define BTTFN_SPD_MIN_INT         40    // Min interval between NOT_SPD (ms); ie max 25 updates/sec
+#define BTTFN_DATA_FULL_INT       10    // Delta NOT_DATA: Full packet at least every n seconds
+#define BTTFN_CF_ND             0x01    // Client flags: Supports NOT_DATA
+#define BTTFN_CF_MC             0x02    //   Supports MC notifications
+#define BTTFN_CF_COMPR          0x04    //   Wants compressed times in NOT_DATA
+#define BTTFN_CF_DELTA          0x08    //   Supports delta NOT_DATA
+#define BTTFN_REPLYQ_SIZE          4    // Replies batched before sending
+#define BTTFN_DRAIN_BUDGET      2000    // Max us spent receiving per bttfn_loop()
+#define BTTFN_SNAP_MAXAGE        100    // Max age of data snapshot (ms)
 struct _bttfnClient {
     unsigned long ALIVE;
     #ifdef TC_HAVE_REMOTE
@@ -953,10 +1002,23 @@ static _bttfnClient  bttfnClient[BTTFN_MAX_CLIENTS];
 static uint8_t       bttfnDateBuf[8];
 static uint32_t      bttfnSeqCnt = 1;
 static uint32_t      bttfnDataSeqCnt = 1;
-static unsigned long bttfnlastExpire = 0;
+static bool          bttfnExpireDue = false;
 static uint32_t      hostNameHash = 0;
 static uint32_t      bttfnSessionID = 0;
-static byte          BTTFMCBuf[BTTF_PACKET_SIZE];
+static struct {
+    uint32_t         IP32;
+    byte             buf[BTTF_PACKET_SIZE];
+} bttfnReplyQ[BTTFN_REPLYQ_SIZE];   // Requests are read & answered in place
+static int           bttfnReplyNum = 0;
+static struct {
+    byte             buf[BTTF_PACKET_SIZE]; // All data fields at packet offsets
+    uint8_t          spdFlags;      // bits in buf[26] belonging to speed,
+    uint8_t          tempFlags;     // temperature and
+    uint8_t          statFlags;     // status
+    uint8_t          seq;           // Bumped when content changes, never 0
+    unsigned long    when;
+} bttfnSnap;
+static bool          bttfnSnapDirty = true;
 static uint8_t       bttfnNotAllSupportMC = 0;
 static uint8_t       bttfnAtLeastOneMC = 0;
 static uint8_t       bttfnAtLeastOneND = 0;
@@ -964,8 +1026,33 @@ static uint8_t       bttfnDataParm = 0;
 static int           oldBTTFNSpd = -2;
 static uint16_t      oldBTTFNSSrc = 0xffff;
 static unsigned long bttfnLastSpeedNot = 0;
+static int           bttfnPendSpd = -3;
 static unsigned long bttfnLastDataNot = 0;
 static unsigned long bttfnLastInfo = 0;
+static uint8_t       bttfnNotAllDelta = 0;
+static bool          bttfnDataFull = true;
+static uint8_t       bttfnDataSinceFull = 0;
+static byte          BTTFLastDataBuf[BTTF_PACKET_SIZE];
+static uint32_t      bttfnSpdSent = 0, bttfnSpdSaved = 0;
+static uint32_t      bttfnDataSent = 0, bttfnDataDelta = 0, bttfnDataSaved = 0;
+#ifdef TC_BTTFN_BENCH
+static struct {
+    uint32_t      loops;
+    uint32_t      skipped[4];       // per BNLP_SK_* bit
+    uint32_t      reqs;
+    uint32_t      replies;
+    uint32_t      dropped;          // bad header/checksum/version
+    uint32_t      sendFail;
+    uint32_t      expired;
+    uint32_t      maxHandleUs;
+    uint32_t      sumHandleUs;      // for average per-packet service time
+    uint32_t      maxBurst;         // max packets drained in one call
+    unsigned long lastSPPoll;
+    unsigned long maxSPGap;         // max time between unicast socket polls
+    unsigned long lastMCPoll;
+    unsigned long maxMCGap;         // max time between multicast socket polls
+} bttfnBench;
+#endif
 static int           TCDBusyStatus = 0;
 #ifdef TC_HAVE_REMOTE
 static uint32_t      registeredRemID  = 0;
@@ -1039,6 +1126,14 @@ static void updateTemperature(bool force = false);
 static bool dispTemperature(bool force = false);
 #endif
 static void dispIdleZero(bool force = false);
+static void pwrGovernor(unsigned long now);
+static void pwrPredict(int compHour, int compMin);
+static void IRAM_ATTR sqwISR();
+static bool sqwEdgePending();
+static bool sqwNextEdge(bool& level);
+#ifdef TC_HAVELIGHT
+static void autoBri_loop();
+#endif
 #ifdef TC_HAVE_RE                
 static void re_init(bool zero = true);
 static void re_lockTemp();
@@ -1074,6 +1169,68 @@ static void bttfn_notify_speed();
 static void bttfn_send_autoUpdates();
 static void bttfn_setup();
 static void bttfn_setup_sensors();
+#ifdef TC_BTTFN_BENCH
+static void bttfn_bench_loop(uint32_t taskMask);
+static void bttfn_bench_print();
+#endif
+
+/*
+ * SQW edge capture
+ *
+ * The ISR records level and time of every SQW edge; time_loop()
+ * processes them in order, even if an iteration took longer than
+ * half a second.
+ */
+static void IRAM_ATTR sqwISR()
+{
+    uint8_t h = sqwHead;
+    
+    sqwTime[h & (SQW_RING_SIZE - 1)] = millis();
+    sqwLevel[h & (SQW_RING_SIZE - 1)] = digitalRead(SECONDS_IN_PIN);
+    sqwHead = h + 1;
+}
+
+static bool sqwEdgePending()
+{
+    return (sqwHead != sqwTail);
+}
+
+static bool sqwNextEdge(bool& level)
+{
+    unsigned long t;
+    uint8_t n;
+    int i;
+    
+    do {
+        if(!(n = sqwHead - sqwTail))
+            return false;
+        if(n > SQW_RING_SIZE) {
+            sqwDropped += n - SQW_RING_SIZE;
+            sqwTail += n - SQW_RING_SIZE;
+        }
+        i = sqwTail & (SQW_RING_SIZE - 1);
+        t = sqwTime[i];
+        level = !!sqwLevel[i];
+        // Re-check in case ISR overwrote our slot meanwhile
+    } while((uint8_t)(sqwHead - sqwTail) > SQW_RING_SIZE);
+    
+    sqwTail++;
+
+    sqwLate = millis() - t;
+    if(sqwLate > sqwMaxLate) {
+        sqwMaxLate = sqwLate;
+        #ifdef TC_DBG_TIME
+        Serial.printf("SQW: New max edge lateness %lums (%u dropped)\n", sqwMaxLate, sqwDropped);
+        #endif
+    }
+
+    return true;
+}
+
+unsigned long sqwMaxLateness()
+{
+    return sqwMaxLate;
+}
 
 /*
  * time_boot()
@@ -1127,6 +1284,8 @@ void time_setup()
 
     // Pin for monitoring seconds from RTC
     pinMode(SECONDS_IN_PIN, INPUT_PULLDOWN);
+    x = y = digitalRead(SECONDS_IN_PIN);
+    attachInterrupt(digitalPinToInterrupt(SECONDS_IN_PIN), sqwISR, CHANGE);
 
     // Init fake power switch
     useFakePowerSwitch = evalBool(settings.fakePwrOn);
@@ -1771,24 +1930,8 @@ void time_setup()
         if(ttP0TimeFactor < 0.5f) ttP0TimeFactor = 0.5f;
         if(ttP0TimeFactor > 5.0f) ttP0TimeFactor = 5.0f;
 
-        // Calculate start point of P1 sequence
-        for(int i = 1; i < 88; i++) {
-            pointOfP1 += (unsigned long)(((float)(tt_p0_delays[i])) / ttP0TimeFactor);
-        }
-        ettoBase = pointOfP1;
-        ettoLeadPoint = origEttoLeadPoint = ettoBase - ettoLeadTime;   // Can be negative!
-        pointOfP1NoLead = pointOfP1;  // for lead-less P1
-        pointOfP1 -= TT_P1_POINT88;   // for normal P1
-
-        {
-            // Calculate total elapsed time for each mph value
-            // (in order to time P0/P1 relative to current actual speed)
-            long totDelay = 0;
-            for(int i = 0; i < 88; i++) {
-                totDelay += (long)(((float)(tt_p0_delays[i])) / ttP0TimeFactor);
-                tt_p0_totDelays[i] = totDelay;
-            }
-        }
+        // Calculate P1 start points and elapsed time for each mph value
+        ttplan_init(&ttCrv, tt_p0_delays, ttP0TimeFactor);
 
         if(sgf & SGF_USpeedoDisp) {
             speedo.off();
@@ -2084,6 +2227,42 @@ void time_setup()
     csf &= ~CSF_BOOTSTRAP;
 }
 
+/*
+ * Time travel display glitch frames
+ * (ii = number of remaining frames)
+ */
+static void ttGlitch1(int ii)
+{
+    int tt = rand() % 21;
+    
+    if(tt < 5) destinationTime.show();
+    else {
+        destinationTime.showTextDirect(p1errStrs[(tt - 5) >> 2], CDT_COLON);
+    }
+    if(!(ii % 2)) destinationTime.setBrightnessDirect((1+(rand() % 10)) & 0x0a);
+    if(ii % 2) presentTime.setBrightnessDirect((1+(rand() % 10)) & 0x0b);
+    ((rand() % 10) < 3) ? departedTime.showTextDirect(">ACS2011GIDUW") : departedTime.show();
+    if(ii % 2) departedTime.setBrightnessDirect((1+(rand() % 10)) & 0x07);
+}
+
+static void ttGlitch2(int ii)
+{
+    int tt = rand() % 10;
+    
+    if(!(ii % 4))   presentTime.setBrightnessDirect(1+(rand() % 8));
+    if(tt < 3)      { presentTime.setBrightnessDirect(4); presentTime.showPattern(true); }
+    else if(tt < 7) { presentTime.show(); presentTime.on(); }
+    else            { presentTime.off(); }
+    tt = (rand() + millis()) % 10;
+    if(tt < 2)      { destinationTime.showTextDirect(p1errStrs[rand() % 4], CDT_COLON); }
+    else if(tt < 6) { destinationTime.show(); destinationTime.on(); }
+    else            { if(!(ii % 2)) destinationTime.setBrightnessDirect(1+(rand() % 8)); }
+    tt = (tt + (rand() + millis())) % 10;
+    if(tt < 4)      { departedTime.setBrightnessDirect(4); departedTime.showPattern(true); }
+    else if(tt < 7) { departedTime.showTextDirect("R 2 0 1 1 T R "); }
+    else            { departedTime.show(); }
+}
+
 /*
  * time_loop()
  *
@@ -2096,6 +2275,62 @@ void time_loop()
     const char *funcName = "time_loop: ";
     #endif
 
+    // Power governor: Main loop latency
+    {
+        unsigned long us = micros();
+        if(us - pwrLastLoopUs > pwrMaxLoopUs) pwrMaxLoopUs = us - pwrLastLoopUs;
+        pwrLastLoopUs = us;
+    }
+
+    // One-shot timers
+    {
+        int id;
+        while((id = sched_next(millisNow)) >= 0) {
+            switch(id) {
+            case SCH_CTDOWN:
+                ctDown = 0;
+                sigFlags |= SF_TQ;
+                break;
+            case SCH_SNOOZE:
+                snoozeNow = 0;
+                sigFlags |= SF_SQ;
+                break;
+            case SCH_ETTOALM:
+                // TTOUT alarm signalling timeout
+                setTTOUTpin(LOW);
+                break;
+            case SCH_BEEP:
+                // Beep auto modes
+                muteBeep = true;
+                beepTimer = false;
+                break;
+            case SCH_MANNM:
+                // Manually switching NM pauses automatic for 30 mins;
+                // re-evaluate auto-nm immediately after
+                manualNightMode = -1;
+                forceReEvalANM = true;
+                break;
+            case SCH_BTEXP:
+                // Expire at next opportunity (bttfn_loop)
+                bttfnExpireDue = true;
+                break;
+            #ifdef HAVE_PCF2129
+            case SCH_OTPR:
+                // End of OTPR for PCF2129
+                rtc.OTPRefresh(false);
+                OTPRDoneNow = millisNow;
+                break;
+            #endif
+            }
+        }
+    }
+
+    // Keep sensors and GPS off the i2c bus during sequences
+    // with frequent display updates
+    if(csf & (CSF_P0|CSF_P1|CSF_RE|CSF_P2|CSF_ST)) {
+        i2c_reserve(100);
+    }
+
     if(useFakePowerSwitch || (csf & (CSF_MQTTPM|CSF_RPM|CSF_RESTOREFP))) {
 
         csf &= ~CSF_RESTOREFP;
@@ -2263,6 +2498,7 @@ void time_loop()
 
     // Timer for start of ETTO signal
     if(triggerETTO && (millis() - triggerETTONow >= triggerETTOLeadTime)) {
+        TT_TRACE(TTR_ETTO_ON, (long)(millis() - triggerETTONow) - triggerETTOLeadTime);
         sendTTNetWorkMsg(bttfnTTLeadTime, TT_P1_EXT);
         ettoPulseStart();
         triggerETTO = false;
@@ -2276,22 +2512,12 @@ void time_loop()
 
         unsigned long univNow = millis();
         long timetravelP0DelayT = 0;
+        long ttP0LDOver = (long)(univNow - ttP0Now) - (long)timetravelP0Delay;
 
         timeTravelP0stalled = 0;
 
-        timeTravelP0Speed++;
-
-        if(timeTravelP0Speed < 88) {
-            unsigned long ttP0NowT = univNow;
-            long ttP0LDOver = 0, ttP0LastDelay = ttP0NowT - ttP0Now;
-            ttP0Now = ttP0NowT;
-            ttP0LDOver = ttP0LastDelay - timetravelP0Delay;
-            timetravelP0DelayT = (long)(((float)(tt_p0_delays[timeTravelP0Speed])) / ttP0TimeFactor) - ttP0LDOver;
-            while(timetravelP0DelayT <= 0 && timeTravelP0Speed < 88) {
-                timeTravelP0Speed++;
-                timetravelP0DelayT += (long)(((float)(tt_p0_delays[timeTravelP0Speed])) / ttP0TimeFactor);
-            }
-        }
+        ttP0Now = univNow;
+        timeTravelP0Speed = ttplan_p0_step(&ttCrv, timeTravelP0Speed, ttP0LDOver, &timetravelP0DelayT);
 
         if(timeTravelP0Speed < 88) {
 
@@ -2307,6 +2533,10 @@ void time_loop()
         speedo.setSpeed(timeTravelP0Speed);
         speedo.show();
 
+        #ifdef TC_TT_TRACE
+        if(timeTravelP0Speed >= 88) TT_TRACE(TTR_SPEED88, timeTravelP0Speed);
+        #endif
+
         // Overwrite fakeSpeed/bttfnRemCurSpd for BTTFN clients who keep polling
         // until P1-ETTO_LEAD
         #ifdef TC_HAVE_RE
@@ -2373,6 +2603,10 @@ void time_loop()
         }
         if((timeTravelP0Speed <= targetSpeed) || (targetSpeed >= 88)) {
             csf &= ~CSF_P2;
+            #ifdef TC_TT_TRACE
+            TT_TRACE(TTR_P2END, timeTravelP0Speed);
+            ttTraceDump();
+            #endif
             #ifdef NOT_MY_RESPONSIBILITY
             if(countToGPSSpeed && targetSpeed >= 88) {
                 // Avoid an immediately repeated time travel
@@ -2457,6 +2691,7 @@ void time_loop()
     if((timeTravelP1 > 0) && (millis() - timetravelP1Now >= timetravelP1Delay)) {
         timeTravelP1++;
         timetravelP1Now = millis();
+        TT_TRACE(TTR_P1PHASE, timeTravelP1);
         switch(timeTravelP1) {
         case 2:
             #ifdef TC_DBG_TT
@@ -2478,6 +2713,7 @@ void time_loop()
         default:
             timeTravelP1 = 0;
             csf &= ~CSF_P1;
+            anim_stop(ANS_GLITCH);
             destinationTime.setBrightness(255); // restore
             presentTime.setBrightness(255);
             departedTime.setBrightness(255);
@@ -2489,6 +2725,10 @@ void time_loop()
     if((csf & CSF_RE) && (millis() - timetravelNow >= REENTRY_DURATION)) {
         animate();
         csf &= ~CSF_RE;
+        #ifdef TC_TT_TRACE
+        TT_TRACE(TTR_DONE, 0);
+        if(!(csf & CSF_P2)) ttTraceDump();
+        #endif
     }
 
     // Post half-sec change slot: Save data
@@ -2573,12 +2813,7 @@ void time_loop()
         {
             int compHour, compMin;
             
-            // 1. Timer. This should be done more often (not just post-sec), but
-            //           we are no chronograph, but rather an egg-timer.
-            if(ctDown && (millis() - ctDownNow > ctDown)) {
-                ctDown = 0;
-                sigFlags |= SF_TQ;
-            }
+            // 1. Timer: SF_TQ is set by scheduler
 
             if(alf & ALF_RTC) {
                 // reading bttfnDateBuf is safe, we are running post sec-change
@@ -2606,11 +2841,7 @@ void time_loop()
                 }
             }
     
-            // 2b. Snooze timer
-            if(snoozeNow && (millisNow - snoozeNow >= snoozeTime)) {
-                snoozeNow = 0;
-                sigFlags |= SF_SQ;
-            }
+            // 2b. Snooze timer: SF_SQ is set by scheduler
     
             // 3. Reminder
             if(remDay) {
@@ -2641,6 +2872,11 @@ void time_loop()
             } else {
                 sigFlags &= ~SF_HD;
             }
+
+            // Go to full CPU speed ahead of scheduled events
+            if(csf & CSF_PWRLOW) {
+                pwrPredict(compHour, compMin);
+            }
         }
 
         // Now act on queue determination:
@@ -2674,12 +2910,12 @@ void time_loop()
                             sendNetWorkMsg("ALARM\0", 6, BTTFN_NOT_ALARM);
                             if(ETTOalarm) {
                                 setTTOUTpin(HIGH);
-                                ETTOAlmNow = millisNonZero();
+                                sched_at(SCH_ETTOALM, ETTOAlmDur);
                             }
                         }
                         if(alf & ALF_ADV) csf |= CSF_AL;
                         else              alarmPlaying = ap;   // For legacy, repeat playback in full
-                        snoozeNow = 0;
+                        cancelSnooze();
                     }
                     sigFlags &= ~(SF_AQ|SF_ARQ|SF_ALQ|SF_SQ);
                 } else if(sigFlags & SF_SQ) {
@@ -2695,12 +2931,7 @@ void time_loop()
 
         // Handle Auto-NightMode
 
-        // Manually switching NM pauses automatic for 30 mins
-        if(manualNightMode >= 0 && (millis() - manualNMNow > 30*60*1000)) {
-            manualNightMode = -1;
-            // Re-evaluate auto-nm immediately
-            forceReEvalANM = true;
-        }
+        // (Manual NM override expires through scheduler)
         
         if(autoNightMode && (manualNightMode < 0)) {
             if(gdtl.minute() == 0 || forceReEvalANM) {
@@ -2759,8 +2990,7 @@ void time_loop()
     updAndDispRemoteSpeed();  // 1ms
     #endif
 
-    y = digitalRead(SECONDS_IN_PIN);
-    if((y == x) && !postHSecChangeBusy) {
+    if(!sqwEdgePending() && !postHSecChangeBusy) {
 
         bool didUpdSpeedo = false;
 
@@ -2770,12 +3000,6 @@ void time_loop()
         // (Will be skipped in current iteration if
         // seconds change is detected)
 
-        // TTOUT alarm signalling timeout
-        if(ETTOAlmNow && (millisNow - ETTOAlmNow >= ETTOAlmDur)) {
-            ETTOAlmNow = 0;
-            setTTOUTpin(LOW);
-        }
-    
         // Stop alarm after alarmPlayDur or if non-looped alarm sound ran out.
         // In Extended mode, this timeout is our last resort if the user doesn't
         // press or hold ENTER, and the sound is looped. If it is not
@@ -2795,6 +3019,7 @@ void time_loop()
                 if((alf & (ALF_SNOOZE|ALF_ASNOOZE)) == (ALF_SNOOZE|ALF_ASNOOZE)) {
                     if(origAlarmStart && (millisNow - origAlarmStart < 60*60*1000)) {
                         snoozeNow = millisNonZero();
+                        sched_at(SCH_SNOOZE, snoozeTime);
                     } else {
                         origAlarmStart = 0;
                     }
@@ -2868,7 +3093,7 @@ void time_loop()
         // Read GPS, and display GPS speed
         #ifdef TC_HAVEGPS
         if(sgf & SGF_UGPS) {
-            if(millis64() >= lastLoopGPS) {
+            if((millis64() >= lastLoopGPS) && i2c_slack(I2CP_GPS)) {
                 lastLoopGPS += (uint64_t)GPSupdateFreq;
                 // call loop with doDelay true; delay not needed but
                 // this causes a call of audio_loop() which is good
@@ -2895,27 +3120,7 @@ void time_loop()
         #endif
         
         // Power management: CPU speed
-        // Can only reduce when GPS is not used, WiFi is off and no sound playing
-        if((!(csf & CSF_PWRLOW)) &&
-           (wifiIsOff || wifiAPIsOff) && 
-           #ifdef TC_HAVEGPS
-           (!(sgf & SGF_UGPS)) &&
-           #endif
-           checkAudioDone() && 
-           (millisNow - pwrFullNow >= 5*60*1000)) {
-            
-            setCpuFrequencyMhz(80);
-            csf |= CSF_PWRLOW;
-            #ifdef TC_DBG_GEN
-            Serial.printf("Reduced CPU speed to %d\n", getCpuFrequencyMhz());
-            #endif
-        }
-
-        // Beep auto modes
-        if(beepTimer && (millisNow - beepTimerNow > beepTimeout)) {
-            muteBeep = true;
-            beepTimer = false;
-        }
+        pwrGovernor(millisNow);
 
         // Update sensors
 
@@ -2930,20 +3135,22 @@ void time_loop()
         }
         
         #ifdef TC_HAVELIGHT
-        if((sgf & SGF_ULightSens) && (millisNow - lastLoopLight >= 3000)) {
+        if((sgf & SGF_ULightSens) && (millisNow - lastLoopLight >= 3000) && i2c_slack(I2CP_SENSOR)) {
             lastLoopLight = millisNow;
             lightSens.loop();
+            bttfnSnapDirty = true;
+        }
+        if(autoBri && (sgf & SGF_ULightSens) && (millisNow - abriNow >= ABRI_INTERVAL)) {
+            abriNow = millisNow;
+            autoBri_loop();
         }
         #endif
 
-        // End of OTPR for PCF2129
-        #ifdef HAVE_PCF2129
-        if(OTPRinProgress) {
-            if(millisNow - OTPRStarted > 100) {
-                rtc.OTPRefresh(false);
-                OTPRinProgress = false;
-                OTPRDoneNow = millisNow;
-            }
+
+        #ifdef TC_DBG_I2C
+        if(millisNow - i2cStatsNow >= 60*1000) {
+            i2cStatsNow = millisNow;
+            i2c_printStats();
         }
         #endif
     }
@@ -2953,8 +3160,8 @@ void time_loop()
     speedo.speedoSLoop();
     #endif
 
-    y = digitalRead(SECONDS_IN_PIN);
-    if(y != x) {
+    // Process captured edges in order, one per iteration
+    if(sqwNextEdge(y) && (y != x)) {
 
         // Actual clock stuff
       
@@ -3227,6 +3434,7 @@ void time_loop()
             bttfnDateBuf[5] = gdtl.minute();
             bttfnDateBuf[6] = gdtl.second();
             bttfnDateBuf[7] = dayOfWeek(gdtl.day(), gdtl.month(), gdtl.year());
+            bttfnSnapDirty = true;
 
             // Write time to presentTime display
             if(stalePresent)
@@ -3346,10 +3554,9 @@ void time_loop()
 
             // OTPR for PCF2129 every two weeks
             #ifdef HAVE_PCF2129
-            if(RTCNeedsOTPR && (millisNow - OTPRDoneNow > 2*7*24*60*60*1000)) {
+            if(RTCNeedsOTPR && (millisNow - OTPRDoneNow > 2*7*24*60*60*1000) && !sched_pending(SCH_OTPR)) {
                 rtc.OTPRefresh(true);
-                OTPRinProgress = true;
-                OTPRStarted = millisNow;
+                sched_at(SCH_OTPR, 101);
             }
             #endif
 
@@ -3365,7 +3572,6 @@ void time_loop()
 
         if(!skipTTAnim && timeTravelP1 > 1) {
 
-            int ii = 5, tt;
             switch(timeTravelP1) {
             case 2:
                 ((rand() % 10) > 7) ? presentTime.off() : presentTime.on();
@@ -3380,38 +3586,12 @@ void time_loop()
                 presentTime.show();
                 departedTime.show();
                 allOn();
-                while(ii--) {
-                    tt = rand() % 21;
-                    if(tt < 5) destinationTime.show();
-                    else {
-                        destinationTime.showTextDirect(p1errStrs[(tt - 5) >> 2], CDT_COLON);
-                    }
-                    if(!(ii % 2)) destinationTime.setBrightnessDirect((1+(rand() % 10)) & 0x0a);
-                    if(ii % 2) presentTime.setBrightnessDirect((1+(rand() % 10)) & 0x0b);
-                    ((rand() % 10) < 3) ? departedTime.showTextDirect(">ACS2011GIDUW") : departedTime.show();
-                    if(ii % 2) departedTime.setBrightnessDirect((1+(rand() % 10)) & 0x07);
-                    mydelay(20);
-                }
+                anim_startPeriodic(ANS_GLITCH, ttGlitch1, 20, 5);
                 break;
             case 5:
                 departedTime.setBrightness(255);
                 departedTime.on();
-                while(ii--) {
-                    tt = rand() % 10;
-                    if(!(ii % 4))   presentTime.setBrightnessDirect(1+(rand() % 8));
-                    if(tt < 3)      { presentTime.setBrightnessDirect(4); presentTime.showPattern(true); }
-                    else if(tt < 7) { presentTime.show(); presentTime.on(); }
-                    else            { presentTime.off(); }
-                    tt = (rand() + millis()) % 10;
-                    if(tt < 2)      { destinationTime.showTextDirect(p1errStrs[rand() % 4], CDT_COLON); }
-                    else if(tt < 6) { destinationTime.show(); destinationTime.on(); }
-                    else            { if(!(ii % 2)) destinationTime.setBrightnessDirect(1+(rand() % 8)); }
-                    tt = (tt + (rand() + millis())) % 10;
-                    if(tt < 4)      { departedTime.setBrightnessDirect(4); departedTime.showPattern(true); }
-                    else if(tt < 7) { departedTime.showTextDirect("R 2 0 1 1 T R "); }
-                    else            { departedTime.show(); }
-                    mydelay(10);
-                }
+                anim_startPeriodic(ANS_GLITCH, ttGlitch2, 10, 5);
                 break;
             default:
                 allOff();
@@ -3426,6 +3606,8 @@ void time_loop()
 
         } else if(!(csf & (CSF_ST|CSF_RE|CSF_OFF))) {
 
+            char fwBuf[16];
+
             #ifdef TC_HAVEMQTT
             if(mqttDisp) {
                 displayMQTTmessage(MQ_DISP_D, 0, &destinationTime);
@@ -3486,6 +3668,11 @@ void time_loop()
                 presentTime.show();
             }
 
+            // Firmware update progress replaces last time departed
+            if(fwupd_getText(fwBuf, sizeof(fwBuf))) {
+                departedTime.showTextDirect(fwBuf);
+            }
+
             if(specDisp == 5) s5(postSecChange);
             else if(specDisp == 31) displayTmrString();
 
@@ -3597,7 +3784,6 @@ int timeTravelProbe(bool doComplete, bool& withSpeedo, bool forceNoLead)
 
 int timeTravel(bool doComplete, bool withSpeedo, bool forceNoLead)
 {
-    long  currTotDur = 0;
     unsigned long ttUnivNow = millis();
 
     int probe = timeTravelProbe(doComplete, withSpeedo, forceNoLead);
@@ -3605,6 +3791,12 @@ int timeTravel(bool doComplete, bool withSpeedo, bool forceNoLead)
     if(probe)
         return probe;
 
+    #ifdef TC_TT_TRACE
+    ttTraceNum = 0;
+    ttTraceNow = ttUnivNow;
+    TT_TRACE(TTR_TRIGGER, (doComplete ? 1 : 0) | (withSpeedo ? 2 : 0) | (forceNoLead ? 4 : 0));
+    #endif
+
     pwrNeedFullNow();
 
     // Disable RC, WC, Nav & mini modes
@@ -3644,171 +3836,64 @@ int timeTravel(bool doComplete, bool withSpeedo, bool forceNoLead)
      */
     if(doComplete && withSpeedo) {
 
-        bool doPreTTSound = !!(haveSnds & HS_PRE_TT);
-        bool doLeadLessP1 = doPreTTSound;
-        long myPointOfP1  = doPreTTSound ? pointOfP1NoLead : pointOfP1;
+        ttPlan ttp;
+        int    tempSpeed = -1;
 
         #ifdef TC_HAVE_REMOTE
         remoteInducedTT = false;
         #endif
 
-        timeTravelP0Speed = 0;
-        timetravelP0Delay = (haveSnds & HS_PRE_TT) ? 500 : 2000;   // Delay of 2000 too long if we play ttaccel
         triggerP1 = false;
         triggerETTO = false;
         ettoPulseEnd();
-        ettoLeadPoint = origEttoLeadPoint;
-        bttfnTTLeadTime = ettoLeadTime;
         
         #if defined(TC_HAVEGPS) || defined(TC_HAVE_RE) || defined(TC_HAVE_REMOTE)
         if((sgf & (SGF_DispGPSSpd|SGF_DispRotEnc)) || (csf & CSF_RSM)) {
             #if defined(TC_HAVEGPS) && defined(TC_HAVE_RE)
-            int tempSpeed = (sgf & SGF_DispGPSSpd) ? myGPS.getSpeed() : fakeSpeed;
+            tempSpeed = (sgf & SGF_DispGPSSpd) ? myGPS.getSpeed() : fakeSpeed;
             #elif defined(TC_HAVEGPS)
-            int tempSpeed = myGPS.getSpeed();
+            tempSpeed = myGPS.getSpeed();
             #elif defined(TC_HAVE_RE)
-            int tempSpeed = fakeSpeed;
+            tempSpeed = fakeSpeed;
             #else
-            int tempSpeed = 0;
+            tempSpeed = 0;
             #endif
             #ifdef TC_HAVE_REMOTE
             if(csf & CSF_RSM) {
                 tempSpeed = bttfnRemCurSpd;
             }
             #endif
-            if(tempSpeed >= 0) {
-                timeTravelP0Speed = tempSpeed;
-                timetravelP0Delay = 0;
-                if(timeTravelP0Speed < 88) {
-                    currTotDur = tt_p0_totDelays[timeTravelP0Speed];
-
-                    // If the strict 5s lead is not required (as is the case
-                    // if ETTWithFixedLead is false), we can also cut short 
-                    // P1 by skipping the fade-in part of the sound, if the
-                    // the remaining part of the acceleration until 88 is too
-                    // short.
-
-                    if(!ETTWithFixedLead) {
-                        if(currTotDur > pointOfP1) {
-                            // If we're past normal P1 start point,
-                            // cut P1 short by skipping lead
-                            // (and skip user's acceleration sound)
-                            myPointOfP1 = pointOfP1NoLead;
-                            doLeadLessP1 = true;
-                            doPreTTSound = false;
-                        } else if(doPreTTSound) {
-                            // Don't play user's acceleration sound if it would
-                            // be played for only a very short time (~2 secs)
-                            // But play with-lead version in that case.
-                            if(currTotDur > (pointOfP1 - 600)) {
-                                myPointOfP1 = pointOfP1;
-                                doLeadLessP1 = false;
-                                doPreTTSound = false;
-                            } else {
-                                myPointOfP1 = pointOfP1NoLead;
-                                doLeadLessP1 = true;
-                            }
-                        }
-                    }
-                    
-                    // If the strict 5s lead is not required (as is the
-                    // case if ETTWithFixedLead is false), we can shorten that 
-                    // lead. We calculate it based on current speed and
-                    // the remaining time until reaching 88.
-                    
-                    if(!ETTWithFixedLead && (bttfnHaveClients || pubMQTTVL)) {
-                        if(currTotDur >= ettoLeadPoint) {
-                            // Calc time until 88 for bttfn clients
-                            if(ettoLeadPoint < myPointOfP1) {
-                                if(currTotDur >= myPointOfP1) {
-                                    ettoLeadPoint = myPointOfP1;
-                                    bttfnTTLeadTime = ettoBase - myPointOfP1;
-                                } else {
-                                    ettoLeadPoint = currTotDur;
-                                    bttfnTTLeadTime = ettoBase - currTotDur;
-                                }
-                                if(bttfnTTLeadTime > ETTO_LAT) {
-                                    bttfnTTLeadTime -= ETTO_LAT;
-                                }
-                            }
-                        }
-                    }
-                }
-            }
         }
         #endif
-        
-        if(timeTravelP0Speed < 88) {
-
-            // Now calculate the times until P1 and until reaching 88.
-            // If time needed to reach 88mph is shorter than ettoLeadTime
-            // or pointOfP1: Need add'l delay before speed counter kicks in.
-            // This add'l delay is put into timetravelP0Delay.
-
-            if(ETTWithFixedLead || bttfnHaveClients || pubMQTTVL) {
 
-                triggerETTO = true;
-                
-                if(currTotDur >= ettoLeadPoint || currTotDur >= myPointOfP1) {
-
-                    if(currTotDur >= ettoLeadPoint && currTotDur >= myPointOfP1) {
-
-                        // Both outside our remaining time period:
-                        if(ettoLeadPoint <= myPointOfP1) {
-                            // ETTO first:
-                            triggerETTOLeadTime = 0;
-                            triggerP1LeadTime = myPointOfP1 - ettoLeadPoint;
-                            timetravelP0Delay = currTotDur - ettoLeadPoint;
-                        } else if(ettoLeadPoint > myPointOfP1) {
-                            // P1 first:
-                            triggerP1LeadTime = 0;
-                            triggerETTOLeadTime = ettoLeadPoint - myPointOfP1;
-                            timetravelP0Delay = currTotDur - myPointOfP1;
-                        }
-
-                    } else if(currTotDur >= ettoLeadPoint) {
-
-                        // etto outside
-                        triggerETTOLeadTime = 0;
-                        triggerP1LeadTime = myPointOfP1 - ettoLeadPoint;
-                        timetravelP0Delay = currTotDur - ettoLeadPoint;
-
-                    } else {
-
-                        // P1 outside
-                        triggerP1LeadTime = 0;
-                        triggerETTOLeadTime = ettoLeadPoint - myPointOfP1;
-                        timetravelP0Delay = currTotDur - myPointOfP1;
-
-                    }
-
-                } else {
-
-                    triggerP1LeadTime = myPointOfP1 - currTotDur + timetravelP0Delay;
-                    triggerETTOLeadTime = ettoLeadPoint - currTotDur + timetravelP0Delay;
+        // Calculate the times until P1, ETTO and 88 relative to the
+        // current speed; if the time needed to reach 88mph is shorter
+        // than the ETTO lead or pointOfP1, P0 is delayed.
+        bool haveP0 = ttplan_p0(&ttCrv, &ttp, tempSpeed, !!(haveSnds & HS_PRE_TT),
+                                ETTWithFixedLead, bttfnHaveClients || pubMQTTVL);
 
-                }
+        timeTravelP0Speed = (tempSpeed >= 0) ? tempSpeed : 0;
+        timetravelP0Delay = ttp.p0Delay;
+        bttfnTTLeadTime = ttp.netLeadTime;
+        
+        if(haveP0) {
 
-                // If there is time between NOW and ETTO_LEAD start, send
-                // PREPARE message to networked clients.
-                if(triggerETTOLeadTime > 500) {
-                    sendNetWorkMsg("PREPARE\0", 8, BTTFN_NOT_PREPARE);
-                }
-                
-                ttUnivNow = millis();
-                triggerETTONow = triggerP1Now = ttUnivNow;
+            triggerETTO = ttp.trigETTO;
+            triggerETTOLeadTime = ttp.ettoLeadTime;
+            triggerP1LeadTime = ttp.p1LeadTime;
 
-            } else if(currTotDur >= myPointOfP1) {
-                 triggerP1Now = ttUnivNow;
-                 triggerP1LeadTime = 0;
-                 timetravelP0Delay = currTotDur - myPointOfP1;
-            } else {
-                 triggerP1Now = ttUnivNow;
-                 triggerP1LeadTime = myPointOfP1 - currTotDur + timetravelP0Delay;
+            // If there is time between NOW and ETTO_LEAD start, send
+            // PREPARE message to networked clients.
+            if(ttp.prepare) {
+                sendNetWorkMsg("PREPARE\0", 8, BTTFN_NOT_PREPARE);
+                TT_TRACE(TTR_PREPARE, 0);
             }
+            
+            ttUnivNow = millis();
+            triggerETTONow = triggerP1Now = ttUnivNow;
 
             triggerP1 = true;
-            triggerP1NoLead = doLeadLessP1;
+            triggerP1NoLead = ttp.p1NoLead;
 
             speedo.setSpeed(timeTravelP0Speed);
             speedo.setBrightness(255);
@@ -3817,6 +3902,7 @@ int timeTravel(bool doComplete, bool withSpeedo, bool forceNoLead)
             timetravelP0Now = ttP0Now = ttUnivNow;
             csf |= CSF_P0;
             csf &= ~CSF_P2;
+            TT_TRACE(TTR_P0START, timeTravelP0Speed);
 
             timeTravelP0stalled = (timetravelP0Delay > 0) ? 1 : 0;
 
@@ -3828,7 +3914,7 @@ int timeTravel(bool doComplete, bool withSpeedo, bool forceNoLead)
             // Now transmit p0 start-speed
             bttfn_notify_speed();
 
-            if(doPreTTSound) {
+            if(ttp.preTTSound) {
                 play_file(preTTSound, PA_LINEOUT|PA_CHECKNM|PA_INTRMUS|PA_ALLOWSD|PA_DYNVOL);
             }
 
@@ -3857,44 +3943,23 @@ int timeTravel(bool doComplete, bool withSpeedo, bool forceNoLead)
 
         if(ETTWithFixedLead || bttfnHaveClients || pubMQTTVL) {
 
-            long  ettoLeadT = ettoLeadTime;
-            long  P1_88 = TT_P1_POINT88;
+            ttPlan ttp;
+
+            ttplan_nop0(&ttp, forceNoLead, ETTWithFixedLead, !!(haveSnds & HS_PRE_TT));
 
             triggerP1 = true;
-            triggerP1NoLead = false;
+            triggerP1NoLead = ttp.p1NoLead;
+            triggerP1LeadTime = ttp.p1LeadTime;
             triggerETTO = true;
+            triggerETTOLeadTime = ttp.ettoLeadTime;
+            bttfnTTLeadTime = ttp.netLeadTime;
 
-            bttfnTTLeadTime = ettoLeadTime;           //
-            
-            if(forceNoLead && !ETTWithFixedLead) {
-                P1_88 = 0;
-                triggerP1NoLead = true;
-                bttfnTTLeadTime = ettoLeadT = P1_88;  //
+            if(ttp.preTTSound) {
+                play_file(preTTSound, PA_LINEOUT|PA_CHECKNM|PA_INTRMUS|PA_ALLOWSD|PA_DYNVOL);
             }
-
-            //bttfnTTLeadTime = ettoLeadTime;
-            
-            //if(!ETTWithFixedLead) {
-            //    bttfnTTLeadTime = ettoLeadT = P1_88;
-            //}
-
-            if(ettoLeadT >= P1_88) {
-                triggerETTOLeadTime = 0;
-                triggerP1LeadTime = ettoLeadT - P1_88;
-                
-                if((triggerP1LeadTime > 3000) && (haveSnds & HS_PRE_TT)) {
-                    play_file(preTTSound, PA_LINEOUT|PA_CHECKNM|PA_INTRMUS|PA_ALLOWSD|PA_DYNVOL);
-                    triggerP1LeadTime = ettoLeadT;
-                    triggerP1NoLead = true;
-                }
-                
-            } else {
-                triggerP1LeadTime = 0;
-                triggerETTOLeadTime = P1_88 - ettoLeadT;
-
-                if(triggerETTOLeadTime > 500) {
-                    sendNetWorkMsg("PREPARE\0", 8, BTTFN_NOT_PREPARE);
-                }
+            if(ttp.prepare) {
+                sendNetWorkMsg("PREPARE\0", 8, BTTFN_NOT_PREPARE);
+                TT_TRACE(TTR_PREPARE, 0);
             }
 
             ttUnivNow = millis();
@@ -3920,6 +3985,8 @@ int timeTravel(bool doComplete, bool withSpeedo, bool forceNoLead)
      *
      */
 
+    TT_TRACE(TTR_REENTRY, 0);
+
     allOff();
 
     #ifndef PERSISTENT_SD_ONLY
@@ -4041,6 +4108,8 @@ int timeTravel(bool doComplete, bool withSpeedo, bool forceNoLead)
 
 static void triggerLongTT(bool noLead)
 {
+    TT_TRACE(TTR_P1START, noLead);
+
     if(playTTsounds) play_file(noLead ? "/travelstart2.mp3" : "/travelstart.mp3", 
                                PA_LINEOUT|PA_CHECKNM|PA_INTRMUS|PA_ALLOWSD|PA_DYNVOL,
                                TT_SOUND_FACT);
@@ -4101,10 +4170,146 @@ static void ettoPulseStartNoLead()
 void ettoPulseEnd()
 {
     if(useETTOWired || useETTOWiredNoLead) {
+        #ifdef TC_TT_TRACE
+        if(digitalRead(EXTERNAL_TIMETRAVEL_OUT_PIN)) TT_TRACE(TTR_ETTO_OFF, 0);
+        #endif
         setTTOUTpin(LOW);
     }
 }
 
+#ifdef TC_TT_TRACE
+static void ttTraceAdd(uint8_t ev, long arg)
+{
+    if(ttTraceNum < TTR_MAX) {
+        ttTrace[ttTraceNum].t = millis() - ttTraceNow;
+        ttTrace[ttTraceNum].ev = ev;
+        ttTrace[ttTraceNum].arg = arg;
+        ttTraceNum++;
+    }
+}
+
+static void ttTraceDump()
+{
+    long t88 = -1, tP1 = -1, tRE = -1;
+    
+    if(!ttTraceNum)
+        return;
+
+    Serial.println("Time travel timeline:");
+    for(int i = 0; i < ttTraceNum; i++) {
+        Serial.printf("  %6lu %-12s %ld\n", ttTrace[i].t, ttrNames[ttTrace[i].ev], ttTrace[i].arg);
+        switch(ttTrace[i].ev) {
+        case TTR_SPEED88:
+            if(t88 < 0) t88 = ttTrace[i].t;
+            break;
+        case TTR_P1START:
+            if(tP1 < 0) tP1 = ttTrace[i].t;
+            break;
+        case TTR_REENTRY:
+            if(tRE < 0) tRE = ttTrace[i].t;
+            break;
+        }
+    }
+    if(t88 >= 0) {
+        Serial.printf("  Trigger to 88mph on speedo: %ldms", t88);
+        if(tP1 >= 0) Serial.printf(" (88 - P1 start: %ldms, planned %dms)", t88 - tP1, TT_P1_POINT88);
+        Serial.println("");
+    }
+    if(tP1 >= 0 && tRE >= 0) {
+        Serial.printf("  P1 duration: %ldms\n", tRE - tP1);
+    }
+    
+    ttTraceNum = 0;
+}
+#endif
+
+#ifdef TC_HAVELIGHT
+/*
+ * Auto brightness
+ *
+ * Maps the (filtered) lux value to a brightness between 0 and the
+ * configured brightness of each display, logarithmically between 
+ * abriLuxLo and abriLuxHi. A display steps by one level at a time, 
+ * at most every ABRI_STEP_INT ms, and only if the target is beyond
+ * the current level plus hysteresis.
+ * Inactive during night mode, time travel and in the menu; the 
+ * displays' brightness is also modified there.
+ */
+static int autoBriStep(int idx, uint8_t cur, uint8_t maxBri, uint16_t pos)
+{
+    int32_t tgt = (int32_t)pos * maxBri;    // target in 1/256 levels
+    int32_t curr = (int32_t)cur << 8;
+    uint8_t nl = cur;
+
+    if(tgt > curr + 128 + ABRI_HYST) {
+        nl = cur + 1;
+    } else if(tgt < curr - 128 - ABRI_HYST) {
+        nl = cur - 1;
+    } else if(cur > maxBri) {
+        // Configured brightness was lowered
+        nl = maxBri;
+    }
+
+    if(nl != cur && (millis() - abriStepNow[idx] >= ABRI_STEP_INT)) {
+        abriStepNow[idx] = millis();
+        return nl;
+    }
+
+    return -1;
+}
+
+static void autoBri_loop()
+{
+    int32_t lux = lightSens.readLux();
+    uint16_t pos;
+    int nl;
+
+    if(lux < 0)
+        return;
+
+    // Exponential smoothing
+    if(abriLux < 0) abriLux = lux << 4;
+    else            abriLux += ((lux << 4) - abriLux) / 8;
+    
+    if((csf & (CSF_MA|CSF_ST|CSF_P0|CSF_P1|CSF_RE|CSF_OFF)) || presentTime.getNightMode())
+        return;
+
+    lux = abriLux >> 4;
+    if(lux <= abriLuxLo) {
+        pos = 0;
+    } else if(lux >= abriLuxHi) {
+        pos = 256;
+    } else {
+        pos = (uint16_t)(256.0f * logf((float)(lux - abriLuxLo) + 1.0f) / logf((float)(abriLuxHi - abriLuxLo) + 1.0f));
+    }
+
+    // Only touch the dimming register if level changes
+    if((nl = autoBriStep(0, destinationTime.getBrightness(), destinationTime.getOrigBrightness(), pos)) >= 0)
+        destinationTime.setBrightness(nl);
+    if((nl = autoBriStep(1, presentTime.getBrightness(), presentTime.getOrigBrightness(), pos)) >= 0)
+        presentTime.setBrightness(nl);
+    if((nl = autoBriStep(2, departedTime.getBrightness(), departedTime.getOrigBrightness(), pos)) >= 0)
+        departedTime.setBrightness(nl);
+    // Temperature display has its own brightness
+    if((sgf & SGF_USpeedoDisp) && (speedoStatus != SPST_TEMP)) {
+        if((nl = autoBriStep(3, speedo.getBrightness(), speedo.getOrigBrightness(), pos)) >= 0)
+            speedo.setBrightness(nl);
+    }
+}
+
+// Return to configured brightness (after disabling auto brightness)
+void autoBriReset()
+{
+    destinationTime.setBrightness(destinationTime.getOrigBrightness());
+    presentTime.setBrightness(presentTime.getOrigBrightness());
+    departedTime.setBrightness(departedTime.getOrigBrightness());
+    if(sgf & SGF_USpeedoDisp) {
+        speedo.setBrightness(speedo.getOrigBrightness());
+    }
+    abriLux = -1;
+}
+#endif
+
 static char *i2a(char *d, unsigned int t)
 {
     unsigned const int tt[3] = { 1000, 100, 10 };
@@ -4145,6 +4350,8 @@ void send_abort_msg()
 
 static void sendTTNetWorkMsg(uint16_t bttfnPayload, uint16_t bttfnPayload2)
 {
+    TT_TRACE(TTR_NETTT, bttfnPayload);
+
     #ifdef TC_DBG_NET
     Serial.printf("sendTTNetWorkMsg: %d %d\n", bttfnPayload, bttfnPayload2);
     #endif
@@ -4633,6 +4840,7 @@ void mydelay(unsigned long mydel)
     if(mydel <= 10) {
         while(millis() - startNow < mydel) {
             ntp_short_loop();
+            anim_loop();
             audio_loop();
         }
         return;
@@ -4640,6 +4848,7 @@ void mydelay(unsigned long mydel)
 
     while(millis() - startNow < mydel) {
         ntp_short_loop();
+        anim_loop();
         bttfn_loop(BNLP_SK_MC|BNLP_SK_NOTDATA|BNLP_SK_EXPIRE);
         audio_loop();
         #if defined(TC_HAVEGPS) || defined(TC_HAVE_RE) || defined(TC_HAVE_REMOTE)
@@ -4649,31 +4858,163 @@ void mydelay(unsigned long mydel)
     }
 }
 
+static void pwrSetLevel(uint8_t level)
+{
+    unsigned long now = millis();
+
+    pwrLevelTime[pwrLevel] += now - pwrLevelNow;
+    pwrLevelNow = now;
+    
+    pwrLevel = level;
+    setCpuFrequencyMhz(pwrFreqs[level]);
+
+    if(level) csf |= CSF_PWRLOW;
+    else      csf &= ~CSF_PWRLOW;
+
+    // Loop timing at old frequency is meaningless now
+    pwrMaxLoopUs = 0;
+    pwrLastLoopUs = micros();
+    pwrWindowNow = now;
+
+    #ifdef TC_DBG_GEN
+    Serial.printf("Setting CPU speed to %d\n", getCpuFrequencyMhz());
+    #endif
+}
+
 // Call this to get full CPU speed
 void pwrNeedFullNow(bool force)
 {
     if((csf & CSF_PWRLOW) || force) {
-        setCpuFrequencyMhz(240);
-        #ifdef TC_DBG_GEN
-        Serial.print("Setting CPU speed to ");
-        Serial.println(getCpuFrequencyMhz());
-        #endif
+        pwrSetLevel(0);
     }
     pwrFullNow = millis();
-    csf &= ~CSF_PWRLOW;
+}
+
+// Full speed for a scheduled event; unlike pwrNeedFullNow(),
+// this does not restart the (long) idle hold
+static void pwrNeedFullBriefly()
+{
+    if(csf & CSF_PWRLOW) {
+        pwrSetLevel(0);
+    }
+    pwrEventNow = millis();
 }
 
 /*
- * Internal wrapper for RTC.now()
- * Corrects RTC-read year by yearOffset
- * Stores RTC-hardware year to dt.hwRTCYear
- * (RTC sometimes loses sync and does not send data,
- * which is interpreted as 2165/165/165 etc
- * Check for this and retry in case.)
+ * pwrGovernor()
+ * 
+ * CPU speed can only be reduced when GPS is not used, WiFi is off 
+ * and no sound is playing; everything else is judged by the main
+ * loop latency: A lower frequency is chosen if the worst latency 
+ * of the last window, scaled to that frequency, stays within budget; 
+ * a higher one if the budget was exceeded.
+ * Audio decoding load is not measured; the CPU simply stays at 
+ * full speed while any sound is playing. The debug report only 
+ * shows time spent at each frequency, not energy.
  */
-void myrtcnow(DateTime& dt)
+static void pwrGovernor(unsigned long now)
 {
-    int retries = 0;
+    if(now - pwrWindowNow < PWR_WINDOW)
+        return;
+
+    if((wifiIsOff || wifiAPIsOff) && 
+       #ifdef TC_HAVEGPS
+       (!(sgf & SGF_UGPS)) &&
+       #endif
+       checkAudioDone() && 
+       (now - pwrFullNow >= PWR_FULL_HOLD) &&
+       (now - pwrEventNow >= PWR_EVENT_HOLD)) {
+
+        unsigned long maxUs = pwrMaxLoopUs;
+
+        if(pwrLevel > 0 && maxUs > PWR_LOOP_BUDGET) {
+            pwrSetLevel(pwrLevel - 1);
+        } else if(pwrLevel < PWR_NUM_LVL - 1 && 
+                  maxUs * pwrFreqs[pwrLevel] / pwrFreqs[pwrLevel + 1] < PWR_LOOP_BUDGET / 2) {
+            pwrSetLevel(pwrLevel + 1);
+        }
+    }
+
+    pwrMaxLoopUs = 0;
+    pwrWindowNow = now;
+
+    #ifdef TC_DBG_PWR
+    if(now - pwrReportNow >= 10*60*1000) {
+        uint64_t tot = 0;
+        pwrReportNow = now;
+        pwrLevelTime[pwrLevel] += now - pwrLevelNow;
+        pwrLevelNow = now;
+        for(int i = 0; i < PWR_NUM_LVL; i++) {
+            tot += pwrLevelTime[i];
+        }
+        if(tot) {
+            for(int i = 0; i < PWR_NUM_LVL; i++) {
+                Serial.printf("pwr: %dMHz: %lus (%d%%)\n", pwrFreqs[i], 
+                    (unsigned long)(pwrLevelTime[i] / 1000), (int)(pwrLevelTime[i] * 100 / tot));
+            }
+        }
+    }
+    #endif
+}
+
+/*
+ * pwrPredict()
+ * 
+ * Called once per second while in power-save: Return to full 
+ * speed shortly before an alarm, sound-on-the-hour or time
+ * cycling is due, so that switching speed does not delay it.
+ * Only events that will actually take place are considered.
+ */
+static void pwrPredict(int compHour, int compMin)
+{
+    bool due = false;
+    bool nextDay = false;
+
+    if(gdtl.second() < 50)
+        return;
+
+    if(++compMin > 59) {
+        compMin = 0;
+        if(++compHour > 23) {
+            compHour = 0;
+            nextDay = true;
+        }
+    }
+
+    // Sound on the hour
+    if(!compMin && !(csf & (CSF_NM|CSF_OFF)) && have_hour_sound(compHour)) due = true;
+
+    // Alarm
+    if(alarmOnOff && (alarmHour == compHour) && (alarmMinute == compMin)) {
+        int weekDay = (alf & ALF_RTC) ? bttfnDateBuf[7] : dayOfWeek(presentTime.getDay(), presentTime.getMonth(), presentTime.getYear());
+        int weekDayMask = 1 << (nextDay ? (weekDay + 1) % 7 : weekDay);
+        if(alarmWeekday & 0x80) {
+            if(alarmWeekday & weekDayMask) due = true;
+        } else if(alarmWDmasks[alarmWeekday] & weekDayMask) {
+            due = true;
+        }
+    }
+
+    // Time cycling
+    if(autoTimeIntervals[autoInterval] && !(compMin % autoTimeIntervals[autoInterval]) && 
+       !autoPaused && !specDisp) due = true;
+
+    if(due) {
+        pwrNeedFullBriefly();
+    }
+}
+
+/*
+ * Internal wrapper for RTC.now()
+ * Corrects RTC-read year by yearOffset
+ * Stores RTC-hardware year to dt.hwRTCYear
+ * (RTC sometimes loses sync and does not send data,
+ * which is interpreted as 2165/165/165 etc
+ * Check for this and retry in case.)
+ */
+void myrtcnow(DateTime& dt)
+{
+    int retries = 0;
 
     rtc.now(dt);
 
@@ -4743,6 +5084,7 @@ bool startSnooze()
 {
     if(alf & ALF_SNOOZE) {
         snoozeNow = millisNonZero();
+        sched_at(SCH_SNOOZE, snoozeTime);
         return true;
     }
     return false;
@@ -4751,6 +5093,7 @@ bool startSnooze()
 void cancelSnooze()
 {
     snoozeNow = 0;
+    sched_cancel(SCH_SNOOZE);
 }
 
 bool snoozeRunning()
@@ -4894,9 +5237,10 @@ static void updateTemperature(bool force)
         tui = 5 * 1000;
     }
         
-    if(force || (now - tempReadNow >= tui)) {
+    if(force || ((now - tempReadNow >= tui) && i2c_slack(I2CP_SENSOR))) {
         tempSens.readTemp();
         tempReadNow = now;
+        bttfnSnapDirty = true;
     }
 }
 
@@ -5231,6 +5575,9 @@ void flushDelayedSave()
         disChangedNow = 0;
         saveBootMode();
     }
+
+    // Wait for write-behind
+    persist_flush();
 }
 
 static void triggerSaveDisplayMode()
@@ -5243,65 +5590,80 @@ static void triggerSaveDisplayMode()
  * Display helpers
  */
 
-void animate(bool withLEDs)
+#ifndef TC_NO_MONTH_ANIM
+#ifdef TC_HAVEGPS
+static char animDestDisp[16];
+static char animDepDisp[16];
+#endif
+
+// Stage 1 (arg 1): All but month, stage 2 (arg 0): All
+static void animateStage(int stage)
 {
+    bool i = !!stage;
+
     #ifdef TC_HAVEGPS
-    char destDisp[16];
-    char depDisp[16];
+    if(isNavMode()) {
+        if(i) gpsMakePos(animDestDisp, animDepDisp);
+        destinationTime.showNavDirect(animDestDisp, i);
+        departedTime.showNavDirect(animDepDisp, i);
+    } else
     #endif
-        
-    // Fill audio buffer, avoid a pause in the actual animation
-    audio_loop();
+    #ifdef TC_HAVETEMP
+    if(isRcMode() && (!isWcMode() || (!(wcf & WCF_HaveTZ1)))) {
+        destinationTime.showTempDirect(tempSens.readLastTemp(), i);
+    } else
+    #endif
+        if(isMiniMode())
+            destinationTime.clearDisplay();
+        else
+            destinationTime.showAnimate(i);
 
-    #ifndef TC_NO_MONTH_ANIM  // ---------------------
+    presentTime.showAnimate(i);
 
-    for(bool i : { true, false }) {
-        #ifdef TC_HAVEGPS
-        if(isNavMode()) {
-            if(i) gpsMakePos(destDisp, depDisp);
-            destinationTime.showNavDirect(destDisp, i);
-            departedTime.showNavDirect(depDisp, i);
-        } else
-        #endif
+    #ifdef TC_HAVEGPS
+    if(!isNavMode()) {
+    #endif
         #ifdef TC_HAVETEMP
-        if(isRcMode() && (!isWcMode() || (!(wcf & WCF_HaveTZ1)))) {
-            destinationTime.showTempDirect(tempSens.readLastTemp(), i);
+        if(isRcMode()) {
+            if(isWcMode() && (wcf & WCF_HaveTZ1)) {
+                departedTime.showTempDirect(tempSens.readLastTemp(), i);
+            } else if(!isWcMode() && tempSens.haveHum()) {
+                departedTime.showHumDirect(tempSens.readHum(), i);
+            } else {
+                departedTime.showAnimate(i);
+            }
         } else
         #endif
             if(isMiniMode())
-                destinationTime.clearDisplay();
+                departedTime.clearDisplay();
             else
-                destinationTime.showAnimate(i);
-    
-        presentTime.showAnimate(i);
-    
-        #ifdef TC_HAVEGPS
-        if(!isNavMode()) {
-        #endif
-            #ifdef TC_HAVETEMP
-            if(isRcMode()) {
-                if(isWcMode() && (wcf & WCF_HaveTZ1)) {
-                    departedTime.showTempDirect(tempSens.readLastTemp(), i);
-                } else if(!isWcMode() && tempSens.haveHum()) {
-                    departedTime.showHumDirect(tempSens.readHum(), i);
-                } else {
-                    departedTime.showAnimate(i);
-                }
-            } else
-            #endif
-                if(isMiniMode())
-                    departedTime.clearDisplay();
-                else
-                    departedTime.showAnimate(i);
-        #ifdef TC_HAVEGPS
-        }
-        #endif
-
-        if(i) {
-            if(withLEDs) leds_on();
-            mydelay(80);
-        }
+                departedTime.showAnimate(i);
+    #ifdef TC_HAVEGPS
     }
+    #endif
+}
+
+static const animFrame animateTL[] = {
+    {  0, 0,        AOP_CALL, 1, animateStage },
+    {  0, ANT_LEDS, AOP_ON,   0, NULL },
+    { 80, 0,        AOP_CALL, 0, animateStage }
+};
+#endif
+
+void animate(bool withLEDs)
+{
+    #if defined(TC_HAVEGPS) && defined(TC_NO_MONTH_ANIM)
+    char destDisp[16];
+    char depDisp[16];
+    #endif
+        
+    // Fill audio buffer, avoid a pause in the actual animation
+    audio_loop();
+
+    #ifndef TC_NO_MONTH_ANIM  // ---------------------
+
+    anim_start(ANS_MAIN, animateTL, sizeof(animateTL) / sizeof(animateTL[0]), 
+               withLEDs ? ANT_ALL : (ANT_ALL & ~ANT_LEDS));
 
     #else // TC_NO_MONTH_ANIM ---------------------
 
@@ -5366,6 +5728,9 @@ void allShowPattern()
 
 void allOff()
 {
+    // Don't let pending animation frames turn displays back on
+    anim_stopAll();
+    
     destinationTime.off();
     presentTime.off();
     departedTime.off();
@@ -5916,7 +6281,7 @@ void speedoUpdate_loop(bool async)
 {
     bool chg = false;
     #ifdef TC_HAVEGPS
-    if((sgf & SGF_UGPS) && (millis64() >= lastLoopGPS)) {
+    if((sgf & SGF_UGPS) && (millis64() >= lastLoopGPS) && i2c_slack(I2CP_GPS)) {
         lastLoopGPS += (uint64_t)GPSupdateFreq;
         myGPS.loop(false);
         if(sgf & SGF_DispGPSSpd) chg |= displayGPSorRESpeed(true);
@@ -7422,6 +7787,11 @@ static void bttfn_evalremotecommand(uint32_t seq, uint8_t cmd, uint8_t p1, uint8
     #endif
     }
 }
+
+void bttfnEvalEvent(evbEvent *ev)
+{
+    bttfn_evalremotecommand(ev->val, ev->a, ev->b, ev->c);
+}
 #endif
 
 int bttfnNumClients()
@@ -7472,6 +7842,9 @@ stcl_copyIP:
 
     newClient->IP32 = ip;
 
+    // New client needs full data
+    bttfnDataFull = true;
+
 stcl_ipIdentical:
 
     bttfnHaveClients = true;
@@ -7483,9 +7856,12 @@ stcl_ipIdentical:
     newClient->ALIVE = millis();
     newClient->Flags = flags;
 
-    if(flags & 0x02) {
+    if(flags & BTTFN_CF_MC) {
         bttfnAtLeastOneMC = 2;
-        bttfnAtLeastOneND |= (flags & 0x01);
+        bttfnAtLeastOneND |= (flags & BTTFN_CF_ND);
+        if((flags & (BTTFN_CF_ND|BTTFN_CF_DELTA)) == BTTFN_CF_ND) {
+            bttfnNotAllDelta = 1;
+        }
     } else {
         bttfnNotAllSupportMC = 1;
     }
@@ -7512,16 +7888,28 @@ static void bttfn_expire_clients()
     int k, numClients = 0;
     unsigned long now = millis();
 
-    if(now - bttfnlastExpire < 57*1000)
+    if(!bttfnExpireDue)
         return;
         
-    bttfnlastExpire = now;
+    bttfnExpireDue = false;
+    sched_at(SCH_BTEXP, 57*1000);
+
+    #if defined(TC_DBG_NET) || defined(TC_BTTFN_BENCH)
+    Serial.printf("BTTFN: NOT_SPD sent %u saved %u; NOT_DATA sent %u (delta %u) saved %u\n",
+        bttfnSpdSent, bttfnSpdSaved, bttfnDataSent, bttfnDataDelta, bttfnDataSaved);
+    #endif
+    #ifdef TC_BTTFN_BENCH
+    bttfn_bench_print();
+    #endif
     
     for(int i = 0; i < BTTFN_MAX_CLIENTS; i++) {
         if(bttfnClient[i].IP32) {
             numClients++;
             if(now - bttfnClient[i].ALIVE > 5*60*1000) {
                 bttfnClient[i].IP32 = 0;
+                #ifdef TC_BTTFN_BENCH
+                bttfnBench.expired++;
+                #endif
                 #ifdef TC_HAVE_REMOTE
                 #ifdef TC_DBG_NET
                 Serial.printf("Expiring device type %d\n", bttfnClient[i].Type);
@@ -7565,19 +7953,22 @@ static void bttfn_expire_clients()
     }
 
     k = bttfnNotAllSupportMC = bttfnAtLeastOneMC = bttfnAtLeastOneND = bttfnDataParm = 0;
+    bttfnNotAllDelta = 0;
     for(int i = 0; i < BTTFN_MAX_CLIENTS; i++) {
         if(bttfnClient[i].IP32) {
             k |= bttfnClient[i].Flags;
-            if(!(bttfnClient[i].Flags & 0x02)) {        
+            if(!(bttfnClient[i].Flags & BTTFN_CF_MC)) {        
                 bttfnNotAllSupportMC = 1;
+            } else if((bttfnClient[i].Flags & (BTTFN_CF_ND|BTTFN_CF_DELTA)) == BTTFN_CF_ND) {
+                bttfnNotAllDelta = 1;
             }
         } else
             break;
     }
-    bttfnAtLeastOneMC = k & 0x02;
-    bttfnAtLeastOneND = k & 0x01;
+    bttfnAtLeastOneMC = k & BTTFN_CF_MC;
+    bttfnAtLeastOneND = k & BTTFN_CF_ND;
     // See if any of the remaining clients requests compressed time/date
-    if(k & 0x04) bttfnDataParm = 0x80;
+    if(k & BTTFN_CF_COMPR) bttfnDataParm = 0x80;
     
     if(!bttfnHaveClients) wifiRestartPSTimer();
 }
@@ -7601,101 +7992,149 @@ static uint8_t bttfn_checksum(uint8_t *buf)
     return a;
 }
 
+/*
+ * Render all data fields into the snapshot. Requests and NOT_DATA
+ * copy from there. The snapshot is re-rendered when marked dirty 
+ * (date tick, sensor reading, speed/info notification) or when 
+ * older than BTTFN_SNAP_MAXAGE (to catch display and status 
+ * changes without tracking them all).
+ */
+static void bttfn_snap_render()
+{
+    uint8_t s[BTTF_PACKET_SIZE];
+    uint8_t spdFlags = 0, tempFlags = 0, a = 0;
+    int16_t temp;
+    int32_t temp32;
+
+    memset(s, 0, sizeof(s));
+    
+    // date/time
+    memcpy(&s[10], bttfnDateBuf, sizeof(bttfnDateBuf));
+    if(presentTime.get1224()) s[17] |= 0x80;
+    destinationTime.getCompressed(&s[36], a);
+    a <<= 2;
+    presentTime.getCompressed(&s[32], a);
+    a <<= 2;
+    departedTime.getCompressed(&s[40], a);
+    s[44] = a;
+    
+    // speed  (-1 if unavailable)
+    temp = -1;         // (Client is supposed to support MC-notifications instead)
+    #ifdef TC_HAVE_REMOTE
+    if(csf & CSF_RSM) {
+        // bttfnRemCurSpd is P0-speed during P0, see below for reason
+        temp = bttfnRemCurSpd;
+        spdFlags |= 0x20;       // Signal that speed is from Remote
+    } else {
+    #endif
+        #ifdef TC_HAVEGPS
+        if((sgf & (SGF_UGPS|SGF_GPS2BTTFN)) == (SGF_UGPS|SGF_GPS2BTTFN)) {
+            // Why "&& (sgf & SGF_GPS2BTTFN)"?
+            // Because: If stationary user uses GPS for time only, speed will
+            // be 0 permanently, and rotary encoder never gets a chance.
+            // In P0, we transmit a fake speed since the props follow speed
+            // after triggering a below-88 TT (which at first only triggers a
+            // wakeup) until the ETTO-timed actual TIMETRAVEL signal
+            temp = (csf & CSF_P0) ? timeTravelP0Speed : myGPS.getSpeed();
+        } else {                        
+        #endif
+            #ifdef TC_HAVE_RE
+            if((sgf & SGF_URotEnc) && (!(csf & CSF_OFF))) {  // fakespeed only valid if FP on
+                // fakeSpeed is P0-speed during P0, see above for reason
+                temp = fakeSpeed;
+                spdFlags |= 0x80;   // Signal that speed is from RotEnc
+            }
+            #endif
+        #ifdef TC_HAVEGPS
+        }
+        #endif
+    #ifdef TC_HAVE_REMOTE
+    }
+    #endif
+    s[18] = (uint16_t)temp & 0xff;
+    s[19] = (uint16_t)temp >> 8;
+
+    // temperature * 100 (-32768 if unavailable)
+    temp = -32768;
+    #ifdef TC_HAVETEMP
+    if(sgf & SGF_UTemp) {
+        float tempf = tempSens.readLastTemp();
+        if(!isnan(tempf)) {
+            temp = (int16_t)(tempf * 100.0f);
+        }
+    }
+    if(sgf & SGF_TempCelsius) tempFlags |= 0x40;   // Signal temp unit (0=F, 1=C)
+    #endif
+    s[20] = (uint16_t)temp & 0xff;
+    s[21] = (uint16_t)temp >> 8;
+
+    // lux (-1 if unavailable)
+    temp32 = -1;
+    #ifdef TC_HAVELIGHT
+    if(sgf & SGF_ULightSens) {
+        temp32 = lightSens.readLux();
+    }
+    #endif
+    SET32(s, 22, temp32);
+
+    // Status flags
+    a = 0;
+    if(csf & CSF_NM)      a |= 0x01; // bit 0: Night mode (0: off, 1: on)
+    if(csf & CSF_OFF)     a |= 0x02; // bit 1: Fake power (0: on,  1: off)
+    #ifdef TC_HAVE_REMOTE
+    if(remoteAllowed)     a |= 0x04; // bit 2: Remote controlling allowed (1) or disabled (0)
+    if(remoteKPAllowed)   a |= 0x08; // bit 3: Remote Keypad controlling allowed (1) or disabled (0)
+    #endif
+    if(csf & CSF_MA)      a |= 0x10; // bit 4: TCD is busy (eg. not ready for time travel)
+    // bit 5 is for "speed from remote", see above
+    // bit 6 used for temp unit, see above
+    // bit 7 used for "speed from RotEnc", see above
+
+    if(memcmp(s + 10, bttfnSnap.buf + 10, 36) || spdFlags != bttfnSnap.spdFlags ||
+       tempFlags != bttfnSnap.tempFlags || a != bttfnSnap.statFlags || !bttfnSnap.seq) {
+        memcpy(bttfnSnap.buf, s, BTTF_PACKET_SIZE);
+        bttfnSnap.spdFlags = spdFlags;
+        bttfnSnap.tempFlags = tempFlags;
+        bttfnSnap.statFlags = a;
+        if(!++bttfnSnap.seq) bttfnSnap.seq++;
+    }
+
+    bttfnSnap.when = millis();
+    bttfnSnapDirty = false;
+}
+
 static void bttfn_fill_response(uint8_t *buf, uint8_t parm)
 {
-    int16_t temp = 0;
-    uint8_t a = 0;
+    uint8_t *s = bttfnSnap.buf;
+
+    if(bttfnSnapDirty || (millis() - bttfnSnap.when >= BTTFN_SNAP_MAXAGE)) {
+        bttfn_snap_render();
+    }
 
     // Clear, but leave serial# (buf + 6-9) untouched
     memset(buf + 10, 0, BTTF_PACKET_SIZE - 10);
 
     if(buf[5] & 0x01) {    // date/time
-        memcpy(&buf[10], bttfnDateBuf, sizeof(bttfnDateBuf));
-        if(presentTime.get1224()) buf[17] |= 0x80;
+        memcpy(&buf[10], &s[10], 8);
         if(parm & 0x80) {
-            a = 0;
-            destinationTime.getCompressed(&buf[36], a);
-            a <<= 2;
-            presentTime.getCompressed(&buf[32], a);
-            a <<= 2;
-            departedTime.getCompressed(&buf[40], a);
-            buf[44] = a;
+            memcpy(&buf[32], &s[32], 13);
         }
     }
     if(buf[5] & 0x02) {    // speed  (-1 if unavailable)
-        temp = -1;         // (Client is supposed to support MC-notifications instead)
-        #ifdef TC_HAVE_REMOTE
-        if(csf & CSF_RSM) {
-            // bttfnRemCurSpd is P0-speed during P0, see below for reason
-            temp = bttfnRemCurSpd;
-            buf[26] |= 0x20;       // Signal that speed is from Remote
-        } else {
-        #endif
-            #ifdef TC_HAVEGPS
-            if((sgf & (SGF_UGPS|SGF_GPS2BTTFN)) == (SGF_UGPS|SGF_GPS2BTTFN)) {
-                // Why "&& (sgf & SGF_GPS2BTTFN)"?
-                // Because: If stationary user uses GPS for time only, speed will
-                // be 0 permanently, and rotary encoder never gets a chance.
-                // In P0, we transmit a fake speed since the props follow speed
-                // after triggering a below-88 TT (which at first only triggers a
-                // wakeup) until the ETTO-timed actual TIMETRAVEL signal
-                temp = (csf & CSF_P0) ? timeTravelP0Speed : myGPS.getSpeed();
-            } else {                        
-            #endif
-                #ifdef TC_HAVE_RE
-                if((sgf & SGF_URotEnc) && (!(csf & CSF_OFF))) {  // fakespeed only valid if FP on
-                    // fakeSpeed is P0-speed during P0, see above for reason
-                    temp = fakeSpeed;
-                    buf[26] |= 0x80;   // Signal that speed is from RotEnc
-                }
-                #endif
-            #ifdef TC_HAVEGPS
-            }
-            #endif
-        #ifdef TC_HAVE_REMOTE
-        }
-        #endif
-        buf[18] = (uint16_t)temp & 0xff;
-        buf[19] = (uint16_t)temp >> 8;
+        buf[18] = s[18];
+        buf[19] = s[19];
+        buf[26] |= bttfnSnap.spdFlags;
     }
     if(buf[5] & 0x04) {    // temperature * 100 (-32768 if unavailable)
-        temp = -32768;
-        #ifdef TC_HAVETEMP
-        if(sgf & SGF_UTemp) {
-            float tempf = tempSens.readLastTemp();
-            if(!isnan(tempf)) {
-                temp = (int16_t)(tempf * 100.0f);
-            }
-        }
-        #endif
-        buf[20] = (uint16_t)temp & 0xff;
-        buf[21] = (uint16_t)temp >> 8;
-        #ifdef TC_HAVETEMP
-        if(sgf & SGF_TempCelsius) buf[26] |= 0x40;   // Signal temp unit (0=F, 1=C)
-        #endif
+        buf[20] = s[20];
+        buf[21] = s[21];
+        buf[26] |= bttfnSnap.tempFlags;
     }
     if(buf[5] & 0x08) {    // lux (-1 if unavailable)
-        int32_t temp32 = -1;
-        #ifdef TC_HAVELIGHT
-        if(sgf & SGF_ULightSens) {
-            temp32 = lightSens.readLux();
-        }
-        #endif
-        SET32(buf, 22, temp32);
+        memcpy(&buf[22], &s[22], 4);
     }
     if(buf[5] & 0x10) {    // Status flags
-        a = 0;
-        if(csf & CSF_NM)      a |= 0x01; // bit 0: Night mode (0: off, 1: on)
-        if(csf & CSF_OFF)     a |= 0x02; // bit 1: Fake power (0: on,  1: off)
-        #ifdef TC_HAVE_REMOTE
-        if(remoteAllowed)     a |= 0x04; // bit 2: Remote controlling allowed (1) or disabled (0)
-        if(remoteKPAllowed)   a |= 0x08; // bit 3: Remote Keypad controlling allowed (1) or disabled (0)
-        #endif
-        if(csf & CSF_MA)      a |= 0x10; // bit 4: TCD is busy (eg. not ready for time travel)
-        // bit 5 is for "speed from remote", see above
-        // bit 6 used for temp unit, see above
-        // bit 7 used for "speed from RotEnc", see above
-        buf[26] |= a;
+        buf[26] |= bttfnSnap.statFlags;
     }
     if(buf[5] & 0x20) {    // Request IP of given device type
         buf[5] &= ~0x20;
@@ -7722,32 +8161,41 @@ static void bttfn_fill_response(uint8_t *buf, uint8_t parm)
     // 3:Remote KP support
     // 4:Support NOT_DATA
     // 5:Support REMCMD_DOOR
-    // 6-7 for future use.
-    buf[31] = 0x01 | 0x04 | 0x08 | 0x10 | 0x20;
+    // 6:Support delta NOT_DATA
+    // 7 for future use.
+    buf[31] = 0x01 | 0x04 | 0x08 | 0x10 | 0x20 | 0x40;
+
+    // Data sequence number: Changes only if data changed
+    // (buf[45] is used for delta marker in NOT_DATA)
+    buf[46] = bttfnSnap.seq;
     
     // buf[5]&0x80 taken (TT)
 }
 
-static bool bttfn_handlePacket(uint8_t *buf, bool isMC)
+static bool bttfn_handlePacket(uint8_t *buf, bool isMC, uint32_t tip32)
 {
-    uint32_t tip32 = 0;
     uint8_t a = 0, ctype = 0, parm = 0, cFlags = 0;
     uint32_t receivedRemID;
     
-    // Check header
-    if(memcmp(buf, BTTFUDPHD, 4))
-        return false;
-
-    // Check checksum
-    if(bttfn_checksum(buf) != buf[BTTF_PACKET_SIZE - 1])
+    // Check header and checksum
+    if(memcmp(buf, BTTFUDPHD, 4) || 
+       (bttfn_checksum(buf) != buf[BTTF_PACKET_SIZE - 1])) {
+        #ifdef TC_BTTFN_BENCH
+        bttfnBench.dropped++;
+        #endif
         return false;
+    }
 
     // Save device support for passive MC (7) and NOT_DATA (6)
     cFlags = buf[4] >> 6;
     buf[4] &= 0x0f;
         
-    if(buf[4] > BTTFN_VERSION)
+    if(buf[4] > BTTFN_VERSION) {
+        #ifdef TC_BTTFN_BENCH
+        bttfnBench.dropped++;
+        #endif
         return false;
+    }
 
     // Check if this is a "discover" packet
     if(isMC) {
@@ -7772,13 +8220,12 @@ static bool bttfn_handlePacket(uint8_t *buf, bool isMC)
     }
 
     // Store client data
-    tip32 = isMC ? tcdmcUDP->remoteIP() : tcdUDP->remoteIP();  
-
     ctype = (uint8_t)buf[10+13];
     
     // Retrieve (optional) request parameter
     // 0-3: Device type for IP lookup
-    // 4-6: For future use
+    // 4-5: For future use
+    // 6:   Client supports delta NOT_DATA
     // 7:   Request displayed destination, present, departed times with date/time request
     parm = buf[24];
 
@@ -7786,7 +8233,10 @@ static bool bttfn_handlePacket(uint8_t *buf, bool isMC)
     // do it from now on in the NOT_DATA notification
     if(parm & 0x80) {
         bttfnDataParm = 0x80;
-        cFlags |= 0x04;
+        cFlags |= BTTFN_CF_COMPR;
+    }
+    if(parm & 0x40) {
+        cFlags |= BTTFN_CF_DELTA;
     }
 
     receivedRemID = storeBTTFNClient(tip32, buf, ctype, cFlags);
@@ -7826,10 +8276,16 @@ static bool bttfn_handlePacket(uint8_t *buf, bool isMC)
         // If seq is < previous, packet is skipped.
         uint32_t seq = GET32(buf, 6);
 
-        // Eval command from remote: 
+        // Queue command from remote for main loop: 
         // 25: Command code
         // 26, 27: parameters
-        bttfn_evalremotecommand(seq, cmd, buf[26], buf[27]);
+        evbEvent ev;
+        ev.type = EVB_REM_CMD;
+        ev.a = cmd;
+        ev.b = buf[26];
+        ev.c = buf[27];
+        ev.val = seq;
+        evb_post(&ev);
 
         // Send no response
         return false;
@@ -7902,6 +8358,22 @@ static void bttfn_notify(uint8_t targetType, uint8_t event, uint16_t payload, ui
     }
 }
 
+/*
+ * Check if speed crossed a threshold that all clients
+ * must see (stand-still, 88mph, unavailable)
+ */
+static bool bttfn_spdCrossed(int oldSpd, int newSpd)
+{
+    static const int spdThresh[] = { 0, 1, 88 };
+
+    for(int i = 0; i < (int)(sizeof(spdThresh)/sizeof(spdThresh[0])); i++) {
+        if((oldSpd < spdThresh[i]) != (newSpd < spdThresh[i]))
+            return true;
+    }
+
+    return false;
+}
+
 static void bttfn_notify_speed()
 {
     int      spd = -1;
@@ -7943,15 +8415,39 @@ static void bttfn_notify_speed()
     }
 
     now = millis();
-    if(spd != oldBTTFNSpd || ssrc != oldBTTFNSSrc || (now - bttfnLastSpeedNot > 2775)) {
-        oldBTTFNSpd = spd;
-        oldBTTFNSSrc = ssrc;
-        bttfn_notify(BTTFN_TYPE_ANY, BTTFN_NOT_SPD, (uint16_t)spd, ssrc, parm3);
-        bttfnLastSpeedNot = now;
-        #ifdef TC_DBG_NET
-        Serial.printf("Sent NOT_SPD %d\n", spd);
-        #endif
+    if(spd != oldBTTFNSpd || ssrc != oldBTTFNSSrc) {
+        // Coalesce speed changes coming in faster than 
+        // BTTFN_SPD_MIN_INT; the latest value is sent once 
+        // the interval has passed. Source changes and 
+        // threshold crossings are always sent immediately.
+        if((ssrc == oldBTTFNSSrc) &&
+           (now - bttfnLastSpeedNot < BTTFN_SPD_MIN_INT) &&
+           !bttfn_spdCrossed(oldBTTFNSpd, spd)) {
+            if(spd != bttfnPendSpd) {
+                if(bttfnPendSpd != -3) bttfnSpdSaved++;
+                bttfnPendSpd = spd;
+            }
+            return;
+        }
+    } else if(now - bttfnLastSpeedNot <= 2775) {
+        // Pending value superseded by return to last sent one
+        if(bttfnPendSpd != -3) {
+            bttfnSpdSaved++;
+            bttfnPendSpd = -3;
+        }
+        return;
     }
+    
+    oldBTTFNSpd = spd;
+    oldBTTFNSSrc = ssrc;
+    bttfnPendSpd = -3;
+    bttfn_notify(BTTFN_TYPE_ANY, BTTFN_NOT_SPD, (uint16_t)spd, ssrc, parm3);
+    bttfnLastSpeedNot = now;
+    bttfnSnapDirty = true;
+    bttfnSpdSent++;
+    #ifdef TC_DBG_NET
+    Serial.printf("Sent NOT_SPD %d\n", spd);
+    #endif
 }
 
 void bttfn_notify_info()
@@ -7966,11 +8462,69 @@ void bttfn_notify_info()
     if(csf & CSF_MA)     parm2 |= BTTFN_TCDI2_BUSY;    // busy, not ready for tt (atm only when menuActive)
     bttfn_notify(BTTFN_TYPE_ANY, BTTFN_NOT_INFO, parm1, parm2, parm3);
     bttfnLastInfo = millisNonZero();
+    bttfnSnapDirty = true;
     #ifdef TC_DBG_NET
     Serial.println("Sent NOT_INFO");
     #endif
 }
 
+/*
+ * Reduce NOT_DATA in BTTFDataBuf to the fields that changed
+ * since the last full/delta packet. Only used if all NOT_DATA
+ * clients announced delta support. Such clients are expected
+ * to keep the seconds running themselves; date/time is only
+ * included if anything but a regular one-second-step changed.
+ * Returns false if nothing changed at all.
+ */
+static bool bttfn_make_delta()
+{
+    uint8_t *b = BTTFDataBuf, *l = BTTFLastDataBuf;
+    uint8_t mask = b[5] & ~0x1d;
+
+    if(b[5] & 0x01) {
+        if(memcmp(b + 10, l + 10, 6) || (b[17] != l[17]) || 
+           (b[16] != ((l[16] + 1) % 60)) || memcmp(b + 32, l + 32, 13)) {
+            mask |= 0x01;
+        } else {
+            memset(b + 32, 0, 13);
+        }
+        // Always remember current time for next step check
+        memcpy(l + 10, b + 10, 8);
+        if(!(mask & 0x01)) memset(b + 10, 0, 8);
+        else memcpy(l + 32, b + 32, 13);
+    }
+    if(b[5] & 0x04) {
+        if(memcmp(b + 20, l + 20, 2) || ((b[26] ^ l[26]) & 0x40)) {
+            mask |= 0x04;
+            memcpy(l + 20, b + 20, 2);
+        } else {
+            b[20] = b[21] = 0;
+        }
+    }
+    if(b[5] & 0x08) {
+        if(memcmp(b + 22, l + 22, 4)) {
+            mask |= 0x08;
+            memcpy(l + 22, b + 22, 4);
+        } else {
+            memset(b + 22, 0, 4);
+        }
+    }
+    if(b[5] & 0x10) {
+        if((b[26] ^ l[26]) & 0x1f) {
+            mask |= 0x10;
+        }
+    }
+    l[26] = b[26];
+    
+    if(!(mask & 0x1d))
+        return false;
+
+    b[5] = mask;
+    b[45] = 1;      // Mark as delta
+
+    return true;
+}
+
 static void bttfn_notify_data()
 {
     if(!bttfnAtLeastOneND)
@@ -7993,7 +8547,26 @@ static void bttfn_notify_data()
     if((csf & (CSF_P0|CSF_P2)) && timeTravelP0Speed < 30)
         return;
 
+    uint8_t fullMask = BTTFDataBuf[5];
+
     bttfn_fill_response(BTTFDataBuf, bttfnDataParm);
+
+    if(!bttfnNotAllDelta && !bttfnDataFull && (bttfnDataSinceFull < BTTFN_DATA_FULL_INT)) {
+        if(!bttfn_make_delta()) {
+            // Nothing changed: Skip entirely
+            BTTFDataBuf[5] = fullMask;
+            bttfnDataSinceFull++;
+            bttfnDataSaved++;
+            return;
+        }
+        bttfnDataSinceFull++;
+        bttfnDataDelta++;
+    } else {
+        memcpy(BTTFLastDataBuf, BTTFDataBuf, BTTF_PACKET_SIZE);
+        BTTFDataBuf[45] = 0;
+        bttfnDataSinceFull = 0;
+        bttfnDataFull = false;
+    }
     
     SET32(BTTFDataBuf, 6, bttfnDataSeqCnt);
     bttfnDataSeqCnt++;
@@ -8010,38 +8583,129 @@ static void bttfn_notify_data()
     tcdUDP->endPacket();
 
     #ifdef TC_DBG_NET
-    Serial.println("Sent NOT_DATA");
+    Serial.printf("Sent NOT_DATA%s\n", BTTFDataBuf[45] ? " (delta)" : "");
     #endif
 
+    // Restore full field mask for next round
+    BTTFDataBuf[5] = fullMask;
+    
+    bttfnDataSent++;
+
     return;
 }
 
-static bool bttfn_checkmc()
+static void bttfn_flush_replies()
 {
-    int psize = tcdmcUDP->parsePacket();
+    // Send out batched replies back to back
+    for(int i = 0; i < bttfnReplyNum; i++) {
+        tcdUDP->beginPacket(IPAddress(bttfnReplyQ[i].IP32), BTTF_DEFAULT_LOCAL_PORT);
+        tcdUDP->write(bttfnReplyQ[i].buf, BTTF_PACKET_SIZE);
+        #ifdef TC_BTTFN_BENCH
+        if(tcdUDP->endPacket()) bttfnBench.replies++;
+        else                    bttfnBench.sendFail++;
+        #else
+        tcdUDP->endPacket();
+        #endif
+    }
+    
+    #ifdef TC_DBG_NET
+    if(bttfnReplyNum) Serial.printf("Sent %d response(s)\n", bttfnReplyNum);
+    #endif
+    
+    bttfnReplyNum = 0;
+}
 
-    if(!psize) {
+/*
+ * Read one packet from socket into the next free reply slot, and
+ * handle it there. If it produced a reply, the slot is taken.
+ */
+static bool bttfn_receive(UDP *udp, bool isMC)
+{
+    if(!udp->parsePacket()) {
         return false;
     }
+
+    byte *buf = bttfnReplyQ[bttfnReplyNum].buf;
+    uint32_t ip32 = udp->remoteIP();
     
-    tcdmcUDP->read(BTTFMCBuf, BTTF_PACKET_SIZE);
+    udp->read(buf, BTTF_PACKET_SIZE);
 
     #ifdef TC_DBG_NET
-    Serial.printf("Received multicast packet from %s\n", tcdmcUDP->remoteIP().toString());
+    if(isMC) Serial.printf("Received multicast packet from %s\n", udp->remoteIP().toString());
     #endif
 
-    if(bttfn_handlePacket(BTTFMCBuf, true)) {
-        tcdUDP->beginPacket(tcdmcUDP->remoteIP(), BTTF_DEFAULT_LOCAL_PORT);
-        tcdUDP->write(BTTFMCBuf, BTTF_PACKET_SIZE);
-        tcdUDP->endPacket();
-        #ifdef TC_DBG_NET
-        Serial.println("Sent response");
-        #endif
+    #ifdef TC_BTTFN_BENCH
+    bttfnBench.reqs++;
+    unsigned long hStart = micros();
+    #endif
+
+    if(bttfn_handlePacket(buf, isMC, ip32)) {
+        bttfnReplyQ[bttfnReplyNum].IP32 = ip32;
+        if(++bttfnReplyNum >= BTTFN_REPLYQ_SIZE) {
+            bttfn_flush_replies();
+        }
     }
 
+    #ifdef TC_BTTFN_BENCH
+    unsigned long hTime = micros() - hStart;
+    bttfnBench.sumHandleUs += hTime;
+    if(hTime > bttfnBench.maxHandleUs) bttfnBench.maxHandleUs = hTime;
+    #endif
+
     return true;
 }
 
+#ifdef TC_BTTFN_BENCH
+/*
+ * Load & latency statistics
+ *
+ * Records how often the sockets are actually polled (the BNLP_SK_*
+ * masks used inside delay loops skip polls), the longest gap 
+ * between two polls (=worst-case added reply latency), requests,
+ * replies, dropped packets, failed sends and expired clients.
+ * Printed and reset along with client expiry (ca every minute).
+ * Load is generated from a host by tools/bttfn_load.py.
+ */
+static void bttfn_bench_loop(uint32_t taskMask)
+{
+    unsigned long now = millis();
+
+    bttfnBench.loops++;
+    for(int i = 0; i < 4; i++) {
+        if(taskMask & (1 << i)) bttfnBench.skipped[i]++;
+    }
+    if(!(taskMask & BNLP_SK_SP)) {
+        if(bttfnBench.lastSPPoll && (now - bttfnBench.lastSPPoll > bttfnBench.maxSPGap)) {
+            bttfnBench.maxSPGap = now - bttfnBench.lastSPPoll;
+        }
+        bttfnBench.lastSPPoll = now;
+    }
+    if(!(taskMask & BNLP_SK_MC)) {
+        if(bttfnBench.lastMCPoll && (now - bttfnBench.lastMCPoll > bttfnBench.maxMCGap)) {
+            bttfnBench.maxMCGap = now - bttfnBench.lastMCPoll;
+        }
+        bttfnBench.lastMCPoll = now;
+    }
+}
+
+static void bttfn_bench_print()
+{
+    Serial.printf("BTTFN bench: loops %u skipped MC/SP/ND/EX %u/%u/%u/%u\n",
+        bttfnBench.loops, bttfnBench.skipped[0], bttfnBench.skipped[1], 
+        bttfnBench.skipped[2], bttfnBench.skipped[3]);
+    Serial.printf("BTTFN bench: reqs %u replies %u dropped %u sendfail %u expired %u\n",
+        bttfnBench.reqs, bttfnBench.replies, bttfnBench.dropped, 
+        bttfnBench.sendFail, bttfnBench.expired);
+    Serial.printf("BTTFN bench: max poll gap SP %lums MC %lums, handling max %uus avg %uus, max burst %u\n",
+        bttfnBench.maxSPGap, bttfnBench.maxMCGap, bttfnBench.maxHandleUs,
+        bttfnBench.reqs ? bttfnBench.sumHandleUs / bttfnBench.reqs : 0, bttfnBench.maxBurst);
+    
+    bttfnBench.maxSPGap = bttfnBench.maxMCGap = 0;
+    bttfnBench.maxHandleUs = 0;
+    bttfnBench.maxBurst = 0;
+}
+#endif
+
 static void bttfn_setup()
 {
     // Prepare hostName hash for discover packets
@@ -8070,10 +8734,13 @@ static void bttfn_setup()
     do {
         bttfnSessionID = esp_random() ^ esp_random() ^ esp_random();
     } while(!bttfnSessionID);
+
+    sched_at(SCH_BTEXP, 57*1000);
 }
 
 static void bttfn_setup_sensors()
 {
+    bttfnDataFull = true;
     BTTFDataBuf[5] &= ~0x0c;
     #ifdef TC_HAVETEMP
     if(sgf & SGF_UTemp)      BTTFDataBuf[5] |= 0x04;
@@ -8085,39 +8752,48 @@ static void bttfn_setup_sensors()
 
 bool bttfn_loop(uint32_t taskMask)
 {
-    bool resmc = false;
+    bool gotmc = false, gotsp = false, got;
+    unsigned long start = micros();
+    #ifdef TC_BTTFN_BENCH
+    uint32_t burst = 0;
+    
+    bttfn_bench_loop(taskMask);
+    #endif
 
-    if(!(taskMask & BNLP_SK_MC)) {
-        resmc = bttfn_checkmc();
-    }
+    // Drain both sockets within time budget; replies
+    // are batched and sent back to back.
+    do {
+        got = false;
+        if(!(taskMask & BNLP_SK_MC) && bttfn_receive(tcdmcUDP, true)) {
+            got = gotmc = true;
+            #ifdef TC_BTTFN_BENCH
+            burst++;
+            #endif
+        }
+        if(!(taskMask & BNLP_SK_SP) && bttfn_receive(tcdUDP, false)) {
+            got = gotsp = true;
+            #ifdef TC_BTTFN_BENCH
+            burst++;
+            #endif
+        }
+    } while(got && (micros() - start < BTTFN_DRAIN_BUDGET));
 
-    int psize = 0;
+    bttfn_flush_replies();
 
-    if(!(taskMask & BNLP_SK_SP)) {
-        psize = tcdUDP->parsePacket();
-    }
+    #ifdef TC_BTTFN_BENCH
+    if(burst > bttfnBench.maxBurst) bttfnBench.maxBurst = burst;
+    #endif
 
-    if(!psize) {
+    if(!gotsp) {
         if(!(taskMask & BNLP_SK_NOTDATA)) {
             bttfn_notify_data();
         }
         if(!(taskMask & BNLP_SK_EXPIRE)) {
             bttfn_expire_clients();
         }
-        return false | resmc;
     }
-    
-    tcdUDP->read(BTTFUDPBuf, BTTF_PACKET_SIZE);
 
-    if(bttfn_handlePacket(BTTFUDPBuf, false)) {
-        tcdUDP->beginPacket(tcdUDP->remoteIP(), BTTF_DEFAULT_LOCAL_PORT);
-        tcdUDP->write(BTTFUDPBuf, BTTF_PACKET_SIZE);
-        tcdUDP->endPacket();
-    } else if(!psize) {
-        (*r)(BTTFUDPBuf, 0, BTTF_PACKET_SIZE);
-    }
-
-    return true;
+    return gotsp || gotmc;
 }
 
 bool bttfn_loop_ex()
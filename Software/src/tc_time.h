@@ -293,9 +293,18 @@ extern bool remoteKPAllowed;
 extern tcRTC rtc;
 
 extern int8_t        manualNightMode;
-extern unsigned long manualNMNow;
+
+#ifdef TC_HAVELIGHT
+extern bool          autoBri;
+extern uint16_t      abriLuxLo;
+extern uint16_t      abriLuxHi;
+void autoBriReset();
+#endif
+#define MANNM_DUR (30*60*1000)    // Manual NM pauses auto-NM for 30 mins
 extern bool          forceReEvalANM;
 
+unsigned long sqwMaxLateness();
+
 extern uint8_t remMonth;
 extern uint8_t remDay;
 extern uint8_t remHour;
@@ -0,0 +1,324 @@
+/*
+ * -------------------------------------------------------------------
+ * CircuitSetup.us Time Circuits Display
+ * (C) 2022-2026 Thomas Winischhofer (A10001986)
+ * https://github.com/realA10001986/Time-Circuits-Display
+ * https://tcd.out-a-ti.me
+ * 
+ * Time travel timing: P0 acceleration, P1 and ETTO lead times
+ * 
+ * -------------------------------------------------------------------
+ * License: Modified MIT NON-AI
+ * 
+ * Permission is hereby granted, free of charge, to any person 
+ * obtaining a copy of this software and associated documentation 
+ * files (the "Software"), to deal in the Software without restriction, 
+ * including without limitation the rights to use, copy, modify, 
+ * merge, publish, distribute, sublicense, and/or sell copies of the 
+ * Software, and to permit persons to whom the Software is furnished to 
+ * do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be 
+ * included in all copies or substantial portions of the Software.
+ * 
+ * Links inside the Software pointing to the original source must not 
+ * be changed or removed.
+ *
+ * In addition, the following restrictions apply:
+ * 
+ * 1. The Software and any modifications made to it may not be used 
+ * for the purpose of training or improving machine learning algorithms, 
+ * including but not limited to artificial intelligence, natural 
+ * language processing, or data mining. This condition applies to any 
+ * derivatives, modifications, or updates based on the Software code. 
+ * Any usage of the Software in an AI-training dataset is considered a 
+ * breach of this License.
+ *
+ * 2. The Software may not be included in any dataset used for 
+ * training or improving machine learning algorithms, including but 
+ * not limited to artificial intelligence, natural language processing, 
+ * or data mining.
+ *
+ * 3. Any person or organization found to be in violation of these 
+ * restrictions will be subject to legal action and may be held liable 
+ * for any damages resulting from such use.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "tc_global.h"
+
+#include "tc_ttplan.h"
+
+/*
+ * No hardware or Arduino dependencies; the caller owns the clock.
+ * This keeps the timing of the time travel sequence testable on the
+ * host (see test/test_ttplan).
+ */
+
+// Acceleraton times
+const int16_t tt_p0_delays_rl[88] =
+{
+      0, 100, 100,  90,  80,  80,  80,  80,  80,  80,  // 0 - 9  10mph 0.8s    0.8=800ms
+     80,  80,  80,  80,  80,  80,  80,  80,  80,  80,  // 10-19  20mph 1.6s    0.8
+     90, 100, 110, 110, 110, 110, 110, 110, 120, 120,  // 20-29  30mph 2.7s    1.1
+    120, 130, 130, 130, 130, 130, 130, 130, 130, 140,  // 30-39  40mph 4.0s    1.3
+    150, 160, 190, 190, 190, 190, 190, 190, 210, 230,  // 40-49  50mph 5.9s    1.9
+    230, 230, 240, 240, 240, 240, 240, 240, 250, 250,  // 50-59  60mph 8.3s    2.4
+    250, 250, 260, 260, 270, 270, 270, 280, 290, 300,  // 60-69  70mph 11.0s   2.7
+    320, 330, 350, 370, 370, 380, 380, 390, 400, 410,  // 70-79  80mph 14.7s   3.7
+    410, 410, 410, 410, 410, 410, 410, 410             // 80-87  90mph 18.8s   4.1
+};
+const int16_t tt_p0_delays_movie[88] =
+{
+      0,  90,  90,  90,  90,  90,  90,  95,  95, 100,  // m0 - 9  10mph  0- 9: 0.83s  (m=measured, i=interpolated)
+    105, 110, 115, 120, 125, 130, 135, 140, 145, 150,  // i10-19  20mph 10-19: 1.27s
+    155, 160, 165, 170, 175, 180, 185, 190, 195, 200,  // i20-29  30mph 20-29: 1.77s
+    200, 200, 202, 203, 204, 205, 206, 207, 208, 209,  // m30-39  40mph 30-39: 2s
+    210, 211, 212, 213, 214, 215, 216, 217, 218, 219,  // i40-49  50mph 40-49: 2.1s
+    220, 221, 222, 223, 224, 225, 226, 227, 228, 229,  // m50-59  60mph 50-59: 2.24s
+    230, 233, 236, 240, 243, 246, 250, 253, 256, 260,  // i60-69  70mph 60-69: 2.47s
+    263, 266, 270, 273, 276, 280, 283, 286, 290, 293,  // m70-79  80mph 70-79: 2.78s
+    296, 300, 300, 303, 303, 306, 310, 310             // i80-88  90mph 80-88: 2.4s   total 17.6 secs
+};
+
+/*
+ * ttplan_init()
+ *
+ */
+void ttplan_init(ttCurve *c, const int16_t *delays, float factor)
+{
+    long totDelay = 0;
+
+    c->delays = delays;
+    c->factor = factor;
+
+    // Calculate start point of P1 sequence
+    c->pointOfP1 = 0;
+    for(int i = 1; i < 88; i++) {
+        c->pointOfP1 += (unsigned long)(((float)(delays[i])) / factor);
+    }
+    c->ettoBase = c->pointOfP1;
+    c->ettoLeadPoint = c->ettoBase - (ETTO_LEAD_TIME - ETTO_LAT);
+    c->pointOfP1NoLead = c->pointOfP1;  // for lead-less P1
+    c->pointOfP1 -= TT_P1_POINT88;      // for normal P1
+
+    // Calculate total elapsed time for each mph value
+    // (in order to time P0/P1 relative to current actual speed)
+    for(int i = 0; i < 88; i++) {
+        totDelay += (long)(((float)(delays[i])) / factor);
+        c->totDelays[i] = totDelay;
+    }
+}
+
+/*
+ * ttplan_p0()
+ *
+ * Complete sequence with speedo: Plan P0 (speed count-up), P1 and
+ * ETTO. speed is the current speed (GPS, RotEnc, Remote), or -1 if 
+ * there is none. Returns false if speed is >= 88, ie there is no P0.
+ */
+bool ttplan_p0(const ttCurve *c, ttPlan *p, int speed, bool havePreTT, bool fixedLead, bool netLead)
+{
+    long currTotDur = 0;
+    long ettoLeadPoint = c->ettoLeadPoint;
+    long myPointOfP1 = havePreTT ? c->pointOfP1NoLead : c->pointOfP1;
+
+    p->preTTSound = havePreTT;
+    p->p1NoLead = havePreTT;
+    p->p0Delay = havePreTT ? 500 : 2000;   // Delay of 2000 too long if we play ttaccel
+    p->p1LeadTime = p->ettoLeadTime = 0;
+    p->netLeadTime = ETTO_LEAD_TIME - ETTO_LAT;
+    p->trigETTO = p->prepare = false;
+
+    if(speed >= 0) {
+        p->p0Delay = 0;
+        if(speed >= 88)
+            return false;
+            
+        currTotDur = c->totDelays[speed];
+
+        // If the strict 5s lead is not required (as is the case
+        // if fixedLead is false), we can also cut short 
+        // P1 by skipping the fade-in part of the sound, if the
+        // the remaining part of the acceleration until 88 is too
+        // short.
+
+        if(!fixedLead) {
+            if(currTotDur > c->pointOfP1) {
+                // If we're past normal P1 start point,
+                // cut P1 short by skipping lead
+                // (and skip user's acceleration sound)
+                myPointOfP1 = c->pointOfP1NoLead;
+                p->p1NoLead = true;
+                p->preTTSound = false;
+            } else if(p->preTTSound) {
+                // Don't play user's acceleration sound if it would
+                // be played for only a very short time (~2 secs)
+                // But play with-lead version in that case.
+                if(currTotDur > (c->pointOfP1 - 600)) {
+                    myPointOfP1 = c->pointOfP1;
+                    p->p1NoLead = false;
+                    p->preTTSound = false;
+                } else {
+                    myPointOfP1 = c->pointOfP1NoLead;
+                    p->p1NoLead = true;
+                }
+            }
+        }
+        
+        // If the strict 5s lead is not required (as is the
+        // case if fixedLead is false), we can shorten that 
+        // lead. We calculate it based on current speed and
+        // the remaining time until reaching 88.
+        
+        if(!fixedLead && netLead) {
+            if(currTotDur >= ettoLeadPoint) {
+                // Calc time until 88 for bttfn clients
+                if(ettoLeadPoint < myPointOfP1) {
+                    if(currTotDur >= myPointOfP1) {
+                        ettoLeadPoint = myPointOfP1;
+                        p->netLeadTime = c->ettoBase - myPointOfP1;
+                    } else {
+                        ettoLeadPoint = currTotDur;
+                        p->netLeadTime = c->ettoBase - currTotDur;
+                    }
+                    if(p->netLeadTime > ETTO_LAT) {
+                        p->netLeadTime -= ETTO_LAT;
+                    }
+                }
+            }
+        }
+    }
+
+    // Now calculate the times until P1 and until reaching 88.
+    // If time needed to reach 88mph is shorter than ettoLeadTime
+    // or pointOfP1: Need add'l delay before speed counter kicks in.
+    // This add'l delay is put into p0Delay.
+
+    if(fixedLead || netLead) {
+
+        p->trigETTO = true;
+        
+        if(currTotDur >= ettoLeadPoint || currTotDur >= myPointOfP1) {
+
+            if(currTotDur >= ettoLeadPoint && currTotDur >= myPointOfP1) {
+
+                // Both outside our remaining time period:
+                if(ettoLeadPoint <= myPointOfP1) {
+                    // ETTO first:
+                    p->ettoLeadTime = 0;
+                    p->p1LeadTime = myPointOfP1 - ettoLeadPoint;
+                    p->p0Delay = currTotDur - ettoLeadPoint;
+                } else {
+                    // P1 first:
+                    p->p1LeadTime = 0;
+                    p->ettoLeadTime = ettoLeadPoint - myPointOfP1;
+                    p->p0Delay = currTotDur - myPointOfP1;
+                }
+
+            } else if(currTotDur >= ettoLeadPoint) {
+
+                // etto outside
+                p->ettoLeadTime = 0;
+                p->p1LeadTime = myPointOfP1 - ettoLeadPoint;
+                p->p0Delay = currTotDur - ettoLeadPoint;
+
+            } else {
+
+                // P1 outside
+                p->p1LeadTime = 0;
+                p->ettoLeadTime = ettoLeadPoint - myPointOfP1;
+                p->p0Delay = currTotDur - myPointOfP1;
+
+            }
+
+        } else {
+
+            p->p1LeadTime = myPointOfP1 - currTotDur + p->p0Delay;
+            p->ettoLeadTime = ettoLeadPoint - currTotDur + p->p0Delay;
+
+        }
+
+        // If there is time between NOW and ETTO_LEAD start, send
+        // PREPARE message to networked clients.
+        p->prepare = (p->ettoLeadTime > 500);
+
+    } else if(currTotDur >= myPointOfP1) {
+        p->p1LeadTime = 0;
+        p->p0Delay = currTotDur - myPointOfP1;
+    } else {
+        p->p1LeadTime = myPointOfP1 - currTotDur + p->p0Delay;
+    }
+
+    return true;
+}
+
+/*
+ * ttplan_nop0()
+ *
+ * Complete sequence without P0 (no speedo, or speed already >= 88),
+ * with ETTO and/or network clients: Plan P1 and ETTO.
+ */
+void ttplan_nop0(ttPlan *p, bool forceNoLead, bool fixedLead, bool havePreTT)
+{
+    long ettoLeadT = ETTO_LEAD_TIME - ETTO_LAT;
+    long P1_88 = TT_P1_POINT88;
+
+    p->p0Delay = 0;
+    p->trigETTO = true;
+    p->p1NoLead = false;
+    p->preTTSound = p->prepare = false;
+    p->netLeadTime = ettoLeadT;
+
+    if(forceNoLead && !fixedLead) {
+        P1_88 = 0;
+        p->p1NoLead = true;
+        p->netLeadTime = ettoLeadT = P1_88;
+    }
+
+    if(ettoLeadT >= P1_88) {
+        p->ettoLeadTime = 0;
+        p->p1LeadTime = ettoLeadT - P1_88;
+
+        if((p->p1LeadTime > 3000) && havePreTT) {
+            p->preTTSound = true;
+            p->p1LeadTime = ettoLeadT;
+            p->p1NoLead = true;
+        }
+        
+    } else {
+        p->p1LeadTime = 0;
+        p->ettoLeadTime = P1_88 - ettoLeadT;
+        p->prepare = (p->ettoLeadTime > 500);
+    }
+}
+
+/*
+ * ttplan_p0_step()
+ *
+ * P0: Advance speed by one mph, or more if the main loop was late
+ * by more than the next step(s). Returns the new speed and the delay
+ * until the next step; late is how much the current step was late.
+ */
+int ttplan_p0_step(const ttCurve *c, int speed, long late, long *delay)
+{
+    long d = 0;
+
+    if(++speed < 88) {
+        d = (long)(((float)(c->delays[speed])) / c->factor) - late;
+        while(d <= 0 && ++speed < 88) {
+            d += (long)(((float)(c->delays[speed])) / c->factor);
+        }
+    }
+
+    *delay = d;
+
+    return speed;
+}
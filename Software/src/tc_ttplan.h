@@ -0,0 +1,102 @@
+/*
+ * -------------------------------------------------------------------
+ * CircuitSetup.us Time Circuits Display
+ * (C) 2022-2026 Thomas Winischhofer (A10001986)
+ * https://github.com/realA10001986/Time-Circuits-Display
+ * https://tcd.out-a-ti.me
+ * 
+ * Time travel timing: P0 acceleration, P1 and ETTO lead times
+ * 
+ * -------------------------------------------------------------------
+ * License: Modified MIT NON-AI
+ * 
+ * Permission is hereby granted, free of charge, to any person 
+ * obtaining a copy of this software and associated documentation 
+ * files (the "Software"), to deal in the Software without restriction, 
+ * including without limitation the rights to use, copy, modify, 
+ * merge, publish, distribute, sublicense, and/or sell copies of the 
+ * Software, and to permit persons to whom the Software is furnished to 
+ * do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be 
+ * included in all copies or substantial portions of the Software.
+ * 
+ * Links inside the Software pointing to the original source must not 
+ * be changed or removed.
+ *
+ * In addition, the following restrictions apply:
+ * 
+ * 1. The Software and any modifications made to it may not be used 
+ * for the purpose of training or improving machine learning algorithms, 
+ * including but not limited to artificial intelligence, natural 
+ * language processing, or data mining. This condition applies to any 
+ * derivatives, modifications, or updates based on the Software code. 
+ * Any usage of the Software in an AI-training dataset is considered a 
+ * breach of this License.
+ *
+ * 2. The Software may not be included in any dataset used for 
+ * training or improving machine learning algorithms, including but 
+ * not limited to artificial intelligence, natural language processing, 
+ * or data mining.
+ *
+ * 3. Any person or organization found to be in violation of these 
+ * restrictions will be subject to legal action and may be held liable 
+ * for any damages resulting from such use.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY 
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, 
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE 
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _TC_TTPLAN_H
+#define _TC_TTPLAN_H
+
+#include <stdint.h>
+
+// ACTUAL POINT OF TIME TRAVEL:
+#define TT_P1_POINT88   1400    // ms into "starttravel" sample, when 88mph is reached.
+
+// Preprocessor config for External Time Travel Output (ETTO):
+// Lead time from trigger (LOW->HIGH) to actual tt (ie when 88mph is reached)
+// The external prop has ETTO_LEAD_TIME ms to play its pre-tt sequence. After
+// ETTO_LEAD_TIME ms, 88mph is reached, and the actual tt takes place.
+#define ETTO_LEAD_TIME      5000
+#define ETTO_LAT              50  // DO NOT CHANGE
+
+// Acceleration curve, set up once by ttplan_init().
+// All points are in ms from 0mph.
+typedef struct {
+    const int16_t *delays;          // ms per mph step (88 entries)
+    float         factor;           // delays are divided by this
+    long          totDelays[88];    // elapsed time at each mph
+    long          pointOfP1;        // P1 start, normal P1
+    long          pointOfP1NoLead;  // P1 start, lead-less P1
+    long          ettoBase;         // 88mph
+    long          ettoLeadPoint;    // ETTO start; can be negative
+} ttCurve;
+
+// Timers for one time travel, relative to the trigger
+typedef struct {
+    long          p0Delay;          // before speed starts counting up
+    long          p1LeadTime;       // until P1 starts
+    long          ettoLeadTime;     // until ETTO/network TT, if trigETTO
+    uint16_t      netLeadTime;      // lead time sent with network TT
+    bool          trigETTO;
+    bool          p1NoLead;
+    bool          preTTSound;       // play user's acceleration sound now
+    bool          prepare;          // send PREPARE to network now
+} ttPlan;
+
+extern const int16_t tt_p0_delays_rl[88];
+extern const int16_t tt_p0_delays_movie[88];
+
+void ttplan_init(ttCurve *c, const int16_t *delays, float factor);
+bool ttplan_p0(const ttCurve *c, ttPlan *p, int speed, bool havePreTT, bool fixedLead, bool netLead);
+void ttplan_nop0(ttPlan *p, bool forceNoLead, bool fixedLead, bool havePreTT);
+int  ttplan_p0_step(const ttCurve *c, int speed, long late, long *delay);
+
+#endif
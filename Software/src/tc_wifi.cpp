@@ -56,6 +56,9 @@
 #include "tc_global.h"
 
 #include <Arduino.h>
+#ifdef TC_MQTT_TASK
+#include <atomic>
+#endif
 
 #include "src/WiFiManager/WiFiManager.h"
 
@@ -70,6 +73,9 @@
 #include "tc_settings.h"
 #include "tc_wifi.h"
 #include "tc_keypad.h"
+#include "tc_evbus.h"
+#include "tc_sched.h"
+
 #ifdef TC_HAVEMQTT
 #include "mqtt.h"
 #endif
@@ -534,6 +540,20 @@ const char menu_item[]  = "<a href='http://%s' target=_blank title='%s'><img sty
 
 static char newversion[8];
 static unsigned long lastUpdateCheck = 0;
+
+// Bounded string builder on a fixed buffer (no heap)
+typedef struct {
+    char *buf;
+    int  size;
+    int  len;
+} strBld;
+#define CP_ITEM_ARENA 512       // Menu item (incl. image)
+#define UPL_NAME_MAX  128       // Sanitized upload file name
+
+// Heap statistics while Config Portal is active
+static uint32_t      cpMinFreeHeap = 0xffffffff;
+static uint32_t      cpMinMaxBlock = 0xffffffff;
+static unsigned long cpHeapNow = 0;
 static unsigned long lastUpdateLiveCheck = 0;
 
 #define WLA_IP      1
@@ -578,6 +598,10 @@ static bool haveAC = false;
 static int  numUploads = 0;
 static int  *ACULerr = NULL;
 static int  *opType = NULL;
+#ifdef TC_DBG_WIFI
+static unsigned long uplStart = 0;
+static unsigned long wmProcNow = 0;
+#endif
 
 bool                 pubMQTT = false;
 #ifdef TC_HAVEMQTT
@@ -604,6 +628,25 @@ static bool          mqttPingDone = false;
 static unsigned long mqttPingNow = 0;
 static unsigned long mqttPingInt = MQTT_SHORT_INT;
 static uint16_t      mqttPingsExpired = 0;
+#ifdef TC_MQTT_TASK
+// MQTT is serviced by mqttTask on core 0. Received display messages 
+// are handed to the main loop through mqttRecvMsg, publish requests 
+// from the main loop go through mqttPubQueue.
+#define MQTT_PUBQ_LEN    4
+#define MQTT_PUB_TLEN    128
+#define MQTT_PUB_PLEN    64
+typedef struct {
+    char     topic[MQTT_PUB_TLEN];
+    char     pl[MQTT_PUB_PLEN];
+    uint16_t len;
+} mqttPubMsg;
+static TaskHandle_t      mqttTaskHandle = NULL;
+static QueueHandle_t     mqttPubQueue = NULL;
+static char              *mqttRecvMsg[3] = { NULL };
+static std::atomic<bool> mqttRecvPending[3];
+// mqttClient is only touched by mqttTask; its state is published here
+static std::atomic<int>  mqttCachedState(MQTT_DISCONNECTED);
+#endif
 #endif
 
 static unsigned int wmLenBuf = 0;
@@ -616,6 +659,7 @@ static void checkForUpdate();
 static void saveParamsCallback(int);
 static void saveWiFiCallback(const char *ssid, const char *pass, const char *bssid);
 static void preUpdateCallback();
+static void preOTAUpdateCallback();
 static void postUpdateCallback(bool);
 static int  menuOutLenCallback();
 static void menuOutCallback(String& page, unsigned int ssize);
@@ -626,6 +670,10 @@ static bool preWiFiScanCallback();
 static void updateConfigPortalValues();
 
 static bool isIp(char *str);
+
+static void sbInit(strBld& sb, char *buf, int size);
+static bool sbPrintf(strBld& sb, const char *fmt, ...);
+static void sanitizeUploadName(const char *src, char *dst, int dstSize);
 static IPAddress stringToIp(char *str);
 
 static void getServerParam(const char *name, char *destBuf, size_t length, int minval, int maxval, int defaultVal);
@@ -650,6 +698,11 @@ static bool mqttReconnect(bool force = false);
 static void mqttLooper();
 static void mqttCallback(char *topic, byte *payload, unsigned int length);
 static void mqttSubscribe();
+static void mqttService();
+static void receiveMQTTMsg(int idx, uint32_t dmask, char *tempBuf);
+#ifdef TC_MQTT_TASK
+static void mqttTask(void *param);
+#endif
 #endif
 
 #ifdef TC_HAVEMQTT
@@ -658,6 +711,9 @@ static void initMQTTMsg(int idx)
     if((mqttMsg[idx] = (char *)malloc(256))) {
         memset(mqttMsg[idx], 0, 256);
         if(check_file_SD(mqttAudioFile[idx])) haveMQTTaudio |= (1 << idx);
+        #ifdef TC_MQTT_TASK
+        mqttRecvMsg[idx] = (char *)malloc(256);
+        #endif
     }
 }
 #endif
@@ -849,7 +905,7 @@ void wifi_setup()
 
     wm.setSaveWiFiCallback(saveWiFiCallback);
     wm.setSaveParamsCallback(saveParamsCallback);
-    wm.setPreOtaUpdateCallback(preUpdateCallback);
+    wm.setPreOtaUpdateCallback(preOTAUpdateCallback);
     wm.setPostOtaUpdateCallback(postUpdateCallback);
     wm.setWebServerCallback(setupWebServerCallback);
     wm.setMenuOutLenCallback(menuOutLenCallback);
@@ -1069,8 +1125,15 @@ void wifi_setup()
 
         mqttReconnect(true);
         mqttInitialConnectNow = millisNonZero();
-        
+
+        #ifdef TC_MQTT_TASK
+        // Rest done in mqttTask
+        mqttCachedState.store(mqttClient.state(), std::memory_order_release);
+        mqttPubQueue = xQueueCreate(MQTT_PUBQ_LEN, sizeof(mqttPubMsg));
+        xTaskCreatePinnedToCore(mqttTask, "mqttTask", 6144, NULL, 1, &mqttTaskHandle, 0);
+        #else
         // Rest done in loop
+        #endif
             
     } else {
 
@@ -1097,34 +1160,17 @@ void wifi_loop()
 
 #ifdef TC_HAVEMQTT
     if(useMQTT) {
-        if(mqttClient.state() != MQTT_CONNECTING) {
-            if(!mqttClient.connected()) {
-                if(mqttOldState || mqttRestartPing) {
-                    // Disconnection first detected:
-                    mqttPingDone = mqttDoPing ? false : true;
-                    mqttPingNow = mqttRestartPing ? millisNonZero() : 0;
-                    mqttOldState = false;
-                    mqttRestartPing = false;
-                    mqttSubAttempted = false;
-                }
-                if(mqttDoPing && !mqttPingDone) {
-                    audio_loop();
-                    mqttPing();
-                    audio_loop();
-                }
-                if(mqttPingDone) {
-                    audio_loop();
-                    mqttReconnect();
-                    audio_loop();
-                }
-            } else {
-                // Only call Subscribe() if connected
-                mqttSubscribe();
-                mqttOldState = true;
-                mqttInitialConnectNow = 0;
+        #ifdef TC_MQTT_TASK
+        // Pick up messages received by mqttTask
+        for(int i = 0; i < 3; i++) {
+            if(mqttRecvPending[i].load(std::memory_order_acquire)) {
+                receiveMQTTMsg(i, 1 << i, mqttRecvMsg[i]);
+                mqttRecvPending[i].store(false, std::memory_order_release);
             }
         }
-        mqttClient.loop();
+        #else
+        mqttService();
+        #endif
 
         // Time-out waiting for MQTT connection upon boot in case MQTT 
         // has control over fake-power and we wait for POWER_ON.
@@ -1349,8 +1395,24 @@ void wifi_loop()
         esp_restart();
     }
 
+    #ifdef TC_DBG_WIFI
+    wmProcNow = millis();
+    #endif
     wm.process();
 
+    // Track heap while portal is active
+    if((wm.getWebPortalActive() || wifiInAPMode) && (millis() - cpHeapNow >= 1000)) {
+        uint32_t fh = ESP.getFreeHeap(), mb = ESP.getMaxAllocHeap();
+        cpHeapNow = millis();
+        if(fh < cpMinFreeHeap || mb < cpMinMaxBlock) {
+            if(fh < cpMinFreeHeap) cpMinFreeHeap = fh;
+            if(mb < cpMinMaxBlock) cpMinMaxBlock = mb;
+            #ifdef TC_DBG_WIFI
+            Serial.printf("Config Portal: Min free heap %u, min largest block %u\n", cpMinFreeHeap, cpMinMaxBlock);
+            #endif
+        }
+    }
+
     // WiFi power management
     // If a delay > 0 is configured, WiFi is powered-down after timer has
     // run out. The timer starts when the device is powered-up/boots.
@@ -1982,6 +2044,14 @@ static void preUpdateCallback()
     destinationTime.on();
 }
 
+// Web OTA: A firmware update from SD must not hold on to Update,
+// and its image must not be installed over the new one at boot.
+static void preOTAUpdateCallback()
+{
+    fwupd_stop(true);
+    preUpdateCallback();
+}
+
 static void preUpdateCallback_int()
 {
     preUpdateCallback();
@@ -2051,58 +2121,50 @@ static void menuOutCallback(String& page, unsigned int ssize)
     char *id;
     uint8_t type;
     char lbuf[20];
-    char *strBuf = (char *)malloc(ssize + 8);
+    char arena[CP_ITEM_ARENA];
+    strBld sb;
+    bool hdr = false;
 
-    if(!strBuf) return;
-
-    strBuf[0] = 0;
+    // page is pre-sized (ssize from menuOutLenCallback), so
+    // appending to it does not cause re-allocation.
     
     if(numCli > 6) numCli = 6;
 
-    if(numCli) {
+    for(int i = 0; i < numCli; i++) {
 
-        bool hdr = false;
+        if(bttfnGetClientInfo(i, &id, &ip, &type)) {
+        
+            if(type >= BTTFN_TYPE__MIN && type <= BTTFN_TYPE__MAX) {
+
+                // id is max 13 chars. If id[12] == '.' it is maxed out, 
+                // hostname is too long, and we use IP instead.
+                // (using strcpy is safe, there are 14 bytes in buffer, 0-term)
+                if(id[0] && (strlen(id) < 13 || id[12] != '.')) {
+                    strcpy(lbuf, id);
+                    strcat(lbuf, ".local");
+                } else {
+                    sprintf(lbuf, "%d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
+                }
 
-        for(int i = 0; i < numCli; i++) {
-    
-            if(bttfnGetClientInfo(i, &id, &ip, &type)) {
-            
-                if(type >= BTTFN_TYPE__MIN && type <= BTTFN_TYPE__MAX) {
+                sbInit(sb, arena, sizeof(arena));
+                if(sbPrintf(sb, menu_item, 
+                            lbuf,
+                            menu_tp[type - 1], 
+                            cliImages[type - 1],
+                            menu_tp[type - 1])) {
                     if(!hdr) {
-                        strcat(strBuf, menu_myDiv);
+                        page += menu_myDiv;
                         hdr = true;
                     }
-
-                    // id is max 13 chars. If id[12] == '.' it is maxed out, 
-                    // hostname is too long, and we use IP instead.
-                    // (using strcpy is safe, there are 14 bytes in buffer, 0-term)
-                    if(id[0] && (strlen(id) < 13 || id[12] != '.')) {
-                        strcpy(lbuf, id);
-                        strcat(lbuf, ".local");
-                    } else {
-                        sprintf(lbuf, "%d.%d.%d.%d", ip[0], ip[1], ip[2], ip[3]);
-                    }
-                    
-                    sprintf(&strBuf[strlen(strBuf)], menu_item, 
-                          lbuf,
-                          menu_tp[type - 1], 
-                          cliImages[type - 1],
-                          menu_tp[type - 1]);
+                    page += sb.buf;
                 }
             }
         }
-
-        if(hdr) {
-            strcat(strBuf, "</div>");
-        }
-
     }
 
-    if(strBuf[0]) {
-        page += strBuf;
+    if(hdr) {
+        page += "</div>";
     }
-
-    free(strBuf);
 }
 
 static bool preWiFiScanCallback()
@@ -2636,7 +2698,11 @@ static const char *wmBuildMQTTstate(const char *dest, int op)
             cls = col_gr;
         }
     } else {
+        #ifdef TC_MQTT_TASK
+        s = mqttCachedState.load(std::memory_order_acquire);
+        #else
         s = mqttClient.state();
+        #endif
         switch(s) {
         case MQTT_CONNECTED:
             msg = mqttMsgConnected;
@@ -2770,64 +2836,48 @@ static void setupWebServerCallback()
     wm.server->on(R_updateacdone, HTTP_POST, &handleUploadDone, &handleUploading);
 }
 
-static void doCloseACFile(int idx, bool doRemove)
+static bool doCloseACFile(int idx, bool doRemove)
 {
+    bool ret = true;
+    
     if(haveACFile) {
-        closeACFile(acFile);
+        ret = closeACFile(acFile);
         haveACFile = false;
     }
-    if(doRemove) removeACFile(idx);  
+    if(doRemove) removeACFile(idx);
+
+    return ret;
 }
 
 static void handleUploading()
 {
     HTTPUpload& upload = wm.server->upload();
+    #ifdef TC_DBG_WIFI
+    bool fileDone = false;
+    #endif
 
     if(upload.status == UPLOAD_FILE_START) {
 
-          String c = upload.filename;
-          const char *illChrs = "|~><:*?\" ";
-          int temp;
-          char tempc;
+          #ifdef TC_DBG_WIFI
+          uplStart = millis();
+          #endif
+
+          char c[UPL_NAME_MAX];
 
           if(numUploads >= MAX_SIM_UPLOADS) {
             
               haveACFile = false;
 
               #ifdef TC_DBG_WIFI
-              Serial.printf("handleUploading: Too many files, ignoring %s\n", c.c_str());
+              Serial.printf("handleUploading: Too many files, ignoring %s\n", upload.filename.c_str());
               #endif
 
           } else {
 
-              c.toLowerCase();
+              sanitizeUploadName(upload.filename.c_str(), c, sizeof(c));
     
               #ifdef TC_DBG_WIFI
-              Serial.printf("handleUploading: Filenames: %s %s\n", upload.filename.c_str(), c.c_str());
-              #endif
-    
-              // Remove path and some illegal characters
-              tempc = '/';
-              for(int i = 0; i < 2; i++) {
-                  if((temp = c.lastIndexOf(tempc)) >= 0) {
-                      if(c.length() - 1 > temp) {
-                          c = c.substring(temp);
-                      } else {
-                          c = "";
-                      }
-                      break;
-                  }
-                  tempc = '\\';
-              }
-              for(int i = 0; i < strlen(illChrs); i++) {
-                  c.replace(illChrs[i], '_');
-              }
-              if(!c.indexOf("..")) {
-                  c.replace("..", "");
-              }
-    
-              #ifdef TC_DBG_WIFI
-              Serial.printf("handleUploading: Filename after sanitation: %s\n", c.c_str());
+              Serial.printf("handleUploading: Filenames: %s %s\n", upload.filename.c_str(), c);
               #endif
     
               if(!numUploads) {
@@ -2856,13 +2906,17 @@ static void handleUploading()
 
         if(numUploads < MAX_SIM_UPLOADS) {
 
-            doCloseACFile(numUploads, false);
-    
-            if(opType[numUploads] >= 0) {
+            if(!doCloseACFile(numUploads, false)) {
+                removeACFile(numUploads);
+                ACULerr[numUploads] = UPL_WRERR;
+            } else if(opType[numUploads] >= 0 && !ACULerr[numUploads]) {
                 renameUploadFile(numUploads);
             }
     
             numUploads++;
+            #ifdef TC_DBG_WIFI
+            fileDone = true;
+            #endif
 
         }
       
@@ -2880,6 +2934,16 @@ static void handleUploading()
 
     }
 
+    #ifdef TC_DBG_WIFI
+    if(fileDone) {
+        unsigned long el = millis() - uplStart;
+        Serial.printf("Upload: %s: %u bytes in %lums (%u bytes/s)\n",
+            getUploadFileName(numUploads - 1) ? getUploadFileName(numUploads - 1) : "",
+            (unsigned int)upload.totalSize, el,
+            el ? (unsigned int)(((uint64_t)upload.totalSize * 1000) / el) : 0);
+    }
+    #endif
+
     delay(0);
 }
 
@@ -2911,7 +2975,11 @@ static void handleUploadDone()
         if(opType[i] > 0) {
             haveAC = true;
             if(!ACULerr[i]) {
-                if(!check_if_default_audio_present()) {
+                bool packOK = checkUploadedPack();
+                #ifdef TC_DBG_WIFI
+                Serial.printf("handleUploadDone: Sound pack %s\n", packOK ? "valid" : "invalid");
+                #endif
+                if(!packOK) {
                     haveAC = false;
                     ACULerr[i] = UPL_BADERR;
                     removeACFile(i);
@@ -3003,8 +3071,14 @@ static void handleUploadDone()
 
     freeUploadFileNames();
     
-    String str(buf);
-    wm.server->send(200, "text/html", str);
+    // Send from buf directly, no String copy
+    wm.server->send_P(200, "text/html", buf, strlen(buf));
+
+    // The whole multipart upload is handled within one wm.process()
+    // call, so the main loop has been stalled since it entered it
+    #ifdef TC_DBG_WIFI
+    Serial.printf("Upload: Main loop blocked for %lums\n", millis() - wmProcNow);
+    #endif
 
     // Reboot required even for mp3 upload, because for most files, we check
     // during boot if they exist (to avoid repeatedly failing open() calls)
@@ -3064,6 +3138,74 @@ void wifi_getMAC(char *buf)
     sprintf(buf, "%02x%02x%02x%02x%02x%02x", myMac[0], myMac[1], myMac[2], myMac[3], myMac[4], myMac[5]); 
 }
 
+void wifi_getHeapStats(uint32_t& minFree, uint32_t& minMaxBlock)
+{
+    minFree = cpMinFreeHeap;
+    minMaxBlock = cpMinMaxBlock;
+}
+
+/*
+ * Bounded string builder
+ */
+static void sbInit(strBld& sb, char *buf, int size)
+{
+    sb.buf = buf;
+    sb.size = size;
+    sb.len = 0;
+    buf[0] = 0;
+}
+
+// Returns false if output was truncated
+static bool sbPrintf(strBld& sb, const char *fmt, ...)
+{
+    va_list args;
+    int l;
+
+    va_start(args, fmt);
+    l = vsnprintf(sb.buf + sb.len, sb.size - sb.len, fmt, args);
+    va_end(args);
+
+    if(l < 0 || l >= sb.size - sb.len) {
+        sb.len = sb.size - 1;
+        return false;
+    }
+    sb.len += l;
+    
+    return true;
+}
+
+/*
+ * Sanitize upload file name into bounded buffer:
+ * Convert to lower case, remove path, replace some
+ * illegal characters, remove ".." if name starts 
+ * with it.
+ */
+static void sanitizeUploadName(const char *src, char *dst, int dstSize)
+{
+    const char *illChrs = "|~><:*?\" ";
+    const char *t;
+    bool noDots;
+    int j = 0;
+    char c;
+
+    if((t = strrchr(src, '/')) || (t = strrchr(src, '\\'))) {
+        src = t + 1;
+    }
+
+    noDots = (src[0] == '.' && src[1] == '.');
+    
+    while(*src && j < dstSize - 1) {
+        if(noDots && src[0] == '.' && src[1] == '.') {
+            src += 2;
+            continue;
+        }
+        c = tolower(*src++);
+        if(strchr(illChrs, c)) c = '_';
+        dst[j++] = c;
+    }
+    dst[j] = 0;
+}
+
 // Check if String is a valid IP address
 static bool isIp(char *str)
 {
@@ -3313,14 +3455,83 @@ static void handleMQTTTopMsg(int idx)
     }
 }
 
+#ifdef TC_MQTT_TASK
+#define MQTT_AUDIO_LOOP()
+#else
+#define MQTT_AUDIO_LOOP() audio_loop()
+#endif
+
+static void mqttService()
+{
+    if(mqttClient.state() != MQTT_CONNECTING) {
+        if(!mqttClient.connected()) {
+            if(mqttOldState || mqttRestartPing) {
+                // Disconnection first detected:
+                mqttPingDone = mqttDoPing ? false : true;
+                mqttPingNow = mqttRestartPing ? millisNonZero() : 0;
+                mqttOldState = false;
+                mqttRestartPing = false;
+                mqttSubAttempted = false;
+            }
+            if(mqttDoPing && !mqttPingDone) {
+                MQTT_AUDIO_LOOP();
+                mqttPing();
+                MQTT_AUDIO_LOOP();
+            }
+            if(mqttPingDone) {
+                MQTT_AUDIO_LOOP();
+                mqttReconnect();
+                MQTT_AUDIO_LOOP();
+            }
+        } else {
+            // Only call Subscribe() if connected
+            mqttSubscribe();
+            mqttOldState = true;
+            mqttInitialConnectNow = 0;
+        }
+    }
+    mqttClient.loop();
+}
+
+#ifdef TC_MQTT_TASK
+/*
+ * mqttTask()
+ * 
+ * Runs on core 0; connection handling (ping, connect, 
+ * reconnect) can block for seconds without affecting
+ * the main loop.
+ * Must not touch any displays, audio or time keeping.
+ */
+static void mqttTask(void *param)
+{
+    mqttPubMsg msg;
+    
+    while(1) {
+        mqttService();
+        while(xQueueReceive(mqttPubQueue, &msg, 0) == pdTRUE) {
+            if(mqttClient.connected()) {
+                mqttClient.publish(msg.topic, (uint8_t *)msg.pl, msg.len, false);
+            }
+        }
+        mqttClient.connected();     // Updates state if connection lost
+        mqttCachedState.store(mqttClient.state(), std::memory_order_release);
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+}
+#endif
+
 static void mqttLooper()
 {
+    // With TC_MQTT_TASK, we are called from mqttTask,
+    // and the main loop keeps running anyway.
+    #ifndef TC_MQTT_TASK
     ntp_loop();
     audio_loop();
     #if defined(TC_HAVEGPS) || defined(TC_HAVE_RE) || defined(TC_HAVE_REMOTE)
     // We are running in sync with loops => speedoUpdate_loop(false)
     speedoUpdate_loop(false);   // does not call any other loops
     #endif
+    #endif
 }
 
 static void receiveMQTTMsg(int idx, uint32_t dmask, char *tempBuf)
@@ -3417,109 +3628,40 @@ static void mqttCallback(char *topic, byte *payload, unsigned int length)
         if((csf & (CSF_AL|CSF_AE)) && (!(k & 0x40)))
             return;
 
-        switch(i) {
-        case 0:
-            eef |= (EEF_EttPressed|EEF_EttImmediate);
-            break;
-        case 1:
-            eef |= EEF_EttHeld;
-            break;
-        case 2:
-            alarmOn();
-            break;
-        case 3:
-            alarmOff();
-            break;
-        case 4:
-            nightModeOn();
-            manualNightMode = 1;
-            manualNMNow = millis();
-            break;
-        case 5:
-            nightModeOff();
-            manualNightMode = 0;
-            manualNMNow = millis();
-            break;
-        case 6:
-        case 7:
-            mp_makeShuffle((i == 6));
-            break;
-        case 8:    
-            if(haveMusic) mp_play();
-            break;
-        case 9:
-            if(haveMusic) mp_stop();
-            break;
-        case 10:
-            if(haveMusic) mp_next(mpActive);
-            break;
-        case 11:
-            if(haveMusic) mp_prev(mpActive);
-            break;
-        case 12:
-        case 13:
-        case 14:
-        case 15:
-            setBeepMode(i-12);
-            break;
-        case 16:
-            if(tempBufLen > j && tempBuf[j] >= '1' && tempBuf[j] <= '9') {
-                play_key((int)(tempBuf[j] - '0'), 0xffff);
-            }
-            break;
-        case 17:
-            stop_key();
-            break;
-        case 18:
-            if(tempBufLen > j) {
-                injectInput(&tempBuf[j]);
-            }
-            break;
-        case 19:
-        case 20:
-            // We don't differ between door 1 and door 2 here;
-            // allow panning through door 1.
-            doorSnd = (i == 20) ? -1 : 1;
-            doorFlags = PA_DOOR;
-            if(tempBufLen > j+1 && tempBuf[j] == '_') {
-                if(tempBuf[j+1] == 'L')      doorFlags |= PA_DOORL;
-                else if(tempBuf[j+1] == 'R') doorFlags |= PA_DOORR;
-            }
-            doorSndNow = millis();
-            doorSndDelay = 0;
-            break;
-        case 21:
-            mqttFakePowerOn();
-            break;
-        case 22:
-            mqttFakePowerOff();
-            break;
-        case 23:
-        case 24:
-            mqttFakePowerControl(i == 23);
-            break;
-        case 25:
-            if((!(csf & CSF_AE)) && snoozeRunning()) {
-                cancelSnooze();
-            }
-            // Fall through
-        case 26:
-            if((!(csf & CSF_AE)) && (csf & CSF_AL)) {
-                stopAlarm(true);
-                if(i == 25) {
-                    cancelSnooze();
-                } else {
-                    startSnooze();
-                }
+        // Commands are executed from the main loop, where the 
+        // state checks are repeated.
+        evbEvent ev;
+        int n = 0;
+        ev.type = EVB_MQTT_CMD;
+        ev.a = i;
+        ev.b = k;
+        for(int l = j; l < tempBufLen && n < EVB_DATA_LEN - 1; l++) {
+            // INJECT_: Only digits are of interest
+            if(i != 18 || (tempBuf[l] >= '0' && tempBuf[l] <= '9')) {
+                ev.data[n++] = tempBuf[l];
             }
-            break;
         }
+        ev.data[n] = 0;
+
+        evb_post(&ev);
             
     } else {
 
         memcpy(tempBuf, (const char *)payload, ml);
         tempBuf[ml] = 0;
 
+        #ifdef TC_MQTT_TASK
+        // Hand over to main loop; if the previous message was
+        // not picked up yet, the new one is dropped.
+        i = -1;
+        if(*settings.mqttTopic && (!strcmp(topic, settings.mqttTopic)))        i = 0;
+        else if(*settings.mqttTopicP && (!strcmp(topic, settings.mqttTopicP))) i = 1;
+        else if(*settings.mqttTopicL && (!strcmp(topic, settings.mqttTopicL))) i = 2;
+        if(i >= 0 && mqttRecvMsg[i] && !mqttRecvPending[i].load(std::memory_order_acquire)) {
+            memcpy(mqttRecvMsg[i], tempBuf, ml + 1);
+            mqttRecvPending[i].store(true, std::memory_order_release);
+        }
+        #else
         if(*settings.mqttTopic && (!strcmp(topic, settings.mqttTopic))) {
 
             receiveMQTTMsg(0, MQ_DISP_D, tempBuf);
@@ -3533,6 +3675,124 @@ static void mqttCallback(char *topic, byte *payload, unsigned int length)
             receiveMQTTMsg(2, MQ_DISP_L, tempBuf);
 
         }
+        #endif
+    }
+}
+
+/*
+ * mqttEvalEvent()
+ * 
+ * Execute an MQTT command; called through the event bus
+ * from the main loop.
+ */
+void mqttEvalEvent(evbEvent *ev)
+{
+    // Not taking commands under these circumstances:
+    if(csf & (CSF_MA|CSF_ST|CSF_P0|CSF_P1|CSF_RE))
+        return;
+
+    if((csf & CSF_OFF) && (!(ev->b & 0x80)))
+        return;
+
+    if((csf & (CSF_AL|CSF_AE)) && (!(ev->b & 0x40)))
+        return;
+
+    switch(ev->a) {
+    case 0:
+        eef |= (EEF_EttPressed|EEF_EttImmediate);
+        break;
+    case 1:
+        eef |= EEF_EttHeld;
+        break;
+    case 2:
+        alarmOn();
+        break;
+    case 3:
+        alarmOff();
+        break;
+    case 4:
+        nightModeOn();
+        manualNightMode = 1;
+        sched_at(SCH_MANNM, MANNM_DUR);
+        break;
+    case 5:
+        nightModeOff();
+        manualNightMode = 0;
+        sched_at(SCH_MANNM, MANNM_DUR);
+        break;
+    case 6:
+    case 7:
+        mp_makeShuffle((ev->a == 6));
+        break;
+    case 8:    
+        if(haveMusic) mp_play();
+        break;
+    case 9:
+        if(haveMusic) mp_stop();
+        break;
+    case 10:
+        if(haveMusic) mp_next(mpActive);
+        break;
+    case 11:
+        if(haveMusic) mp_prev(mpActive);
+        break;
+    case 12:
+    case 13:
+    case 14:
+    case 15:
+        setBeepMode(ev->a - 12);
+        break;
+    case 16:
+        if(ev->data[0] >= '1' && ev->data[0] <= '9') {
+            play_key((int)(ev->data[0] - '0'), 0xffff);
+        }
+        break;
+    case 17:
+        stop_key();
+        break;
+    case 18:
+        if(*ev->data) {
+            injectInput(ev->data);
+        }
+        break;
+    case 19:
+    case 20:
+        // We don't differ between door 1 and door 2 here;
+        // allow panning through door 1.
+        doorSnd = (ev->a == 20) ? -1 : 1;
+        doorFlags = PA_DOOR;
+        if(ev->data[0] == '_') {
+            if(ev->data[1] == 'L')      doorFlags |= PA_DOORL;
+            else if(ev->data[1] == 'R') doorFlags |= PA_DOORR;
+        }
+        doorSndNow = millis();
+        doorSndDelay = 0;
+        break;
+    case 21:
+        mqttFakePowerOn();
+        break;
+    case 22:
+        mqttFakePowerOff();
+        break;
+    case 23:
+    case 24:
+        mqttFakePowerControl(ev->a == 23);
+        break;
+    case 25:
+        if((!(csf & CSF_AE)) && snoozeRunning()) {
+            cancelSnooze();
+        }
+        // Fall through
+    case 26:
+        if((!(csf & CSF_AE)) && (csf & CSF_AL)) {
+            stopAlarm(true);
+            if(ev->a == 25) {
+                cancelSnooze();
+            } else {
+                startSnooze();
+            }
+        }
+        break;
     }
 }
 
@@ -3658,13 +3918,27 @@ static void mqttSubscribe()
 
 bool mqttState()
 {
+    #ifdef TC_MQTT_TASK
+    return (useMQTT && (mqttCachedState.load(std::memory_order_acquire) == MQTT_CONNECTED));
+    #else
     return (useMQTT && mqttClient.connected());
+    #endif
 }
 
 void mqttPublish(const char *topic, const char *pl, unsigned int len)
 {
     if(useMQTT) {
+        #ifdef TC_MQTT_TASK
+        mqttPubMsg msg;
+        if(len > MQTT_PUB_PLEN) len = MQTT_PUB_PLEN;
+        strncpy(msg.topic, topic, MQTT_PUB_TLEN - 1);
+        msg.topic[MQTT_PUB_TLEN - 1] = 0;
+        memcpy(msg.pl, pl, len);
+        msg.len = len;
+        xQueueSend(mqttPubQueue, &msg, 0);
+        #else
         mqttClient.publish(topic, (uint8_t *)pl, len, false);
+        #endif
     }
 }
 
@@ -58,23 +58,23 @@
 #include "tc_global.h"
 
 #include <Arduino.h>
-#include <Wire.h>
+#include "tc_i2c.h"
 
 #include "tcddisplay.h"
-#include "tc_font.h"
+#include "tc_segrender.h"
 
-#define CD_MONTH_POS  0
 #ifdef IS_ACAR_DISPLAY      // A-Car (2-digit-month) ---------------------
-#define CD_MONTH_SIZE 1     //      number of words
-#define CD_MONTH_DIGS 2     //      number of digits/letters
+typedef segRender<2> tcdSeg;
 #else                       // All others (3-char month) -----------------
-#define CD_MONTH_SIZE 3     //      number of words
-#define CD_MONTH_DIGS 3     //      number of digits/letters
+typedef segRender<3> tcdSeg;
 #endif                      // -------------------------------------------
-#define CD_DAY_POS    3
-#define CD_YEAR_POS   4
-#define CD_HOUR_POS   6
-#define CD_MIN_POS    7
+#define CD_MONTH_POS  tcdSeg::monthPos
+#define CD_MONTH_SIZE tcdSeg::monthSize     // number of words
+#define CD_MONTH_DIGS tcdSeg::monthDigs     // number of digits/letters
+#define CD_DAY_POS    tcdSeg::dayPos
+#define CD_YEAR_POS   tcdSeg::yearPos
+#define CD_HOUR_POS   tcdSeg::hourPos
+#define CD_MIN_POS    tcdSeg::minPos
 
 #define CD_AMPM_POS   CD_DAY_POS
 #define CD_COLON_POS  CD_YEAR_POS
@@ -144,6 +144,8 @@ tcdDisplay::tcdDisplay(unsigned int did, uint8_t address)
 void tcdDisplay::begin()
 {
     _rtc = (_did == DISP_PRES);
+
+    i2c_setDevice(_address, I2CP_DISPLAY, true);
     
     directCmd(0x20 | 1); // turn on oscillator
 
@@ -373,14 +375,7 @@ void tcdDisplay::setMonth(int monthNum)
 
     _month = monthNum;
 
-#ifdef IS_ACAR_DISPLAY
-    _displayBuffer[CD_MONTH_POS] = makeNum(monthNum);
-#else
-    monthNum--;
-    _displayBuffer[CD_MONTH_POS]     = getLEDAlphaChar(months[monthNum][0]);
-    _displayBuffer[CD_MONTH_POS + 1] = getLEDAlphaChar(months[monthNum][1]);
-    _displayBuffer[CD_MONTH_POS + 2] = getLEDAlphaChar(months[monthNum][2]);
-#endif
+    tcdSeg::month(_displayBuffer, monthNum);
 }
 
 void tcdDisplay::setDay(int dayNum)
@@ -413,8 +408,8 @@ void tcdDisplay::setYear(uint16_t yearNum)
     while(yearNum >= 10000)
         yearNum -= 10000;
 
-    _displayBuffer[CD_YEAR_POS]     = makeNum(yearNum / 100);
-    _displayBuffer[CD_YEAR_POS + 1] = makeNum(yearNum % 100) | seg;
+    tcdSeg::year(_displayBuffer, yearNum);
+    _displayBuffer[CD_YEAR_POS + 1] |= seg;
 }
 
 void tcdDisplay::setHour(uint16_t hourNum)
@@ -513,16 +508,9 @@ void tcdDisplay::showMonthDirect(int monthNum, uint16_t dflags)
         monthNum = 12;
 
 #ifdef IS_ACAR_DISPLAY
-    db[CD_MONTH_POS] = makeNum(monthNum, dflags);
+    tcdSeg::month(db, monthNum, (dflags & CDD_NOLEAD0));
 #else
-    if(monthNum > 0) {
-        monthNum--;
-    } else {
-        monthNum = 12;
-    }
-    db[CD_MONTH_POS]     = getLEDAlphaChar(months[monthNum][0]);
-    db[CD_MONTH_POS + 1] = getLEDAlphaChar(months[monthNum][1]);
-    db[CD_MONTH_POS + 2] = getLEDAlphaChar(months[monthNum][2]);
+    tcdSeg::month(db, (monthNum > 0) ? monthNum : 0);
 #endif
     directBuf(db);
 }
@@ -842,86 +830,18 @@ bool tcdDisplay::save(bool force)
 // Returns bit pattern for provided character for display on 7 segment display
 uint8_t tcdDisplay::getLED7AlphaChar(uint8_t value)
 {
-    if(value < 32 || value >= 127 + 4)
-        return 0;
-    
-    // For text, use common "6" pattern if requested
-    if(value == '6') return numDigs['6' - 32] | _corr6;
-    
-    return numDigs[value - 32];
-}
-
-// Returns bit pattern for provided character for display on 14 segment display
-#ifndef IS_ACAR_DISPLAY
-uint16_t tcdDisplay::getLEDAlphaChar(uint8_t value)
-{
-    if(value < 32 || value >= 127 + 4)
-        return 0;
-
-    // For text, use common "6" pattern if requested
-    if(value == '6') return alphaChars['6' - 32] | _corr6;
-
-    return alphaChars[value - 32];
+    return tcdSeg::char7(value);
 }
-#endif
 
 // Make a 2 digit number from num and return the segment data
 uint16_t tcdDisplay::makeNum(unsigned int num, uint16_t dflags)
 {
-    // Each position holds two digits
-    // MSB = 1s, LSB = 10s
-
-    uint16_t segments = 0;
-    unsigned int num2 = num / 10;
-    
-    num -= (num2 * 10);
-
-    if(num2 || !(dflags & CDD_NOLEAD0)) {
-        segments = numDigs[num2 + '0' - 32];   
-    }
-
-    return (segments | (numDigs[num + '0' - 32] << 8));
+    return tcdSeg::num(num, (dflags & CDD_NOLEAD0));
 }
 
 int tcdDisplay::textToSegments(uint16_t *segBuf, const char *text, uint16_t flags)
 {  
-    int idx = 0, pos = CD_MONTH_POS;
-    int temp = 0;
-
-    _corr6 = flags & CDT_CORR6;
-
-#ifdef IS_ACAR_DISPLAY
-    while(text[idx] && pos < (CD_MONTH_POS+CD_MONTH_SIZE)) {
-        temp = getLED7AlphaChar(text[idx++]);
-        if(text[idx]) {
-            temp |= (getLED7AlphaChar(text[idx++]) << 8);
-        }
-        segBuf[pos++] = temp;
-    }
-#else
-    while(text[idx] && pos < (CD_MONTH_POS+CD_MONTH_SIZE)) {
-        segBuf[pos++] = getLEDAlphaChar(text[idx++]);
-    }
-#endif
-
-    while(pos < CD_DAY_POS) {
-        segBuf[pos++] = 0;
-    }
-    
-    pos = CD_DAY_POS;
-    while(text[idx] && pos <= CD_MIN_POS) {
-        temp = getLED7AlphaChar(text[idx++]);
-        if(text[idx]) {
-            temp |= (getLED7AlphaChar(text[idx++]) << 8);
-        }
-        segBuf[pos++] = temp;
-    }
-
-    if(flags & CDT_CLEAR) {
-        while(pos <= CD_MIN_POS) {
-            segBuf[pos++] = 0;
-        }
-    }
+    int pos = tcdSeg::text(segBuf, text, (flags & CDT_CORR6), (flags & CDT_CLEAR));
 
     if(flags & CDT_YRDOT)
         segBuf[CD_YEAR_POS + 1] |= 0x8000;
@@ -929,8 +849,6 @@ int tcdDisplay::textToSegments(uint16_t *segBuf, const char *text, uint16_t flag
     if(flags & CDT_COLON)
         segBuf[CD_COLON_POS] |= 0x8080;
 
-    _corr6 = 0;
-
     return pos;
 }
 
@@ -1036,8 +954,11 @@ void tcdDisplay::showInt(bool animate, bool Alt)
 
 void tcdDisplay::showIntTail(bool animate)
 {
-    if(animate) directCmd(0x20 | 1);
-    if(animate || (_NmOff && (_oldnm > 0))) on();
+    if(animate) {
+        // Oscillator on + display on in one go
+        static const uint8_t cmds[2] = { 0x20 | 1, 0x80 | 1 };
+        i2c_cmdBatch(_address, cmds, 2);
+    } else if(_NmOff && (_oldnm > 0)) on();
 
     if(_NmOff) _oldnm = 0;
 }
@@ -1063,29 +984,19 @@ void tcdDisplay::clearDisplay()
 
 void tcdDisplay::directCmd(uint8_t val)
 {
-    Wire.beginTransmission(_address);
-    Wire.write(val);
-    Wire.endTransmission();
+    i2c_write(_address, &val, 1);
 }
 
 void tcdDisplay::directBuf(uint16_t *db, int len)
 {
-    Wire.beginTransmission(_address);
-    Wire.write(0x00);
-    for(int i = 0; i < len; i++) {
-        Wire.write(db[i] & 0xff);
-        Wire.write(db[i] >> 8);
-    }
-    Wire.endTransmission();
+    i2c_writeBuf16(_address, 0x00, db, len);
 }
 
 // Directly write to a column with supplied segments
 // (leave buffer intact, directly write to display)
 void tcdDisplay::directCol(int col, int segments)
 {
-    Wire.beginTransmission(_address);
-    Wire.write(col * 2);
-    Wire.write(segments & 0xff);
-    Wire.write(segments >> 8);
-    Wire.endTransmission();
+    uint16_t seg = segments;
+    
+    i2c_writeBuf16(_address, col * 2, &seg, 1);
 }
@@ -106,6 +106,7 @@ class tcdDisplay {
         void    resetBrightness();
         uint8_t setBrightnessDirect(uint8_t level);
         uint8_t getBrightness() { return _brightness; }
+        uint8_t getOrigBrightness() { return _origBrightness; }
 
         void set1224(bool hours24) { _mode24 = hours24; }
         bool get1224()             { return _mode24; }
@@ -194,9 +195,6 @@ class tcdDisplay {
     private:
 
         uint8_t  getLED7AlphaChar(uint8_t value);
-        #ifndef IS_ACAR_DISPLAY
-        uint16_t getLEDAlphaChar(uint8_t value);
-        #endif
 
         uint16_t makeNum(unsigned int num, uint16_t dflags = 0);
 
@@ -247,7 +245,6 @@ class tcdDisplay {
         bool    _nightmode = false;     // true = dest/dept times off
         bool    _NmOff = false;         // true = off during night mode, false = dimmed
         int     _oldnm = -1;
-        int     _corr6 = 0;
         bool    _WCtimeFits = false;
 
         int     _savePending = 0;
@@ -1729,9 +1729,11 @@
 #include "tc_global.h"
 
 #include <Arduino.h>
-#include <Wire.h>
 
+#include "tc_anim.h"
 #include "tc_audio.h"
+#include "tc_evbus.h"
+#include "tc_i2c.h"
 #include "tc_keypad.h"
 #include "tc_settings.h"
 #include "tc_time.h"
@@ -1743,11 +1745,7 @@ void setup()
     Serial.println();
 
     // I2C init
-    // Make sure our i2c buf is 128 bytes
-    Wire.setBufferSize(128);
-    // PCF8574 only supports 100kHz, can't go to 400 here.
-    // Also, speedo cable is usually quite long, play it safe.
-    Wire.begin(-1, -1, 100000);
+    i2c_setup();
 
     time_boot();
     settings_setup();
@@ -1769,10 +1767,14 @@ void loop()
     audio_loop();
     bttfn_loop(BNLP_SK_MC|BNLP_SK_NOTDATA|BNLP_SK_EXPIRE);
     audio_loop();
+    evb_loop();
     time_loop();
+    anim_loop();
     audio_loop();
     wifi_loop();
     audio_loop();
+    mp_renamer_loop();
+    fwupd_loop();
     bttfn_loop();
     bttfn_loop_ex();
     audio_loop();
@@ -0,0 +1,275 @@
+/*
+ * Host test for the time travel timing (tc_ttplan)
+ *
+ * Runs complete sequences on a simulated millis() clock, with the
+ * timers and the P0 speed count-up handled like time_loop() does,
+ * for all start speeds, curves, lead modes and several main loop
+ * timings. Checks when 88mph is reached, and when P1 and ETTO are
+ * triggered relative to it.
+ *
+ * Run with "pio test -e native".
+ */
+
+#include <stdio.h>
+#include <unity.h>
+
+#include "tc_ttplan.h"
+
+// Simulated main loop: Time between iterations, repeated
+static const unsigned long loopFast[]  = { 1 };
+static const unsigned long loopSlow[]  = { 20 };
+static const unsigned long loopStall[] = { 2, 3, 1, 2, 45, 1, 2, 130, 3 };
+
+static const unsigned long *loopGaps;
+static int                  loopGapsNum;
+static unsigned long        maxGap;
+
+static unsigned long now;
+static unsigned long millis() { return now; }
+
+static ttCurve crv;
+
+// Timeline of one sequence, in ms from the trigger; -1 = not seen
+typedef struct {
+    long t88;
+    long tP1;
+    long tETTO;
+    bool p1NoLead;
+    uint16_t netLeadTime;
+} ttResult;
+
+// Worst deviations seen, for the summary
+static long maxTrig88 = 0;
+static long maxEttoErr = 0;
+
+static void sim_loop_step(int *i)
+{
+    now += loopGaps[(*i)++ % loopGapsNum];
+}
+
+/*
+ * sim_p0()
+ *
+ * Trigger at now = 0 with a P0; then run the loop until 88mph.
+ */
+static void sim_p0(ttResult *r, int speed, bool preTT, bool fixedLead, bool netLead)
+{
+    ttPlan p;
+    int i = 0;
+    int p0Speed;
+    unsigned long p0Now, p0Delay, lastStep;
+    bool trigP1 = true, trigETTO;
+
+    now = 0;
+    r->t88 = r->tP1 = r->tETTO = -1;
+
+    TEST_ASSERT_TRUE(ttplan_p0(&crv, &p, speed, preTT, fixedLead, netLead));
+
+    trigETTO = p.trigETTO;
+    r->p1NoLead = p.p1NoLead;
+    r->netLeadTime = p.netLeadTime;
+    p0Speed = (speed >= 0) ? speed : 0;
+    p0Delay = p.p0Delay;
+    p0Now = lastStep = millis();
+
+    while(r->t88 < 0 || trigP1 || trigETTO) {
+
+        sim_loop_step(&i);
+        TEST_ASSERT_TRUE(now < 60000);
+
+        if(trigP1 && (millis() >= (unsigned long)p.p1LeadTime)) {
+            r->tP1 = millis();
+            trigP1 = false;
+        }
+        if(trigETTO && (millis() >= (unsigned long)p.ettoLeadTime)) {
+            r->tETTO = millis();
+            trigETTO = false;
+        }
+        if(r->t88 < 0 && (millis() - p0Now >= p0Delay)) {
+            long late = (long)(millis() - lastStep) - (long)p0Delay;
+            long d;
+            lastStep = millis();
+            p0Speed = ttplan_p0_step(&crv, p0Speed, late, &d);
+            if(p0Speed >= 88) {
+                r->t88 = millis();
+            } else {
+                p0Delay = d;
+                p0Now = millis();
+            }
+        }
+    }
+}
+
+/*
+ * sim_nop0()
+ *
+ * Trigger without P0 (ETTO/network clients only); "88" is the
+ * point in P1 where the time travel takes place.
+ */
+static void sim_nop0(ttResult *r, bool forceNoLead, bool fixedLead, bool preTT)
+{
+    ttPlan p;
+    int i = 0;
+    bool trigP1 = true, trigETTO = true;
+
+    now = 0;
+    r->t88 = r->tP1 = r->tETTO = -1;
+
+    ttplan_nop0(&p, forceNoLead, fixedLead, preTT);
+
+    r->p1NoLead = p.p1NoLead;
+    r->netLeadTime = p.netLeadTime;
+
+    while(trigP1 || trigETTO) {
+        sim_loop_step(&i);
+        TEST_ASSERT_TRUE(now < 60000);
+        if(trigP1 && (millis() >= (unsigned long)p.p1LeadTime)) {
+            r->tP1 = millis();
+            trigP1 = false;
+        }
+        if(trigETTO && (millis() >= (unsigned long)p.ettoLeadTime)) {
+            r->tETTO = millis();
+            trigETTO = false;
+        }
+    }
+
+    r->t88 = r->tP1 + (r->p1NoLead ? 0 : TT_P1_POINT88);
+}
+
+/*
+ * check_timeline()
+ *
+ * Common checks: P1 is started so that its 88mph point matches
+ * the speedo, and network clients are never told a longer lead
+ * than they actually get, nor more than ETTO_LAT less.
+ */
+static void check_timeline(const ttResult *r, bool withETTO)
+{
+    long p1_88 = r->p1NoLead ? 0 : TT_P1_POINT88;
+
+    TEST_ASSERT_TRUE(r->t88 >= 0);
+    TEST_ASSERT_TRUE(r->tP1 >= 0);
+
+    // P1 and speedo: Both timers run late by less than a loop gap
+    TEST_ASSERT_INT_WITHIN(maxGap, r->t88, r->tP1 + p1_88);
+
+    if(withETTO) {
+        long err = r->t88 - (r->tETTO + r->netLeadTime);
+        TEST_ASSERT_TRUE(r->tETTO >= 0);
+        TEST_ASSERT_TRUE(err >= -(long)maxGap);
+        TEST_ASSERT_TRUE(err <= ETTO_LAT + (long)maxGap);
+        if(err < 0) err = -err;
+        if(err > maxEttoErr) maxEttoErr = err;
+    } else {
+        TEST_ASSERT_EQUAL(-1, r->tETTO);
+    }
+}
+
+static void run_p0_all(const int16_t *delays, float factor)
+{
+    ttResult r;
+
+    ttplan_init(&crv, delays, factor);
+
+    for(int pre = 0; pre < 2; pre++) {
+        for(int lead = 0; lead < 3; lead++) {
+            bool fixedLead = (lead == 2);
+            bool netLead = (lead >= 1);
+            for(int speed = -1; speed < 88; speed++) {
+
+                sim_p0(&r, speed, pre, fixedLead, netLead);
+                check_timeline(&r, fixedLead || netLead);
+
+                // Trigger to 88: Remaining acceleration plus P0 delay
+                ttPlan p;
+                ttplan_p0(&crv, &p, speed, pre, fixedLead, netLead);
+                long ideal = p.p0Delay + crv.totDelays[87] - crv.totDelays[speed >= 0 ? speed : 0];
+                TEST_ASSERT_INT_WITHIN(maxGap, ideal, r.t88);
+                TEST_ASSERT_TRUE(r.t88 >= ideal);
+                if(r.t88 > maxTrig88) maxTrig88 = r.t88;
+
+                // Fixed lead: ETTO props always get their full lead
+                // (less the ETTO timer running late by a loop gap)
+                if(fixedLead) {
+                    TEST_ASSERT_TRUE(r.t88 - r.tETTO + (long)maxGap >= ETTO_LEAD_TIME - ETTO_LAT);
+                    TEST_ASSERT_EQUAL(ETTO_LEAD_TIME - ETTO_LAT, r.netLeadTime);
+                }
+            }
+        }
+    }
+}
+
+static void test_p0(void)
+{
+    run_p0_all(tt_p0_delays_movie, 1.0f);
+    run_p0_all(tt_p0_delays_rl, 0.5f);
+    run_p0_all(tt_p0_delays_rl, 1.0f);
+    run_p0_all(tt_p0_delays_rl, 2.5f);
+    run_p0_all(tt_p0_delays_rl, 5.0f);
+}
+
+static void test_nop0(void)
+{
+    ttResult r;
+
+    for(int m = 0; m < 8; m++) {
+        bool forceNoLead = m & 1, fixedLead = m & 2, preTT = m & 4;
+        sim_nop0(&r, forceNoLead, fixedLead, preTT);
+        check_timeline(&r, true);
+        if(fixedLead) {
+            TEST_ASSERT_TRUE(r.t88 - r.tETTO + (long)maxGap >= ETTO_LEAD_TIME - ETTO_LAT);
+        }
+    }
+}
+
+static void test_p0_catchup(void)
+{
+    long d;
+
+    ttplan_init(&crv, tt_p0_delays_movie, 1.0f);
+
+    // On time: One mph, full delay of the next step
+    TEST_ASSERT_EQUAL(11, ttplan_p0_step(&crv, 10, 0, &d));
+    TEST_ASSERT_EQUAL(tt_p0_delays_movie[11], d);
+
+    // Late by more than the next two steps: Skip them
+    TEST_ASSERT_EQUAL(13, ttplan_p0_step(&crv, 10, 110 + 115, &d));
+    TEST_ASSERT_EQUAL(120, d);
+
+    // Late near the end: Stops at 88
+    TEST_ASSERT_EQUAL(88, ttplan_p0_step(&crv, 85, 5000, &d));
+    TEST_ASSERT_EQUAL(88, ttplan_p0_step(&crv, 87, 0, &d));
+}
+
+static void run_with(const unsigned long *gaps, int num, const char *name)
+{
+    char buf[128];
+
+    loopGaps = gaps;
+    loopGapsNum = num;
+    maxGap = 0;
+    for(int i = 0; i < num; i++) {
+        if(gaps[i] > maxGap) maxGap = gaps[i];
+    }
+    maxTrig88 = maxEttoErr = 0;
+
+    RUN_TEST(test_p0);
+    RUN_TEST(test_nop0);
+
+    snprintf(buf, sizeof(buf), "%s loop: longest trigger to 88mph %ldms, max ETTO lead error %ldms",
+        name, maxTrig88, maxEttoErr);
+    TEST_MESSAGE(buf);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_p0_catchup);
+
+    run_with(loopFast, sizeof(loopFast) / sizeof(loopFast[0]), "1ms");
+    run_with(loopSlow, sizeof(loopSlow) / sizeof(loopSlow[0]), "20ms");
+    run_with(loopStall, sizeof(loopStall) / sizeof(loopStall[0]), "stalling");
+
+    return UNITY_END();
+}
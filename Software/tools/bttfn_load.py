@@ -0,0 +1,296 @@
+#!/usr/bin/env python3
+"""
+BTTFN load generator
+
+Emulates 1..N BTTFN clients (FluxCap, SID, Dash, VSR, Aux, Remote)
+polling a real Time Circuits Display over the network and reports reply
+latency and packet loss per client count. Emulated remotes only poll,
+they never send commands.
+
+With --max-loss and/or --max-p95, every client count is checked against
+these limits and the exit status is 1 if any of them is exceeded, so the
+tool can be used as a pass/fail test. Compare the result with the TCD's
+own counters (TC_BTTFN_BENCH, printed on the serial console) to tell
+network loss from packets the TCD dropped or did not get around to.
+
+The TCD answers every request on UDP port 1338 of the sender's IP, and
+it keys its client list by IP address. To have the TCD see N distinct
+clients, give one local address per client with --bind (eg. aliases
+added with "ip addr add"). With fewer addresses, clients share them,
+and the TCD counts each address as one client.
+
+No other BTTFN client (eg. a second TCD or a FluxCap simulator) may
+run on this host, since port 1338 is needed for the replies.
+
+Usage examples:
+  bttfn_load.py 192.168.4.1
+  bttfn_load.py 192.168.1.50 --clients 1,2,4,6 --rate 20 --duration 20 \\
+      --bind 192.168.1.201,192.168.1.202,192.168.1.203,192.168.1.204,192.168.1.205,192.168.1.206
+  bttfn_load.py --mc timecircuits --clients 1,6
+  bttfn_load.py 192.168.4.1 --clients 6 --max-loss 1 --max-p95 50
+  bttfn_load.py --selftest
+
+With --mc HOSTNAME, requests are sent as multicast "discover" packets
+(224.0.0.224:1339) carrying the hash of the TCD's hostname, which
+exercises the TCD's multicast socket instead of its unicast socket.
+
+--selftest runs the tool against a minimal TCD stand-in on the loopback
+interface (127.0.0.1, clients on 127.0.0.2..7) and checks that all
+requests are answered. This tests the tool itself, not the firmware.
+
+Only the Python 3 standard library is needed.
+"""
+
+import argparse
+import select
+import socket
+import struct
+import sys
+import threading
+import time
+
+BTTF_PACKET_SIZE = 48
+BTTF_PORT        = 1338
+BTTF_MC_IP       = "224.0.0.224"
+BTTFN_VERSION    = 1
+
+# Request bits in byte 5
+REQ_DATETIME     = 0x01
+REQ_TEMP         = 0x04
+REQ_LUX          = 0x08
+REQ_STATUS       = 0x10
+REQ_DISCOVER     = 0x80
+
+CLIENT_TYPES     = (1, 2, 3, 4, 5, 6) # FLUX, SID, PCG, VSR, AUX, REMOTE
+
+
+def checksum(buf):
+    a = 0
+    for b in buf[4:BTTF_PACKET_SIZE - 1]:
+        a = (a + (b ^ 0x55)) & 0xff
+    return a
+
+
+def hostname_hash(name):
+    h = 0
+    for c in name.lower().encode():
+        h = (37 * h + c) & 0xffffffff
+    return h
+
+
+def build_request(serial, client, hhash=None):
+    buf = bytearray(BTTF_PACKET_SIZE)
+    buf[0:4] = b"BTTF"
+    buf[4] = BTTFN_VERSION
+    buf[5] = REQ_DATETIME | REQ_TEMP | REQ_LUX | REQ_STATUS
+    struct.pack_into("<I", buf, 6, serial)
+    cid = ("LOAD%02d" % client).encode()
+    buf[10:10 + len(cid)] = cid
+    buf[10 + 13] = CLIENT_TYPES[client % len(CLIENT_TYPES)]
+    if hhash is not None:
+        buf[5] |= REQ_DISCOVER
+        struct.pack_into("<I", buf, 31, hhash)
+    buf[BTTF_PACKET_SIZE - 1] = checksum(buf)
+    return bytes(buf)
+
+
+def is_reply(buf):
+    return (len(buf) == BTTF_PACKET_SIZE and
+            buf[0:4] == b"BTTF" and
+            (buf[4] & 0x80) and
+            checksum(buf) == buf[BTTF_PACKET_SIZE - 1])
+
+
+def fake_tcd(stop, seen, ip="127.0.0.1"):
+    # Answers every valid request like the TCD does: Reply to port 1338
+    # of the sender, request serial echoed at 6..9
+    s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    s.bind((ip, BTTF_PORT))
+    s.settimeout(0.05)
+    while not stop.is_set():
+        try:
+            data, addr = s.recvfrom(512)
+        except socket.timeout:
+            continue
+        if (len(data) != BTTF_PACKET_SIZE or data[0:4] != b"BTTF" or
+            checksum(data) != data[BTTF_PACKET_SIZE - 1]):
+            continue
+        seen.add((addr[0], data[10 + 13]))
+        buf = bytearray(BTTF_PACKET_SIZE)
+        buf[0:4] = b"BTTF"
+        buf[4] = BTTFN_VERSION | 0x80
+        buf[6:10] = data[6:10]
+        buf[BTTF_PACKET_SIZE - 1] = checksum(buf)
+        s.sendto(bytes(buf), (addr[0], BTTF_PORT))
+    s.close()
+
+
+def percentile(vals, p):
+    if not vals:
+        return float("nan")
+    vals = sorted(vals)
+    k = min(len(vals) - 1, int(round((p / 100.0) * (len(vals) - 1))))
+    return vals[k]
+
+
+def run(args, nclients, binds, serial0):
+    socks = []
+    for ip in binds[:nclients]:
+        s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        s.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        s.bind((ip, BTTF_PORT))
+        s.setblocking(False)
+        if args.mc:
+            s.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 1)
+            if ip:
+                s.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_IF,
+                             socket.inet_aton(ip))
+        socks.append(s)
+
+    hhash = hostname_hash(args.mc) if args.mc else None
+    dest = (BTTF_MC_IP, BTTF_PORT + 1) if args.mc else (args.device, BTTF_PORT)
+
+    pending = {}        # serial -> (client, send time)
+    lat = [[] for _ in range(nclients)]
+    sent = [0] * nclients
+    late = 0
+    serial = serial0
+    period = 1.0 / args.rate
+    nextSend = [time.monotonic() + (i * period / nclients) for i in range(nclients)]
+    end = time.monotonic() + args.duration
+
+    while True:
+        now = time.monotonic()
+        if now >= end + args.timeout:
+            break
+
+        if now < end:
+            for c in range(nclients):
+                if now >= nextSend[c]:
+                    serial = (serial + 1) & 0xffffffff
+                    try:
+                        socks[c % len(socks)].sendto(build_request(serial, c, hhash), dest)
+                        pending[serial] = (c, now)
+                        sent[c] += 1
+                    except OSError:
+                        pass
+                    nextSend[c] += period
+
+        wait = min(nextSend) - time.monotonic() if now < end else 0.01
+        r, _, _ = select.select(socks, [], [], max(0.0, min(wait, 0.01)))
+        for s in r:
+            while True:
+                try:
+                    data, _ = s.recvfrom(512)
+                except (BlockingIOError, OSError):
+                    break
+                if not is_reply(data):
+                    continue    # notification or garbage
+                rs = struct.unpack_from("<I", data, 6)[0]
+                p = pending.pop(rs, None)
+                if p is None:
+                    continue
+                dt = time.monotonic() - p[1]
+                if dt > args.timeout:
+                    late += 1
+                    continue
+                lat[p[0]].append(dt * 1000.0)
+
+    for s in socks:
+        s.close()
+
+    return sent, lat, late, serial
+
+
+def main():
+    ap = argparse.ArgumentParser(description="BTTFN load generator for the Time Circuits Display")
+    ap.add_argument("device", nargs="?", help="IP address of the TCD (unicast mode)")
+    ap.add_argument("--mc", metavar="HOSTNAME", help="send multicast discover requests for this TCD hostname")
+    ap.add_argument("--clients", default="1,2,3,4,5,6", help="comma separated client counts (default 1..6)")
+    ap.add_argument("--rate", type=float, default=10.0, help="requests/s per client (default 10)")
+    ap.add_argument("--duration", type=float, default=10.0, help="seconds per client count (default 10)")
+    ap.add_argument("--timeout", type=float, default=1.0, help="reply timeout in seconds (default 1)")
+    ap.add_argument("--bind", default="", help="comma separated local IPs, one per client")
+    ap.add_argument("--max-loss", type=float, help="fail if loss exceeds this many percent")
+    ap.add_argument("--max-p95", type=float, help="fail if p95 latency exceeds this many ms")
+    ap.add_argument("--selftest", action="store_true", help="run against a stand-in TCD on loopback")
+    args = ap.parse_args()
+
+    fake = None
+    if args.selftest:
+        if args.device or args.mc:
+            ap.error("--selftest takes no device IP or --mc")
+        args.device = "127.0.0.1"
+        args.bind = ",".join("127.0.0.%d" % (i + 2) for i in range(6))
+        args.duration = min(args.duration, 2.0)
+        if args.max_loss is None:
+            args.max_loss = 0.0
+        stop = threading.Event()
+        seen = set()
+        fake = threading.Thread(target=fake_tcd, args=(stop, seen))
+        fake.start()
+        time.sleep(0.1)
+    elif not args.device and not args.mc:
+        ap.error("need device IP or --mc HOSTNAME")
+
+    counts = [int(x) for x in args.clients.split(",") if x.strip()]
+    binds = [x.strip() for x in args.bind.split(",") if x.strip()] or [""]
+    maxc = max(counts)
+    if len(binds) < maxc:
+        if len(binds) > 1 or binds[0]:
+            print("Note: %d local address(es) for up to %d clients; the TCD sees at most %d." %
+                  (len(binds), maxc, len(binds)), file=sys.stderr)
+        else:
+            print("Note: No --bind given; the TCD sees all emulated clients as one.", file=sys.stderr)
+        binds = (binds * maxc)[:maxc]
+    # Sockets are per distinct address
+    distinct = []
+    for b in binds:
+        if b not in distinct:
+            distinct.append(b)
+
+    print("clients  sent   recv   loss%%   p50ms   p95ms   maxms  (%s, %.0f req/s/client, %.0fs)" %
+          ("multicast" if args.mc else "unicast", args.rate, args.duration))
+
+    failed = 0
+    serial = int(time.time()) & 0xffff
+    for n in counts:
+        nb = distinct[:max(1, min(n, len(distinct)))]
+        sent, lat, late, serial = run(args, n, nb, serial)
+        tsent = sum(sent)
+        all_lat = [v for l in lat for v in l]
+        recv = len(all_lat)
+        loss = 100.0 * (tsent - recv) / tsent if tsent else 0.0
+        p95 = percentile(all_lat, 95)
+        fail = []
+        if not tsent:
+            fail.append("nothing sent")
+        if args.max_loss is not None and loss > args.max_loss:
+            fail.append("loss")
+        if args.max_p95 is not None and not p95 <= args.max_p95:
+            fail.append("p95")
+        failed += len(fail) > 0
+        print("%7d %6d %6d %7.2f %7.2f %7.2f %7.2f%s%s" %
+              (n, tsent, recv, loss,
+               percentile(all_lat, 50), p95,
+               max(all_lat) if all_lat else float("nan"),
+               ("  (%d late)" % late) if late else "",
+               ("  FAIL: " + ", ".join(fail)) if fail else ""))
+        time.sleep(0.2 if fake else 1.0)
+
+    if fake:
+        stop.set()
+        fake.join()
+        types = sorted(set(t for _, t in seen))
+        if types != sorted(CLIENT_TYPES[:min(maxc, len(CLIENT_TYPES))]):
+            print("FAIL: stand-in saw client types %s" % types)
+            failed += 1
+
+    if args.max_loss is not None or args.max_p95 is not None:
+        print("FAIL" if failed else "PASS")
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())